@@ -77,14 +77,8 @@ bool ADALightLEDInterface::InitInterface()
 
 	SetCommTimeouts(m_fileHandle, &timeouts);
 
-	m_transmitBuffer.resize(6 + (m_numLEDs * 3));
-
-	m_transmitBuffer[0] = 'A';
-	m_transmitBuffer[1] = 'd';
-	m_transmitBuffer[2] = 'a';
-	m_transmitBuffer[3] = (m_numLEDs - 1) >> 8;
-	m_transmitBuffer[4] = (m_numLEDs - 1) & 0xff;
-	m_transmitBuffer[5] = m_transmitBuffer[3] ^ m_transmitBuffer[4] ^ 0x55;
+	m_transmitBuffer.resize(GetAdaLightFrameSize(m_numLEDs));
+	EncodeAdaLightHeader(m_transmitBuffer.data(), m_numLEDs);
 
 	TurnOffLEDs();
 
@@ -102,7 +96,7 @@ void ADALightLEDInterface::SetLEDs(std::shared_ptr<std::vector<LEDOutputData>> l
 
 	DWORD bytesWritten = 0;
 
-	memcpy(&m_transmitBuffer[6], ledData->data(), min(ledData->size() * 3, m_numLEDs * 3));
+	EncodeAdaLightColors(&m_transmitBuffer[ADALIGHT_HEADER_SIZE], ledData->data(), ledData->size(), m_numLEDs);
 
 	WriteFile(m_fileHandle, m_transmitBuffer.data(), (DWORD)m_transmitBuffer.size(), &bytesWritten, nullptr);
 
@@ -117,7 +111,7 @@ void ADALightLEDInterface::TurnOffLEDs()
 
 	DWORD bytesWritten = 0;
 
-	memset(&m_transmitBuffer[6], '\0', m_numLEDs * 3);
+	EncodeAdaLightColors(&m_transmitBuffer[ADALIGHT_HEADER_SIZE], nullptr, 0, m_numLEDs);
 
 	WriteFile(m_fileHandle, m_transmitBuffer.data(), (DWORD)m_transmitBuffer.size(), &bytesWritten, nullptr);
 }
@@ -1,7 +1,9 @@
 
 #pragma once
 
+#include "framework.h"
 #include "led_interface.h"
+#include "adalight_protocol.h"
 
 class ADALightLEDInterface : public ILEDInterface
 {
@@ -0,0 +1,28 @@
+#include "adalight_protocol.h"
+
+#include <cstring>
+
+
+void EncodeAdaLightHeader(uint8_t* outHeader, int numLEDs)
+{
+	outHeader[0] = 'A';
+	outHeader[1] = 'd';
+	outHeader[2] = 'a';
+	outHeader[3] = (uint8_t)((numLEDs - 1) >> 8);
+	outHeader[4] = (uint8_t)((numLEDs - 1) & 0xff);
+	outHeader[5] = outHeader[3] ^ outHeader[4] ^ 0x55;
+}
+
+void EncodeAdaLightColors(uint8_t* outColors, const LEDOutputData* colors, size_t numColors, int numLEDs)
+{
+	static_assert(sizeof(LEDOutputData) == 3, "LEDOutputData must match the AdaLight byte order");
+
+	const size_t numCopied = numColors < (size_t)numLEDs ? numColors : (size_t)numLEDs;
+
+	if (numCopied > 0)
+	{
+		memcpy(outColors, colors, numCopied * 3);
+	}
+
+	memset(outColors + numCopied * 3, 0, ((size_t)numLEDs - numCopied) * 3);
+}
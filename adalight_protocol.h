@@ -0,0 +1,18 @@
+#pragma once
+
+#include "structures.h"
+
+#define ADALIGHT_HEADER_SIZE 6
+
+
+// Size of a complete AdaLight frame: the header, then three bytes per LED.
+static inline size_t GetAdaLightFrameSize(int numLEDs)
+{
+	return ADALIGHT_HEADER_SIZE + (size_t)numLEDs * 3;
+}
+
+// Writes the "Ada" magic, the LED count minus one and its checksum.
+void EncodeAdaLightHeader(uint8_t* outHeader, int numLEDs);
+
+// Writes the RGB bytes following the header. LEDs without a color are turned off.
+void EncodeAdaLightColors(uint8_t* outColors, const LEDOutputData* colors, size_t numColors, int numLEDs);
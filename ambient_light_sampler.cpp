@@ -1,17 +1,26 @@
 
 #include "ambient_light_sampler.h"
+#include "d3d11_renderer.h"
+#include "cpu_renderer.h"
+#include "openvr_frame_source.h"
 
 #include <cmath>
 #include "mathutil.h"
+#include "color_kernels.h"
+#include "color_dither.h"
+#include "temporal_filter.h"
 
 #include "profiling.h"
 
+#include <filesystem>
+
 #define WAIT_FRAME_TIMEOUT_MS 100
 
-AmbientLightSampler::AmbientLightSampler(std::shared_ptr<SettingsManager> settingsManager, AsyncData& asyncData)
+AmbientLightSampler::AmbientLightSampler(std::shared_ptr<SettingsManager> settingsManager, AsyncData& asyncData, const std::string& recordingDirectory)
 	: m_settingsManager(settingsManager)
 	, m_asyncData(asyncData)
-	, m_renderer(D3D11Renderer(settingsManager))
+	, m_frameSource(std::make_unique<OpenVRFrameSource>())
+	, m_recordingDirectory(recordingDirectory)
 {
 	
 }
@@ -64,32 +73,74 @@ bool AmbientLightSampler::InitSampler()
 	return false;
 }
 
-void AmbientLightSampler::CalculateOutputColor(LEDShaderOutput& input, LEDOutputData& output)
+void AmbientLightSampler::SetFrameSource(std::unique_ptr<IFrameSource> frameSource)
 {
-	Settings_Main& mainSettings = m_settingsManager->GetSettings_Main();
+	if (m_thread.joinable())
+	{
+		m_bRun = false;
+		m_thread.join();
+	}
 
-	double L, a, b, red, green, blue;
+	m_frameSource = std::move(frameSource);
 
-	LinearRGBtoLAB_D65(input.r, input.g, input.b, L, a, b);
+	// The renderer is picked to match the source on the next initialization.
+	m_renderer.reset();
+}
 
-	L = min(max((L - 50.0) * mainSettings.Contrast + 50.0, 0.0), 100.0);
-	//L = min(max(L + (mainSettings.Brightness - 1.0) * 100.0, 0.0), 100.0);
-	a *= mainSettings.Saturation;
-	b *= mainSettings.Saturation;
+void AmbientLightSampler::UpdateColorParams()
+{
+	// Pick up the latest color parameters published by the UI once per frame.
+	m_colorParams = m_settingsManager->GetColorParams();
+}
 
-	LABtoLinearRGB_D65(L, a, b, red, green, blue);
+void AmbientLightSampler::CalculateOutputColors(std::vector<LEDShaderOutput>& input)
+{
+	std::vector<LEDOutputData>& output = *m_writeData.get();
+	int numLEDs = min((int)input.size(), (int)output.size());
 
-	output.r = (uint8_t)(min(max((std::pow((red - mainSettings.MinRed) * mainSettings.Brightness / (1.0 - mainSettings.MinRed), 1.0 / mainSettings.GammaRed) * mainSettings.MaxRed), 0.0), 1.0) * 255.0);
+	// Only grows when the LED count changes.
+	if ((int)m_outputColors.size() < numLEDs)
+	{
+		m_outputColors.resize(numLEDs);
+	}
 
-	output.g = (uint8_t)(min(max((std::pow((green - mainSettings.MinGreen) * mainSettings.Brightness / (1.0 - mainSettings.MinGreen), 1.0 / mainSettings.GammaGreen) * mainSettings.MaxGreen), 0.0), 1.0) * 255.0);
+	m_colorBuffer.SetFromShaderOutput(input);
+	GradeColorBatch(*m_colorParams, m_colorBuffer, m_outputColors.data(), numLEDs);
 
-	output.b = (uint8_t)(min(max((std::pow((blue - mainSettings.MinBlue) * mainSettings.Brightness / (1.0 - mainSettings.MinBlue), 1.0 / mainSettings.GammaBlue) * mainSettings.MaxBlue), 0.0), 1.0) * 255.0);
+	if (m_settingsManager->GetSettings_Main().TemporalDithering)
+	{
+		m_dither.Process(m_outputColors.data(), output.data(), numLEDs);
+	}
+	else
+	{
+		TruncateOutputColors(m_outputColors.data(), output.data(), numLEDs);
+	}
 }
 
 void AmbientLightSampler::RunThread()
 {
 	{
-		if (!m_renderer.IsIntialized() && !m_renderer.InitRenderer())
+		if (!m_frameSource->InitSource())
+		{
+			g_logger->error("Failed to initialize frame source.");
+			m_bThreadFailed = true;
+			return;
+		}
+
+		// Frames in CPU memory are sampled on the CPU, the compositor mirror textures on the GPU.
+		if (!m_renderer)
+		{
+			if (m_frameSource->HasFrameImages())
+			{
+				m_renderer = std::make_unique<CPURenderer>();
+			}
+			else
+			{
+				m_renderer = std::make_unique<D3D11Renderer>(m_settingsManager);
+			}
+		}
+
+		if (!m_renderer->IsIntialized() && !m_renderer->InitRenderer())
 		{
 			m_bThreadFailed = true;
 			return;
@@ -128,6 +179,8 @@ void AmbientLightSampler::RunThread()
 
 		m_writeData = std::make_shared<std::vector<LEDOutputData>>(numLEDs);
 
+		m_bUseSourceSampleAreas = false;
+
 		m_bThreadIntialized = true;
 	}
 
@@ -165,10 +218,10 @@ void AmbientLightSampler::RunThread()
 				input = { 0.0, 0.0, mainSettings.PreviewValue };
 			}
 
-			for (int i = 0; i < m_ledData->NumLEDs; i++)
-			{
-				CalculateOutputColor(input, (*m_writeData.get())[i]);
-			}
+			m_previewInput.assign(m_ledData->NumLEDs, input);
+
+			UpdateColorParams();
+			CalculateOutputColors(m_previewInput);
 
 			m_asyncData.PreviewActive = true;
 			m_interface->SetLEDs(m_writeData);
@@ -177,9 +230,7 @@ void AmbientLightSampler::RunThread()
 		}
 		m_asyncData.PreviewActive = false;
 
-		vr::EDeviceActivityLevel level = vr::VRSystem()->GetTrackedDeviceActivityLevel(vr::k_unTrackedDeviceIndex_Hmd);
-
-		if (level == vr::k_EDeviceActivityLevel_Unknown || level == vr::k_EDeviceActivityLevel_Standby || level == vr::k_EDeviceActivityLevel_Idle_Timeout)
+		if (!m_frameSource->IsActive())
 		{
 			m_asyncData.OpenVRSampling = false;
 			m_interface->TurnOffLEDs();
@@ -188,44 +239,116 @@ void AmbientLightSampler::RunThread()
 		}
 
 
-		vr::EVROverlayError error = vr::VROverlay()->WaitFrameSync(WAIT_FRAME_TIMEOUT_MS);
+		EFrameWaitResult waitResult = m_frameSource->WaitFrame(WAIT_FRAME_TIMEOUT_MS);
 
-		if (error == vr::VROverlayError_TimedOut)
+		if (waitResult == FrameWait_TimedOut)
 		{
 			m_asyncData.OpenVRSampling = false;
 			g_logger->warn("Frame sync timed out.");
 			m_interface->TurnOffLEDs();
 			std::this_thread::yield();
 			continue;
-		}	
+		}
+		else if (waitResult == FrameWait_EndOfStream)
+		{
+			g_logger->info("Frame source has no more frames.");
+			m_interface->TurnOffLEDs();
+			break;
+		}
+
+		// Frames without output still count towards the filter time step.
+		m_filterIntervalMS += m_frameSource->GetFrameIntervalMS();
+		m_recordIntervalMS += m_frameSource->GetFrameIntervalMS();
 
 		LARGE_INTEGER preRenderTime = StartPerfTimer();
 
 		
 
-		if (m_bGeometryUpdated)
+		bool bGeometryChanged = false;
+
+		// Replayed sessions bring the sample areas they were recorded with.
+		if (m_frameSource->GetSampleAreas(m_sourceSampleAreas))
+		{
+			const int numAreas = min((int)m_sourceSampleAreas.size(), m_ledData->NumLEDs);
+			std::copy(m_sourceSampleAreas.begin(), m_sourceSampleAreas.begin() + numAreas, m_ledData->sampleAreas.begin());
+			m_bUseSourceSampleAreas = true;
+			bGeometryChanged = true;
+		}
+		else if (m_bGeometryUpdated && !m_bUseSourceSampleAreas)
 		{
-			m_bGeometryUpdated = false;
 			UpdateSampleArea();
+			bGeometryChanged = true;
+		}
+
+		m_bGeometryUpdated = false;
+
+		if (bGeometryChanged)
+		{
 			m_ledData->IsInputUpdated = true;
+			m_ledData->GeometryVersion++;
+			m_recorder.RecordSampleAreas(m_ledData->sampleAreas, m_ledData->NumLEDs);
 		}
 
+		UpdateRecording(mainSettings);
 
-		if (m_renderer.Render(m_ledData))
+		if (m_bMirrorTexturesInvalidated.exchange(false))
+		{
+			m_renderer->InvalidateMirrorTextures();
+		}
+
+		RGBAImageView leftImage, rightImage;
+
+		if (m_frameSource->GetFrameImages(leftImage, rightImage))
+		{
+			m_renderer->SetFrames(leftImage, rightImage);
+
+			if (m_recorder.IsRecording())
+			{
+				DownscaleImage(leftImage, mainSettings.RecordingDownscale, m_recordFrame.Left);
+				DownscaleImage(rightImage, mainSettings.RecordingDownscale, m_recordFrame.Right);
+				RecordFrame();
+			}
+		}
+
+
+		bool bHasOutput = m_renderer->Render(m_ledData);
+
+		// Frames captured on the GPU arrive a few frames late, without stalling the sampling.
+		if (m_recorder.IsRecording() && m_renderer->GetCapturedFrame(m_recordFrame))
+		{
+			RecordFrame();
+		}
+
+		if (bHasOutput)
 		{
 			if (!m_bRun) { break; }
 
-			for (int i = 0; i < m_ledData->NumLEDs; i++)
+			UpdateColorParams();
+
+			LARGE_INTEGER preColorTime = StartPerfTimer();
+
+			if (m_ledData->IsOutputGraded)
+			{
+				m_filter.Reset();
+				*m_writeData.get() = m_ledData->gradedOutput;
+			}
+			else
 			{
-				CalculateOutputColor(m_ledData->sampleOutput[i], (*m_writeData.get())[i]);
+				m_filter.Process(m_ledData->sampleOutput, mainSettings.GetTemporalFilterParams(), m_filterIntervalMS);
+				CalculateOutputColors(m_ledData->sampleOutput);
 			}
 
+			m_filterIntervalMS = 0;
+
+			float colorTime = EndPerfTimer(preColorTime);
+
 			float renderTime = EndPerfTimer(preRenderTime.QuadPart);
 			LARGE_INTEGER prePresentTime = StartPerfTimer();
 
 			if (!m_bRun) { break; }
 
 			m_interface->SetLEDs(m_writeData);
+			m_recorder.RecordOutput(*m_writeData.get());
 
 			float presentTime = EndPerfTimer(prePresentTime.QuadPart);
 
@@ -236,14 +359,94 @@ void AmbientLightSampler::RunThread()
 			m_asyncData.RenderTimeMS = UpdateAveragePerfTime(m_renderTimes, renderTime, 20);
 			m_asyncData.PresentTimeMS = UpdateAveragePerfTime(m_presentTimes, presentTime, 20);
 			m_asyncData.FrameIntervalMS = UpdateAveragePerfTime(m_frameIntervals, frameInterval, 20);
+			m_asyncData.ColorTimePerLEDNS = UpdateAveragePerfTime(m_colorTimes, colorTime * 1000000.0f / max(m_ledData->NumLEDs, 1), 20);
+			m_asyncData.FilterLatencyMS = UpdateAveragePerfTime(m_filterLatencies, m_filter.GetLatencyMS(), 20);
+			m_asyncData.ReadbackLatencyMS = UpdateAveragePerfTime(m_readbackLatencies, m_renderer->GetReadbackLatencyMS(), 20);
+
+			const GPUPassTimes& gpuTimes = m_renderer->GetGPUPassTimes();
+			m_asyncData.GPUPrepareTimeMS = UpdateAveragePerfTime(m_gpuPrepareTimes, gpuTimes.PrepareMS, 20);
+			m_asyncData.GPUSampleTimeMS = UpdateAveragePerfTime(m_gpuSampleTimes, gpuTimes.SampleMS, 20);
+			m_asyncData.GPUCombineTimeMS = UpdateAveragePerfTime(m_gpuCombineTimes, gpuTimes.CombineMS, 20);
+			m_asyncData.GPUReadbackTimeMS = UpdateAveragePerfTime(m_gpuReadbackTimes, gpuTimes.ReadbackMS, 20);
+			m_asyncData.RecordingDroppedFrames = m_recorder.GetDroppedFrames();
 		}
 
 		std::this_thread::yield();
 	}
 
+	m_recorder.Stop();
+	m_renderer->SetFrameCapture(false, 0);
+	m_asyncData.RecordingActive = false;
 	m_asyncData.OpenVRSampling = false;
 }
 
+// Starts or stops recording the session to follow the settings.
+void AmbientLightSampler::UpdateRecording(Settings_Main& mainSettings)
+{
+	const bool bFromGPU = !m_frameSource->HasFrameImages();
+
+	// The recorder stops by itself when writing fails, such as when the disk is full.
+	if (m_asyncData.RecordingActive && !m_recorder.IsRecording())
+	{
+		m_recorder.Stop();
+		m_renderer->SetFrameCapture(false, 0);
+		m_asyncData.RecordingActive = false;
+		m_asyncData.RecordingWriteFailed = true;
+		mainSettings.RecordSession = false;
+		g_logger->error("Session recording stopped after failing to write, {} frames dropped.", m_recorder.GetDroppedFrames());
+		return;
+	}
+
+	if (mainSettings.RecordSession == m_recorder.IsRecording())
+	{
+		m_renderer->SetFrameCapture(mainSettings.RecordSession && bFromGPU, mainSettings.RecordingDownscale);
+		return;
+	}
+
+	if (!mainSettings.RecordSession)
+	{
+		m_recorder.Stop();
+		m_renderer->SetFrameCapture(false, 0);
+		m_asyncData.RecordingActive = false;
+		m_asyncData.RecordingWriteFailed = m_recorder.HasWriteFailed();
+		g_logger->info("Session recording stopped, {} frames dropped.", m_recorder.GetDroppedFrames());
+		return;
+	}
+
+	SYSTEMTIME time;
+	GetLocalTime(&time);
+
+	char fileName[64];
+	snprintf(fileName, sizeof(fileName), "session_%04d%02d%02d_%02d%02d%02d.alrec", time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond);
+
+	std::string path = (std::filesystem::path(m_recordingDirectory) / fileName).string();
+
+	if (!m_recorder.Start(path))
+	{
+		g_logger->error("Failed to open session recording {}", path);
+		mainSettings.RecordSession = false;
+		return;
+	}
+
+	g_logger->info("Recording session to {}", path);
+
+	m_recorder.RecordSampleAreas(m_ledData->sampleAreas, m_ledData->NumLEDs);
+	m_renderer->SetFrameCapture(bFromGPU, mainSettings.RecordingDownscale);
+	m_recordIntervalMS = 0;
+	m_asyncData.RecordingActive = true;
+	m_asyncData.RecordingDroppedFrames = 0;
+	m_asyncData.RecordingWriteFailed = false;
+}
+
+void AmbientLightSampler::RecordFrame()
+{
+	// A dropped frame's interval carries over to the next one, keeping the recorded timing intact.
+	if (m_recorder.RecordFrame(m_recordFrame.Left.GetView(), m_recordFrame.Right.GetView(), m_recordIntervalMS))
+	{
+		m_recordIntervalMS = 0;
+	}
+}
+
 void AmbientLightSampler::UpdateSampleArea()
 {
 	Settings_Main& mainSettings = m_settingsManager->GetSettings_Main();
@@ -270,7 +473,8 @@ void AmbientLightSampler::UpdateSampleArea()
 		m_ledData->sampleAreas[index].yMin = (yOrigin - vertRadius);
 		m_ledData->sampleAreas[index].yMax = (yOrigin + vertRadius);
 
-		
+		// The first half of the strip is always sampled from the left eye.
+		m_ledData->sampleAreas[index].eye = index < mainSettings.NumLights / 2 ? 0 : 1;
 	}
 
 	for (int i = 0; i < mainSettings.NumLights / 2; i++)
@@ -287,5 +491,7 @@ void AmbientLightSampler::UpdateSampleArea()
 
 		m_ledData->sampleAreas[index].yMin = (yOrigin - vertRadius);
 		m_ledData->sampleAreas[index].yMax = (yOrigin + vertRadius);
+
+		m_ledData->sampleAreas[index].eye = index < mainSettings.NumLights / 2 ? 0 : 1;
 	}
 }
@@ -3,48 +3,85 @@
 
 #include "framework.h"
 #include "structures.h"
-#include "d3d11_renderer.h"
+#include "light_renderer.h"
+#include "frame_source.h"
 #include "led_interface.h"
 #include "adalight_led_interface.h"
 #include "async_data.h"
 #include "settings_manager.h"
+#include "color_dither.h"
+#include "temporal_filter.h"
+#include "session_recording.h"
 
 class AmbientLightSampler
 {
 public:
 
-	AmbientLightSampler(std::shared_ptr<SettingsManager> settingsManager, AsyncData& asyncData);
+	AmbientLightSampler(std::shared_ptr<SettingsManager> settingsManager, AsyncData& asyncData, const std::string& recordingDirectory);
 	~AmbientLightSampler();
 
 	bool InitSampler();
 
 	void SetGeometryUpdated() { m_bGeometryUpdated = true; }
+	void SetMirrorTexturesInvalidated() { m_bMirrorTexturesInvalidated = true; }
+
+	// Replaces the OpenVR compositor as the source of frames, only while the sampler isn't running.
+	void SetFrameSource(std::unique_ptr<IFrameSource> frameSource);
 
 protected:
-	void CalculateOutputColor(LEDShaderOutput& input, LEDOutputData& output);
+	void UpdateColorParams();
+	void CalculateOutputColors(std::vector<LEDShaderOutput>& input);
 	void RunThread();
 	void UpdateSampleArea();
+	void UpdateRecording(Settings_Main& mainSettings);
+	void RecordFrame();
 
 	std::atomic_bool m_bRun = true;
 	std::atomic_bool m_bThreadIntialized = false;
 	std::atomic_bool m_bThreadFailed = false;
 	std::atomic_bool m_bGeometryUpdated = false;
+	std::atomic_bool m_bMirrorTexturesInvalidated = false;
 	std::thread m_thread;
 
 	std::shared_ptr<SettingsManager> m_settingsManager;
 	AsyncData& m_asyncData;
 
-	D3D11Renderer m_renderer;
+	std::unique_ptr<IFrameSource> m_frameSource;
+	std::unique_ptr<ILightRenderer> m_renderer;
 
 	std::shared_ptr<LEDSampleData> m_ledData;
 
+	std::shared_ptr<const ColorParams> m_colorParams;
+	LEDColorBuffer m_colorBuffer;
+	std::vector<LEDShaderOutput> m_previewInput;
+	std::vector<LEDOutputData16> m_outputColors;
+	TemporalDither m_dither;
+	TemporalFilter m_filter;
+
 	std::shared_ptr<std::vector<LEDOutputData>> m_writeData;
 
 	std::unique_ptr<ILEDInterface> m_interface;
 
+	std::string m_recordingDirectory;
+	SessionRecorder m_recorder;
+	StereoFrame m_recordFrame;
+	float m_recordIntervalMS = 0;
+
+	// Set once the frame source has provided its own sample areas, the settings geometry is ignored after that.
+	bool m_bUseSourceSampleAreas = false;
+	std::vector<LEDSampleArea> m_sourceSampleAreas;
+
 	LARGE_INTEGER m_lastRenderTime = {};
+	float m_filterIntervalMS = 0;
 	std::deque<float> m_frameIntervals;
 	std::deque<float> m_renderTimes;
 	std::deque<float> m_presentTimes;
+	std::deque<float> m_colorTimes;
+	std::deque<float> m_filterLatencies;
+	std::deque<float> m_readbackLatencies;
+	std::deque<float> m_gpuPrepareTimes;
+	std::deque<float> m_gpuSampleTimes;
+	std::deque<float> m_gpuCombineTimes;
+	std::deque<float> m_gpuReadbackTimes;
 };
 
@@ -14,6 +14,19 @@ struct AsyncData
 	float FrameIntervalMS = 0;
 	float RenderTimeMS = 0;
 	float PresentTimeMS = 0;
+	float ColorTimePerLEDNS = 0;
+	float FilterLatencyMS = 0;
+	float ReadbackLatencyMS = 0;
+
+	// GPU time of each pass, from timestamp queries.
+	float GPUPrepareTimeMS = 0;
+	float GPUSampleTimeMS = 0;
+	float GPUCombineTimeMS = 0;
+	float GPUReadbackTimeMS = 0;
+
+	bool RecordingActive = false;
+	uint32_t RecordingDroppedFrames = 0;
+	bool RecordingWriteFailed = false;
 
 	AsyncData()
 	{
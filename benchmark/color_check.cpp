@@ -0,0 +1,187 @@
+// Checks the color LUT and the batch kernel against the analytic color grading, over random colors and a spread of color
+// settings. Returns a nonzero exit code if any of the checks fails.
+
+#include "color_grading.h"
+#include "color_lut.h"
+#include "color_kernels.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+// Largest allowed deviation from GradeColor(), in 8-bit output steps.
+#define COLOR_LUT_ERROR_BOUND 1.0
+
+// The batch kernel works in single precision, which can be a few steps off right where a channel crosses its min value
+// with a steep gamma curve. Only a handful of the checked channels may be more than one step off.
+#define COLOR_BATCH_ERROR_BOUND 4.0
+#define COLOR_BATCH_MAX_OVER_ONE_STEP 10
+
+#define NUM_CHECK_COLORS 200000
+#define NUM_RANDOM_SETTINGS 24
+
+
+struct CheckSettings
+{
+	const char* Name;
+	ColorGradingSettings Settings;
+};
+
+static std::vector<CheckSettings> GetCheckSettings()
+{
+	std::vector<CheckSettings> checks;
+
+	for (int space : { ColorSpace_CIELAB, ColorSpace_Oklab })
+	{
+		const bool bOklab = space == ColorSpace_Oklab;
+
+		ColorGradingSettings settings;
+		settings.AdjustmentSpace = space;
+		checks.push_back({ bOklab ? "oklab_default" : "lab_default", settings });
+
+		settings.Saturation = 1.5f;
+		checks.push_back({ bOklab ? "oklab_saturation" : "lab_saturation", settings });
+
+		settings.Contrast = 1.3f;
+		checks.push_back({ bOklab ? "oklab_saturation_contrast" : "lab_saturation_contrast", settings });
+
+		settings.Brightness = 2.0f;
+		settings.Saturation = 2.0f;
+		settings.Contrast = 2.0f;
+		settings.MinRed = settings.MinGreen = settings.MinBlue = 0.2f;
+		settings.MaxRed = settings.MaxGreen = settings.MaxBlue = 0.5f;
+		settings.GammaRed = settings.GammaGreen = settings.GammaBlue = 4.0f;
+		checks.push_back({ bOklab ? "oklab_extreme" : "lab_extreme", settings });
+
+		settings = ColorGradingSettings();
+		settings.AdjustmentSpace = space;
+		settings.Contrast = 0.5f;
+		settings.Saturation = 0.0f;
+		settings.GammaRed = settings.GammaGreen = settings.GammaBlue = 0.5f;
+		checks.push_back({ bOklab ? "oklab_flat" : "lab_flat", settings });
+	}
+
+	// Anywhere within the slider ranges of the settings menu.
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+	for (int i = 0; i < NUM_RANDOM_SETTINGS; i++)
+	{
+		ColorGradingSettings settings;
+		settings.AdjustmentSpace = i & 1 ? ColorSpace_Oklab : ColorSpace_CIELAB;
+		settings.Brightness = distribution(random) * 2.0f;
+		settings.Contrast = distribution(random) * 2.0f;
+		settings.Saturation = distribution(random) * 2.0f;
+		settings.MinRed = distribution(random) * 0.5f;
+		settings.MinGreen = distribution(random) * 0.5f;
+		settings.MinBlue = distribution(random) * 0.5f;
+		settings.MaxRed = 0.2f + distribution(random) * 0.8f;
+		settings.MaxGreen = 0.2f + distribution(random) * 0.8f;
+		settings.MaxBlue = 0.2f + distribution(random) * 0.8f;
+		settings.GammaRed = 0.1f + distribution(random) * 3.9f;
+		settings.GammaGreen = 0.1f + distribution(random) * 3.9f;
+		settings.GammaBlue = 0.1f + distribution(random) * 3.9f;
+		checks.push_back({ "random", settings });
+	}
+
+	return checks;
+}
+
+// Half of the colors are uniform in linear space, the other half are squared to cover the dark range better.
+static void GetCheckColors(std::vector<LEDShaderOutput>& outColors)
+{
+	std::mt19937 random(2);
+	std::uniform_real_distribution<double> distribution(0.0, 1.0);
+
+	outColors.resize(NUM_CHECK_COLORS);
+
+	for (size_t i = 0; i < outColors.size(); i++)
+	{
+		LEDShaderOutput& color = outColors[i];
+		color.r = distribution(random);
+		color.g = distribution(random);
+		color.b = distribution(random);
+
+		if (i & 1)
+		{
+			color.r *= color.r;
+			color.g *= color.g;
+			color.b *= color.b;
+		}
+	}
+}
+
+static double OutputError(uint16_t output, double reference)
+{
+	return fabs(output / 256.0 - reference * 255.0);
+}
+
+int main()
+{
+	std::vector<LEDShaderOutput> colors;
+	GetCheckColors(colors);
+
+	ColorLUT colorLUT;
+	bool bPassed = true;
+
+	// Graded from the same single precision input as in the sampler.
+	LEDColorBuffer colorBuffer;
+	colorBuffer.SetFromShaderOutput(colors);
+	std::vector<LEDOutputData16> batchOutput(colors.size());
+
+	for (const CheckSettings& check : GetCheckSettings())
+	{
+		const ColorParams params(check.Settings, 1);
+		colorLUT.Build(params);
+
+		GradeColorBatch(params, colorBuffer, batchOutput.data(), (int)colors.size());
+
+		double maxError = 0.0;
+		double maxBatchError = 0.0;
+		int numOverOneStep = 0;
+		int numBatchOverOneStep = 0;
+
+		for (size_t led = 0; led < colors.size(); led++)
+		{
+			const LEDShaderOutput& color = colors[led];
+
+			double reference[3];
+			GradeColor(params, color.r, color.g, color.b, reference[0], reference[1], reference[2]);
+
+			LEDOutputData16 output;
+			colorLUT.Apply(color, output);
+
+			const uint16_t outputs[3] = { output.r, output.g, output.b };
+			const uint16_t batchOutputs[3] = { batchOutput[led].r, batchOutput[led].g, batchOutput[led].b };
+
+			double batchReference[3];
+			GradeColor(params, (double)colorBuffer.r[led], (double)colorBuffer.g[led], (double)colorBuffer.b[led], batchReference[0], batchReference[1], batchReference[2]);
+
+			for (int i = 0; i < 3; i++)
+			{
+				const double error = OutputError(outputs[i], reference[i]);
+				maxError = std::fmax(maxError, error);
+				numOverOneStep += error > 1.0 ? 1 : 0;
+
+				const double batchError = OutputError(batchOutputs[i], batchReference[i]);
+				maxBatchError = std::fmax(maxBatchError, batchError);
+				numBatchOverOneStep += batchError > 1.0 ? 1 : 0;
+			}
+		}
+
+		const bool bCheckPassed = maxError <= COLOR_LUT_ERROR_BOUND;
+		bPassed = bPassed && bCheckPassed;
+
+		printf("%-4s color_lut %-26s max error %.3f steps, %d channels over 1 step, %.1f%% of cells analytic\n",
+			bCheckPassed ? "ok" : "FAIL", check.Name, maxError, numOverOneStep, colorLUT.GetExactCellFraction() * 100.0f);
+
+		const bool bBatchPassed = maxBatchError <= COLOR_BATCH_ERROR_BOUND && numBatchOverOneStep <= COLOR_BATCH_MAX_OVER_ONE_STEP;
+		bPassed = bPassed && bBatchPassed;
+
+		printf("%-4s batch     %-26s max error %.3f steps, %d channels over 1 step\n", bBatchPassed ? "ok" : "FAIL", check.Name, maxBatchError, numBatchOverOneStep);
+	}
+
+	return bPassed ? 0 : 1;
+}
@@ -0,0 +1,778 @@
+// Headless benchmark of the CPU side of the light pipeline: sampling synthetic frames exactly and from summed area
+// tables, color grading, temporal filtering and AdaLight encoding, over a matrix of LED counts and frame sizes.
+// Prints the timings as JSON, with percentiles over the measured iterations.
+//
+// With --replay, a recorded session or raw frame file is sampled instead of the synthetic frames. Sessions are also
+// run through the color grading with the default settings and compared against the LED colors they recorded.
+
+#include "cpu_renderer.h"
+#include "summed_area_table.h"
+#include "synthetic_frame_source.h"
+#include "replay_frame_source.h"
+#include "file_frame_source.h"
+#include "memory_frame_source.h"
+#include "color_grading.h"
+#include "color_kernels.h"
+#include "color_lut.h"
+#include "color_dither.h"
+#include "temporal_filter.h"
+#include "adalight_protocol.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// The summed area tables are built single threaded and take tens of milliseconds per frame, so that stage is capped.
+#define SUMMED_AREA_MAX_ITERATIONS 20
+#define SUMMED_AREA_MAX_WARMUP 2
+
+
+struct BenchmarkOptions
+{
+	std::vector<int> LEDCounts = { 18, 60, 144, 300, 600, 1000, 2000 };
+	std::vector<std::pair<uint32_t, uint32_t>> Resolutions = { { 1024, 1024 }, { 1920, 1920 }, { 2880, 2880 } };
+	int Pattern = SyntheticPattern_MovingBars;
+	int Iterations = 200;
+	int WarmupIterations = 10;
+	int Threads = 0;
+	std::string OutputPath;
+	std::string ReplayPath;
+	int ReplayLag = 1;
+	bool bReplayExact = false;
+};
+
+struct BenchmarkResult
+{
+	std::string Stage;
+	std::string ColorSpace;
+	int NumLEDs = 0;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	int CallsPerSample = 1;
+
+	// Microseconds per call.
+	double Min = 0;
+	double Mean = 0;
+	double P50 = 0;
+	double P90 = 0;
+	double P99 = 0;
+	double Max = 0;
+};
+
+static const char* g_patternNames[] = { "solid_flash", "strobe", "gradient", "moving_bars", "noise" };
+static const char* g_colorSpaceNames[] = { "cielab", "oklab" };
+
+
+// Times the function over the warmup and measured iterations. Fast stages are called several times per sample,
+// so the timer resolution doesn't dominate.
+static BenchmarkResult MeasureStage(const BenchmarkOptions& options, const char* stage, int numLEDs, int callsPerSample, const std::function<void()>& function)
+{
+	std::vector<double> samples;
+	samples.reserve(options.Iterations);
+
+	for (int i = 0; i < options.WarmupIterations + options.Iterations; i++)
+	{
+		auto startTime = std::chrono::steady_clock::now();
+
+		for (int call = 0; call < callsPerSample; call++)
+		{
+			function();
+		}
+
+		auto endTime = std::chrono::steady_clock::now();
+
+		if (i >= options.WarmupIterations)
+		{
+			samples.push_back(std::chrono::duration<double, std::micro>(endTime - startTime).count() / callsPerSample);
+		}
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	// Nearest rank percentiles.
+	auto percentile = [&](double fraction)
+	{
+		size_t rank = (size_t)std::ceil(fraction * samples.size());
+		return samples[std::clamp(rank, (size_t)1, samples.size()) - 1];
+	};
+
+	BenchmarkResult result;
+	result.Stage = stage;
+	result.NumLEDs = numLEDs;
+	result.CallsPerSample = callsPerSample;
+	result.Min = samples.front();
+	result.Max = samples.back();
+	result.P50 = percentile(0.5);
+	result.P90 = percentile(0.9);
+	result.P99 = percentile(0.99);
+
+	for (double sample : samples)
+	{
+		result.Mean += sample;
+	}
+
+	result.Mean /= samples.size();
+
+	return result;
+}
+
+// Same layout as the default geometry settings: half of the LEDs in a column on the inner edge of each eye.
+static void BuildSampleAreas(int numLEDs, std::vector<LEDSampleArea>& outAreas)
+{
+	const float heightFraction = 0.5f;
+	const float widthFraction = 0.35f;
+	const float horizontalOffset = 0.22f;
+	const float verticalOffset = -0.02f;
+	const float curvature = 0.12f;
+	const float curvatureShape = 0.12f;
+
+	const int numPerSide = std::max(numLEDs / 2, 1);
+	const float vertFrac = heightFraction / numPerSide;
+	const float vertRadius = vertFrac / 2.0f;
+	const float curvatureFactor = curvature / numLEDs;
+	const float curvatureHalfway = curvatureShape * (numLEDs / 4.0f) + (numLEDs / 4.0f) - 0.5f;
+
+	outAreas.assign(numLEDs, LEDSampleArea(0, 0, 0, 0));
+
+	for (int index = 0; index < numLEDs; index++)
+	{
+		const uint32_t eye = index < numLEDs / 2 ? 0 : 1;
+		const int i = eye == 0 ? index : index - numLEDs / 2;
+
+		const float curve = curvatureFactor * std::pow(std::fabs(i - curvatureHalfway), 2.0f);
+		const float xOrigin = eye == 0 ? horizontalOffset + curve : 1.0f - horizontalOffset - curve;
+		const float yOrigin = vertFrac * (i + 0.5f) - verticalOffset + (1.0f - heightFraction) / 2.0f;
+
+		outAreas[index] = LEDSampleArea(xOrigin - widthFraction / 2.0f, yOrigin - vertRadius, xOrigin + widthFraction / 2.0f, yOrigin + vertRadius, eye);
+	}
+}
+
+static ColorParams GetBenchmarkColorParams(int colorSpace)
+{
+	// Non-neutral settings, so every stage of the grading does work.
+	ColorGradingSettings settings;
+	settings.AdjustmentSpace = colorSpace;
+	settings.Brightness = 1.1f;
+	settings.Contrast = 1.2f;
+	settings.Saturation = 1.3f;
+	settings.MinRed = 0.02f;
+	settings.MaxBlue = 0.9f;
+	settings.GammaGreen = 2.4f;
+
+	return ColorParams(settings, 1);
+}
+
+static void RunSamplingBenchmarks(const BenchmarkOptions& options, int numLEDs, std::vector<BenchmarkResult>& results)
+{
+	std::vector<LEDSampleArea> areas;
+	BuildSampleAreas(numLEDs, areas);
+
+	const ColorParams colorParams = GetBenchmarkColorParams(ColorSpace_CIELAB);
+
+	TemporalFilterParams filterParams;
+	filterParams.Type = Filter_OneEuro;
+
+	for (const auto& resolution : options.Resolutions)
+	{
+		SyntheticFrameParams frameParams;
+		frameParams.Pattern = options.Pattern;
+		frameParams.Width = resolution.first;
+		frameParams.Height = resolution.second;
+
+		SyntheticFrameSource source(frameParams, false);
+		CPURenderer renderer(options.Threads);
+
+		if (!source.InitSource() || !renderer.InitRenderer())
+		{
+			fprintf(stderr, "Failed to initialize the sampling at %ux%u\n", resolution.first, resolution.second);
+			continue;
+		}
+
+		std::shared_ptr<LEDSampleData> ledData = std::make_shared<LEDSampleData>(numLEDs);
+		ledData->sampleAreas = areas;
+
+		TemporalFilter filter;
+		TemporalDither dither;
+		LEDColorBuffer colorBuffer;
+		std::vector<LEDOutputData16> colors(numLEDs);
+		std::vector<LEDOutputData> output(numLEDs);
+		std::vector<uint8_t> transmitBuffer(GetAdaLightFrameSize(numLEDs));
+		EncodeAdaLightHeader(transmitBuffer.data(), numLEDs);
+
+		RGBAImageView left, right;
+
+		auto nextFrame = [&]()
+		{
+			source.WaitFrame(0);
+			source.GetFrameImages(left, right);
+			renderer.SetFrames(left, right);
+		};
+
+		BenchmarkResult result = MeasureStage(options, "sample", numLEDs, 1, [&]()
+		{
+			nextFrame();
+			renderer.Render(ledData);
+		});
+
+		result.Width = resolution.first;
+		result.Height = resolution.second;
+		results.push_back(result);
+
+		// Summed area tables rebuilt every frame, including the conversion to the float frames they are built from.
+		CPUFrame leftFrame, rightFrame;
+		SummedAreaTable leftTable, rightTable;
+		std::vector<LEDShaderOutput> summedAreaOutput;
+
+		BenchmarkOptions summedAreaOptions = options;
+		summedAreaOptions.Iterations = std::min(options.Iterations, SUMMED_AREA_MAX_ITERATIONS);
+		summedAreaOptions.WarmupIterations = std::min(options.WarmupIterations, SUMMED_AREA_MAX_WARMUP);
+
+		result = MeasureStage(summedAreaOptions, "sample_sat", numLEDs, 1, [&]()
+		{
+			nextFrame();
+			CopyToCPUFrame(left, leftFrame);
+			CopyToCPUFrame(right, rightFrame);
+			leftTable.Build(leftFrame);
+			rightTable.Build(rightFrame);
+			SampleLEDs_SummedArea(leftTable, rightTable, areas, summedAreaOutput);
+		});
+
+		result.Width = resolution.first;
+		result.Height = resolution.second;
+		results.push_back(result);
+
+		// Everything the sampler thread does for a frame with the default settings, up to the bytes sent to the LEDs.
+		result = MeasureStage(options, "frame", numLEDs, 1, [&]()
+		{
+			nextFrame();
+			renderer.Render(ledData);
+			filter.Process(ledData->sampleOutput, filterParams, frameParams.FrameIntervalMS);
+			colorBuffer.SetFromShaderOutput(ledData->sampleOutput);
+			GradeColorBatch(colorParams, colorBuffer, colors.data(), numLEDs);
+
+			dither.Process(colors.data(), output.data(), numLEDs);
+			EncodeAdaLightColors(&transmitBuffer[ADALIGHT_HEADER_SIZE], output.data(), output.size(), numLEDs);
+		});
+
+		result.ColorSpace = g_colorSpaceNames[colorParams.AdjustmentSpace];
+		result.Width = resolution.first;
+		result.Height = resolution.second;
+		results.push_back(result);
+	}
+}
+
+static void RunColorBenchmarks(const BenchmarkOptions& options, int numLEDs, std::vector<BenchmarkResult>& results)
+{
+	// Mostly dark colors, like typical sample output.
+	std::mt19937 random(numLEDs);
+	std::uniform_real_distribution<double> distribution(0.0, 1.0);
+	std::vector<LEDShaderOutput> input(numLEDs);
+
+	for (LEDShaderOutput& color : input)
+	{
+		color.r = std::pow(distribution(random), 2.2);
+		color.g = std::pow(distribution(random), 2.2);
+		color.b = std::pow(distribution(random), 2.2);
+	}
+
+	ColorLUT colorLUT;
+	LEDColorBuffer colorBuffer;
+	TemporalDither dither;
+	TemporalFilter filter;
+	std::vector<LEDShaderOutput> filterSamples(input);
+	std::vector<LEDOutputData16> colors(numLEDs);
+	std::vector<LEDOutputData> output(numLEDs);
+	std::vector<uint8_t> transmitBuffer(GetAdaLightFrameSize(numLEDs));
+
+	// Aims for at least a few thousand LEDs per sample.
+	const int calls = std::max(4000 / numLEDs, 1);
+
+	// The color grading stages are run in both adjustment spaces.
+	for (int colorSpace : { ColorSpace_CIELAB, ColorSpace_Oklab })
+	{
+		const ColorParams colorParams = GetBenchmarkColorParams(colorSpace);
+		colorLUT.Build(colorParams);
+
+		const size_t firstResult = results.size();
+
+		results.push_back(MeasureStage(options, "color_reference", numLEDs, calls, [&]()
+		{
+			for (int i = 0; i < numLEDs; i++)
+			{
+				double r, g, b;
+				GradeColor(colorParams, input[i].r, input[i].g, input[i].b, r, g, b);
+				colors[i] = { (uint16_t)(r * 255.0 * 256.0), (uint16_t)(g * 255.0 * 256.0), (uint16_t)(b * 255.0 * 256.0) };
+			}
+		}));
+
+		results.push_back(MeasureStage(options, "color_batch", numLEDs, calls, [&]()
+		{
+			colorBuffer.SetFromShaderOutput(input);
+			GradeColorBatch(colorParams, colorBuffer, colors.data(), numLEDs);
+		}));
+
+		results.push_back(MeasureStage(options, "color_lut", numLEDs, calls, [&]()
+		{
+			for (int i = 0; i < numLEDs; i++)
+			{
+				colorLUT.Apply(input[i], colors[i]);
+			}
+		}));
+
+		for (size_t i = firstResult; i < results.size(); i++)
+		{
+			results[i].ColorSpace = g_colorSpaceNames[colorSpace];
+		}
+	}
+
+	results.push_back(MeasureStage(options, "truncate", numLEDs, calls, [&]()
+	{
+		TruncateOutputColors(colors.data(), output.data(), numLEDs);
+	}));
+
+	results.push_back(MeasureStage(options, "dither", numLEDs, calls, [&]()
+	{
+		dither.Process(colors.data(), output.data(), numLEDs);
+	}));
+
+	const std::pair<const char*, int> filterTypes[] = { { "filter_ema", Filter_EMA }, { "filter_one_euro", Filter_OneEuro }, { "filter_attack_release", Filter_AttackRelease } };
+
+	for (const auto& filterType : filterTypes)
+	{
+		TemporalFilterParams filterParams;
+		filterParams.Type = filterType.second;
+
+		results.push_back(MeasureStage(options, filterType.first, numLEDs, calls, [&]()
+		{
+			filter.Process(filterSamples, filterParams, 11.1f);
+		}));
+	}
+
+	results.push_back(MeasureStage(options, "adalight_encode", numLEDs, calls, [&]()
+	{
+		EncodeAdaLightHeader(transmitBuffer.data(), numLEDs);
+		EncodeAdaLightColors(&transmitBuffer[ADALIGHT_HEADER_SIZE], output.data(), output.size(), numLEDs);
+	}));
+}
+
+// Areas recorded in a session replace the current ones, changing the LED count with them.
+static void UpdateReplayAreas(IFrameSource& source, LEDSampleData& ledData)
+{
+	std::vector<LEDSampleArea> areas;
+
+	if (!source.GetSampleAreas(areas))
+	{
+		return;
+	}
+
+	ledData.NumLEDs = (int)areas.size();
+	ledData.sampleAreas = std::move(areas);
+	ledData.sampleOutput.resize(ledData.NumLEDs);
+	ledData.GeometryVersion++;
+}
+
+// Samples and grades every frame of a session once, and compares the colors against the ones recorded for the same frame.
+// Only sessions recorded with the default color settings, no filtering or dithering and without downscaling match exactly.
+static bool CompareReplayOutput(const BenchmarkOptions& options)
+{
+	ReplayFrameSource source(options.ReplayPath, false, false);
+	CPURenderer renderer(options.Threads);
+
+	if (!source.InitSource() || !renderer.InitRenderer())
+	{
+		return false;
+	}
+
+	const ColorParams colorParams(ColorGradingSettings(), 1);
+	LEDColorBuffer colorBuffer;
+
+	std::shared_ptr<LEDSampleData> ledData = std::make_shared<LEDSampleData>();
+	std::deque<std::vector<LEDOutputData>> outputHistory;
+
+	size_t numFrames = 0;
+	size_t numCompared = 0;
+	size_t numChannels = 0;
+	size_t numExactChannels = 0;
+	int maxDifference = 0;
+	double differenceSum = 0.0;
+
+	while (source.WaitFrame(0) == FrameWait_Ready)
+	{
+		UpdateReplayAreas(source, *ledData);
+
+		// The output recorded before this frame belongs to the frame the lag before it.
+		const std::vector<LEDOutputData>& recorded = source.GetRecordedOutput();
+
+		if ((int)outputHistory.size() == options.ReplayLag && outputHistory.front().size() == recorded.size())
+		{
+			const uint8_t* expected = reinterpret_cast<const uint8_t*>(recorded.data());
+			const uint8_t* actual = reinterpret_cast<const uint8_t*>(outputHistory.front().data());
+
+			for (size_t i = 0; i < recorded.size() * 3; i++)
+			{
+				const int difference = std::abs((int)actual[i] - (int)expected[i]);
+				maxDifference = std::max(maxDifference, difference);
+				differenceSum += difference;
+				numExactChannels += difference == 0 ? 1 : 0;
+			}
+
+			numChannels += recorded.size() * 3;
+			numCompared++;
+		}
+
+		RGBAImageView left, right;
+		source.GetFrameImages(left, right);
+		renderer.SetFrames(left, right);
+		renderer.Render(ledData);
+
+		std::vector<LEDOutputData16> colors(ledData->NumLEDs);
+		std::vector<LEDOutputData> output(ledData->NumLEDs);
+
+		colorBuffer.SetFromShaderOutput(ledData->sampleOutput);
+		GradeColorBatch(colorParams, colorBuffer, colors.data(), ledData->NumLEDs);
+		TruncateOutputColors(colors.data(), output.data(), ledData->NumLEDs);
+
+		outputHistory.push_back(std::move(output));
+
+		if ((int)outputHistory.size() > options.ReplayLag)
+		{
+			outputHistory.pop_front();
+		}
+
+		numFrames++;
+	}
+
+	fprintf(stderr, "Replayed %zu frames, compared %zu against the recorded output: %.2f%% of the channels exact, mean difference %.3f, max %d\n",
+		numFrames, numCompared, numChannels > 0 ? 100.0 * numExactChannels / numChannels : 0.0, numChannels > 0 ? differenceSum / numChannels : 0.0, maxDifference);
+
+	if (numFrames == 0)
+	{
+		fprintf(stderr, "No frames in %s\n", options.ReplayPath.c_str());
+		return false;
+	}
+
+	if (options.bReplayExact && (numCompared == 0 || numExactChannels != numChannels))
+	{
+		fprintf(stderr, "The replayed output doesn't match the recording\n");
+		return false;
+	}
+
+	return true;
+}
+
+// Frames of a raw frame file are loaded into memory first, so reading the file isn't part of the timings.
+static bool LoadRawFrames(const std::string& path, std::vector<StereoFrame>& outFrames)
+{
+	FileFrameSource source(path, false, false);
+
+	if (!source.InitSource())
+	{
+		return false;
+	}
+
+	outFrames.clear();
+
+	while (source.WaitFrame(0) == FrameWait_Ready)
+	{
+		RGBAImageView left, right;
+		source.GetFrameImages(left, right);
+
+		StereoFrame& frame = outFrames.emplace_back();
+		DownscaleImage(left, 0, frame.Left);
+		DownscaleImage(right, 0, frame.Right);
+	}
+
+	return !outFrames.empty();
+}
+
+// Times the sampling of the replayed frames, looping over them. Sessions use their recorded sample areas,
+// raw frame files the generated layout for each of the LED counts.
+static bool RunReplayBenchmarks(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+	std::unique_ptr<IFrameSource> source = std::make_unique<ReplayFrameSource>(options.ReplayPath, false, true);
+	const bool bIsSession = source->InitSource();
+
+	if (bIsSession)
+	{
+		if (!CompareReplayOutput(options))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		std::vector<StereoFrame> frames;
+
+		if (!LoadRawFrames(options.ReplayPath, frames))
+		{
+			fprintf(stderr, "Failed to read %s as a session or raw frame file\n", options.ReplayPath.c_str());
+			return false;
+		}
+
+		// Without a frame interval the frames are handed out as fast as they are sampled.
+		source = std::make_unique<MemoryFrameSource>(std::move(frames), 0.0f, true);
+		source->InitSource();
+	}
+
+	CPURenderer renderer(options.Threads);
+
+	if (!renderer.InitRenderer())
+	{
+		return false;
+	}
+
+	std::vector<int> ledCounts = options.LEDCounts;
+
+	// The first frame is read for its size and the recorded areas.
+	std::shared_ptr<LEDSampleData> ledData = std::make_shared<LEDSampleData>();
+	RGBAImageView left, right;
+
+	source->WaitFrame(0);
+	source->GetFrameImages(left, right);
+
+	if (bIsSession)
+	{
+		UpdateReplayAreas(*source, *ledData);
+		ledCounts = { ledData->NumLEDs };
+	}
+
+	for (int numLEDs : ledCounts)
+	{
+		if (!bIsSession)
+		{
+			ledData = std::make_shared<LEDSampleData>(numLEDs);
+			BuildSampleAreas(numLEDs, ledData->sampleAreas);
+		}
+
+		BenchmarkResult result = MeasureStage(options, "replay_sample", numLEDs, 1, [&]()
+		{
+			source->WaitFrame(0);
+			source->GetFrameImages(left, right);
+			UpdateReplayAreas(*source, *ledData);
+			renderer.SetFrames(left, right);
+			renderer.Render(ledData);
+		});
+
+		result.Width = left.Width;
+		result.Height = left.Height;
+		results.push_back(result);
+	}
+
+	return true;
+}
+
+static void WriteResults(FILE* file, const BenchmarkOptions& options, int numThreads, const std::vector<BenchmarkResult>& results)
+{
+#if defined(__AVX2__)
+	const bool bAVX2 = true;
+#else
+	const bool bAVX2 = false;
+#endif
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"iterations\": %d,\n", options.Iterations);
+	fprintf(file, "  \"warmup_iterations\": %d,\n", options.WarmupIterations);
+	fprintf(file, "  \"threads\": %d,\n", numThreads);
+	fprintf(file, "  \"avx2\": %s,\n", bAVX2 ? "true" : "false");
+	fprintf(file, "  \"pattern\": \"%s\",\n", options.ReplayPath.empty() ? g_patternNames[options.Pattern] : "replay");
+	fprintf(file, "  \"unit\": \"us\",\n");
+	fprintf(file, "  \"results\": [\n");
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+
+		// Only the stages that grade colors have a color space.
+		const std::string colorSpace = result.ColorSpace.empty() ? "" : "\"color_space\": \"" + result.ColorSpace + "\", ";
+
+		fprintf(file, "    { \"stage\": \"%s\", %s\"leds\": %d, \"width\": %u, \"height\": %u, \"calls_per_sample\": %d, "
+			"\"min\": %.3f, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f }%s\n",
+			result.Stage.c_str(), colorSpace.c_str(), result.NumLEDs, result.Width, result.Height, result.CallsPerSample,
+			result.Min, result.Mean, result.P50, result.P90, result.P99, result.Max, i + 1 < results.size() ? "," : "");
+	}
+
+	fprintf(file, "  ]\n");
+	fprintf(file, "}\n");
+}
+
+static bool ParseIntList(const char* text, std::vector<int>& outValues)
+{
+	outValues.clear();
+
+	for (const char* token = text; *token; )
+	{
+		char* end;
+		long value = strtol(token, &end, 10);
+
+		if (end == token || value <= 0)
+		{
+			return false;
+		}
+
+		outValues.push_back((int)value);
+		token = *end == ',' ? end + 1 : end;
+	}
+
+	return !outValues.empty();
+}
+
+static bool ParseResolutionList(const char* text, std::vector<std::pair<uint32_t, uint32_t>>& outValues)
+{
+	outValues.clear();
+
+	for (const char* token = text; *token; )
+	{
+		unsigned int width, height;
+		int length = 0;
+
+		if (sscanf(token, "%ux%u%n", &width, &height, &length) != 2 || width == 0 || height == 0)
+		{
+			return false;
+		}
+
+		outValues.push_back({ width, height });
+		token += length;
+		token = *token == ',' ? token + 1 : token;
+	}
+
+	return !outValues.empty();
+}
+
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"Usage: light_benchmark [options]\n"
+		"  --leds 18,60,2000         LED counts\n"
+		"  --resolutions 1920x1920   Frame sizes per eye for the sampling stages\n"
+		"  --pattern moving_bars     solid_flash, strobe, gradient, moving_bars or noise\n"
+		"  --iterations 200          Measured iterations per stage\n"
+		"  --warmup 10               Unmeasured iterations before each stage\n"
+		"  --threads 0               Sampling threads, 0 for one per hardware thread\n"
+		"  --output results.json     Write the results to a file instead of stdout\n"
+		"  --replay session.alrec    Sample a recorded session or raw frame file instead of the synthetic frames\n"
+		"  --replay-lag 1            Frames between a replayed frame and its recorded output, more with GPU readback latency\n"
+		"  --replay-exact            Fail unless the replayed session matches its recorded output exactly\n");
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+
+		if (strcmp(arg, "--replay-exact") == 0)
+		{
+			options.bReplayExact = true;
+			continue;
+		}
+
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		bool bValid = value != nullptr;
+
+		if (bValid && strcmp(arg, "--leds") == 0)
+		{
+			bValid = ParseIntList(value, options.LEDCounts);
+		}
+		else if (bValid && strcmp(arg, "--resolutions") == 0)
+		{
+			bValid = ParseResolutionList(value, options.Resolutions);
+		}
+		else if (bValid && strcmp(arg, "--pattern") == 0)
+		{
+			auto iter = std::find_if(std::begin(g_patternNames), std::end(g_patternNames), [&](const char* name) { return strcmp(name, value) == 0; });
+			options.Pattern = (int)(iter - std::begin(g_patternNames));
+			bValid = iter != std::end(g_patternNames);
+		}
+		else if (bValid && strcmp(arg, "--iterations") == 0)
+		{
+			options.Iterations = atoi(value);
+			bValid = options.Iterations > 0;
+		}
+		else if (bValid && strcmp(arg, "--warmup") == 0)
+		{
+			options.WarmupIterations = atoi(value);
+			bValid = options.WarmupIterations >= 0;
+		}
+		else if (bValid && strcmp(arg, "--threads") == 0)
+		{
+			options.Threads = atoi(value);
+			bValid = options.Threads >= 0;
+		}
+		else if (bValid && strcmp(arg, "--output") == 0)
+		{
+			options.OutputPath = value;
+		}
+		else if (bValid && strcmp(arg, "--replay") == 0)
+		{
+			options.ReplayPath = value;
+		}
+		else if (bValid && strcmp(arg, "--replay-lag") == 0)
+		{
+			options.ReplayLag = atoi(value);
+			bValid = options.ReplayLag > 0;
+		}
+		else
+		{
+			bValid = false;
+		}
+
+		if (!bValid)
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		i++;
+	}
+
+	std::vector<BenchmarkResult> results;
+
+	if (!options.ReplayPath.empty())
+	{
+		if (!RunReplayBenchmarks(options, results))
+		{
+			return 1;
+		}
+	}
+	else
+	{
+		for (int numLEDs : options.LEDCounts)
+		{
+			fprintf(stderr, "Running %d LEDs...\n", numLEDs);
+
+			RunSamplingBenchmarks(options, numLEDs, results);
+			RunColorBenchmarks(options, numLEDs, results);
+		}
+	}
+
+	FILE* file = options.OutputPath.empty() ? stdout : fopen(options.OutputPath.c_str(), "w");
+
+	if (!file)
+	{
+		fprintf(stderr, "Failed to open %s\n", options.OutputPath.c_str());
+		return 1;
+	}
+
+	// Matches the thread count the CPU renderer picks.
+	const int numThreads = options.Threads > 0 ? options.Threads : std::max((int)std::thread::hardware_concurrency(), 1);
+
+	WriteResults(file, options, numThreads, results);
+
+	if (file != stdout)
+	{
+		fclose(file);
+	}
+
+	return 0;
+}
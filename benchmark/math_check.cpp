@@ -0,0 +1,223 @@
+// Sweeps the approximate math functions in mathutil.h against the standard library, and checks the maximum errors
+// against the bounds documented there. Single precision cube roots are swept exhaustively over their input range,
+// the other functions over evenly strided bit patterns. Returns a nonzero exit code if any bound is exceeded.
+
+#include "mathutil.h"
+
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+
+// Input ranges of the sweeps, matching the ranges used by the color conversions.
+#define CBRT_SWEEP_MIN 0.008
+#define CBRT_SWEEP_MAX 2.0
+#define POW_SWEEP_MIN 1e-6
+#define POW_SWEEP_MAX 4.0
+#define POW_SWEEP_MIN_EXPONENT 0.25
+#define POW_SWEEP_MAX_EXPONENT 10.0
+
+// Bit patterns skipped between the inputs of the strided sweeps.
+#define CBRT_DOUBLE_STRIDE (1ull << 32)
+#define POW_FLOAT_STRIDE 1024
+#define POW_DOUBLE_STRIDE (1ull << 42)
+#define NUM_POW_EXPONENTS 79
+
+// Steps per channel of the linear RGB grid the color conversions are checked over.
+#define COLOR_SWEEP_STEPS 128
+
+
+// Documented bounds, in units in the last place of the result.
+struct ULPBounds
+{
+	double Fast;
+	double Fastest;
+};
+
+static constexpr ULPBounds g_cbrtFloatBounds = { 15.0, 11100.0 };
+static constexpr ULPBounds g_cbrtDoubleBounds = { 5300.0, 5.5e9 };
+static constexpr ULPBounds g_powFloatBounds = { 128.0, 128.0 };
+static constexpr ULPBounds g_powDoubleBounds = { 1.0e8, 1.0e8 };
+
+// Documented bounds of the CIELAB and Oklab conversions, in deltaE.
+static constexpr ULPBounds g_labDeltaEBounds = { 1e-9, 1e-3 };
+static constexpr ULPBounds g_oklabDeltaEBounds = { 1e-11, 1e-5 };
+
+
+static bool g_bPassed = true;
+
+
+// Distance in representable values between two finite positive numbers.
+static double ULPDistance(float value, float reference)
+{
+	return (double)std::abs((int64_t)std::bit_cast<uint32_t>(value) - (int64_t)std::bit_cast<uint32_t>(reference));
+}
+
+static double ULPDistance(double value, double reference)
+{
+	const int64_t a = std::bit_cast<int64_t>(value);
+	const int64_t b = std::bit_cast<int64_t>(reference);
+
+	return a > b ? (double)(uint64_t)(a - b) : (double)(uint64_t)(b - a);
+}
+
+// References in the next wider precision, rounded to the type being checked.
+// Long double is the same as double on MSVC, so the double bounds are only tight with GCC and Clang on x86.
+static float ReferenceCbrt(float x)
+{
+	return (float)std::cbrt((double)x);
+}
+
+static double ReferenceCbrt(double x)
+{
+	return (double)std::cbrt((long double)x);
+}
+
+static float ReferencePow(float x, float y)
+{
+	return (float)std::pow((double)x, (double)y);
+}
+
+static double ReferencePow(double x, double y)
+{
+	return (double)std::pow((long double)x, (long double)y);
+}
+
+static void Report(const char* name, double maxError, double bound, const char* unit)
+{
+	const bool bPassed = maxError <= bound;
+	g_bPassed = g_bPassed && bPassed;
+
+	printf("%-4s %-28s max error %-12.4g bound %-10.4g %s\n", bPassed ? "ok" : "FAIL", name, maxError, bound, unit);
+}
+
+
+// Calls the function for every bit pattern between the two values, skipping the given number of patterns in between.
+template<typename T, typename Bits, typename Function>
+static void SweepBitPatterns(T minValue, T maxValue, Bits stride, const Function& function)
+{
+	const Bits first = std::bit_cast<Bits>(minValue);
+	const Bits last = std::bit_cast<Bits>(maxValue);
+
+	for (Bits bits = first; bits <= last; bits += stride)
+	{
+		function(std::bit_cast<T>(bits));
+
+		if (last - bits < stride)
+		{
+			break;
+		}
+	}
+}
+
+static void CheckCbrt()
+{
+	double maxFastError = 0.0;
+	double maxFastestError = 0.0;
+
+	SweepBitPatterns((float)CBRT_SWEEP_MIN, (float)CBRT_SWEEP_MAX, (uint32_t)1, [&](float x)
+	{
+		const float reference = ReferenceCbrt(x);
+		maxFastError = std::fmax(maxFastError, ULPDistance(Cbrt<EMathPrecision::Fast>(x), reference));
+		maxFastestError = std::fmax(maxFastestError, ULPDistance(Cbrt<EMathPrecision::Fastest>(x), reference));
+	});
+
+	Report("cbrt float fast", maxFastError, g_cbrtFloatBounds.Fast, "ulp");
+	Report("cbrt float fastest", maxFastestError, g_cbrtFloatBounds.Fastest, "ulp");
+
+	maxFastError = 0.0;
+	maxFastestError = 0.0;
+
+	SweepBitPatterns(CBRT_SWEEP_MIN, CBRT_SWEEP_MAX, (uint64_t)CBRT_DOUBLE_STRIDE, [&](double x)
+	{
+		const double reference = ReferenceCbrt(x);
+		maxFastError = std::fmax(maxFastError, ULPDistance(Cbrt<EMathPrecision::Fast>(x), reference));
+		maxFastestError = std::fmax(maxFastestError, ULPDistance(Cbrt<EMathPrecision::Fastest>(x), reference));
+	});
+
+	Report("cbrt double fast", maxFastError, g_cbrtDoubleBounds.Fast, "ulp");
+	Report("cbrt double fastest", maxFastestError, g_cbrtDoubleBounds.Fastest, "ulp");
+}
+
+// Pow is the same for both approximate precisions. The exponent function clamps its input to the single precision
+// exponent range, so results below that are skipped, they are far below the output resolution.
+static void CheckPow()
+{
+	double maxFloatError = 0.0;
+	double maxDoubleError = 0.0;
+
+	for (int i = 0; i < NUM_POW_EXPONENTS; i++)
+	{
+		const double exponent = POW_SWEEP_MIN_EXPONENT + (POW_SWEEP_MAX_EXPONENT - POW_SWEEP_MIN_EXPONENT) * i / (NUM_POW_EXPONENTS - 1);
+
+		SweepBitPatterns((float)POW_SWEEP_MIN, (float)POW_SWEEP_MAX, (uint32_t)POW_FLOAT_STRIDE, [&](float x)
+		{
+			const float reference = ReferencePow(x, (float)exponent);
+
+			if (reference >= FLT_MIN)
+			{
+				maxFloatError = std::fmax(maxFloatError, ULPDistance(Pow<EMathPrecision::Fast>(x, (float)exponent), reference));
+			}
+		});
+
+		SweepBitPatterns(POW_SWEEP_MIN, POW_SWEEP_MAX, (uint64_t)POW_DOUBLE_STRIDE, [&](double x)
+		{
+			const double reference = ReferencePow(x, exponent);
+
+			if (reference >= FLT_MIN)
+			{
+				maxDoubleError = std::fmax(maxDoubleError, ULPDistance(Pow<EMathPrecision::Fast>(x, exponent), reference));
+			}
+		});
+	}
+
+	Report("pow float", maxFloatError, g_powFloatBounds.Fast, "ulp");
+	Report("pow double", maxDoubleError, g_powDoubleBounds.Fast, "ulp");
+}
+
+template<EMathPrecision Precision>
+static void CheckColorConversions(const char* labName, const char* oklabName)
+{
+	double maxLabError = 0.0;
+	double maxOklabError = 0.0;
+
+	for (int b = 0; b <= COLOR_SWEEP_STEPS; b++)
+	{
+		for (int g = 0; g <= COLOR_SWEEP_STEPS; g++)
+		{
+			for (int r = 0; r <= COLOR_SWEEP_STEPS; r++)
+			{
+				const double red = (double)r / COLOR_SWEEP_STEPS;
+				const double green = (double)g / COLOR_SWEEP_STEPS;
+				const double blue = (double)b / COLOR_SWEEP_STEPS;
+
+				double reference[3];
+				double approximate[3];
+
+				LinearRGBtoLAB_D65(red, green, blue, reference[0], reference[1], reference[2]);
+				LinearRGBtoLAB_D65<Precision>(red, green, blue, approximate[0], approximate[1], approximate[2]);
+				maxLabError = std::fmax(maxLabError, std::hypot(approximate[0] - reference[0], approximate[1] - reference[1], approximate[2] - reference[2]));
+
+				LinearRGBtoOklab(red, green, blue, reference[0], reference[1], reference[2]);
+				LinearRGBtoOklab<Precision>(red, green, blue, approximate[0], approximate[1], approximate[2]);
+				maxOklabError = std::fmax(maxOklabError, std::hypot(approximate[0] - reference[0], approximate[1] - reference[1], approximate[2] - reference[2]));
+			}
+		}
+	}
+
+	const bool bFast = Precision == EMathPrecision::Fast;
+	Report(labName, maxLabError, bFast ? g_labDeltaEBounds.Fast : g_labDeltaEBounds.Fastest, "deltaE");
+	Report(oklabName, maxOklabError, bFast ? g_oklabDeltaEBounds.Fast : g_oklabDeltaEBounds.Fastest, "deltaE");
+}
+
+int main()
+{
+	CheckCbrt();
+	CheckPow();
+	CheckColorConversions<EMathPrecision::Fast>("lab fast", "oklab fast");
+	CheckColorConversions<EMathPrecision::Fastest>("lab fastest", "oklab fastest");
+
+	return g_bPassed ? 0 : 1;
+}
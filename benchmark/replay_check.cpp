@@ -0,0 +1,276 @@
+// Records a session of synthetic frames, sample areas and LED colors, and checks that replaying it returns exactly what
+// was recorded, including after seeking. The same frames are also written as a raw frame file and read back through the
+// file and memory frame sources, and a corrupt frame size is checked to be rejected. Leaves the session in the working directory for the light_benchmark replay test.
+// Returns a nonzero exit code if any of the checks fails.
+
+#include "cpu_renderer.h"
+#include "synthetic_frame_source.h"
+#include "session_recording.h"
+#include "replay_frame_source.h"
+#include "file_frame_source.h"
+#include "memory_frame_source.h"
+#include "color_kernels.h"
+#include "color_dither.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+#define CHECK_SESSION_PATH "replay_check.alrec"
+#define CHECK_RAW_FRAMES_PATH "replay_check.alrf"
+#define CHECK_CORRUPT_SESSION_PATH "replay_check_corrupt.alrec"
+
+#define NUM_CHECK_FRAMES 12
+#define CHECK_FRAME_WIDTH 160
+#define CHECK_FRAME_HEIGHT 120
+#define CHECK_FRAME_INTERVAL_MS 11.0f
+
+// Grid of LEDs covering both eyes.
+#define CHECK_AREAS_X 4
+#define CHECK_AREAS_Y 3
+
+
+static bool g_bPassed = true;
+
+
+static void Report(const char* name, bool bPassed)
+{
+	g_bPassed = g_bPassed && bPassed;
+	printf("%-4s %s\n", bPassed ? "ok" : "FAIL", name);
+}
+
+static bool ImagesEqual(const RGBAImageView& image, const RGBAFrame& frame)
+{
+	if (image.Width != frame.Width || image.Height != frame.Height)
+	{
+		return false;
+	}
+
+	for (uint32_t y = 0; y < image.Height; y++)
+	{
+		if (memcmp(image.GetRow(y), frame.GetPixel(0, y), (size_t)image.Width * 4) != 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool OutputsEqual(const std::vector<LEDOutputData>& a, const std::vector<LEDOutputData>& b)
+{
+	return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(LEDOutputData)) == 0;
+}
+
+static bool AreasEqual(const std::vector<LEDSampleArea>& a, const std::vector<LEDSampleArea>& b)
+{
+	return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(LEDSampleArea)) == 0;
+}
+
+// Reads every frame of a source, comparing the images against the expected frames in order.
+static bool ReadsFrames(IFrameSource& source, const std::vector<StereoFrame>& frames)
+{
+	size_t numFrames = 0;
+
+	while (source.WaitFrame(0) == FrameWait_Ready)
+	{
+		RGBAImageView left, right;
+
+		if (numFrames >= frames.size() || !source.GetFrameImages(left, right) ||
+			!ImagesEqual(left, frames[numFrames].Left) || !ImagesEqual(right, frames[numFrames].Right))
+		{
+			return false;
+		}
+
+		numFrames++;
+	}
+
+	return numFrames == frames.size();
+}
+
+int main()
+{
+	std::vector<LEDSampleArea> areas;
+
+	for (uint32_t eye = 0; eye < 2; eye++)
+	{
+		for (int y = 0; y < CHECK_AREAS_Y; y++)
+		{
+			for (int x = 0; x < CHECK_AREAS_X; x++)
+			{
+				areas.push_back(LEDSampleArea((float)x / CHECK_AREAS_X, (float)y / CHECK_AREAS_Y, (x + 1.0f) / CHECK_AREAS_X, (y + 1.0f) / CHECK_AREAS_Y, eye));
+			}
+		}
+	}
+
+	// Frames and the LED colors the light_benchmark replay computes for them, with the default color settings.
+	SyntheticFrameParams frameParams;
+	frameParams.Pattern = SyntheticPattern_Gradient;
+	frameParams.Width = CHECK_FRAME_WIDTH;
+	frameParams.Height = CHECK_FRAME_HEIGHT;
+	frameParams.FrameIntervalMS = CHECK_FRAME_INTERVAL_MS;
+	frameParams.PeriodMS = CHECK_FRAME_INTERVAL_MS * 5.0f;
+
+	SyntheticFrameSource synthetic(frameParams, false);
+	CPURenderer renderer(1);
+
+	if (!synthetic.InitSource() || !renderer.InitRenderer())
+	{
+		fprintf(stderr, "Failed to initialize the synthetic frames\n");
+		return 1;
+	}
+
+	const ColorParams colorParams(ColorGradingSettings(), 1);
+	LEDColorBuffer colorBuffer;
+
+	std::shared_ptr<LEDSampleData> ledData = std::make_shared<LEDSampleData>((int)areas.size());
+	ledData->sampleAreas = areas;
+
+	std::vector<StereoFrame> frames(NUM_CHECK_FRAMES);
+	std::vector<std::vector<LEDOutputData>> outputs(NUM_CHECK_FRAMES);
+
+	for (int i = 0; i < NUM_CHECK_FRAMES; i++)
+	{
+		RGBAImageView left, right;
+		synthetic.WaitFrame(0);
+		synthetic.GetFrameImages(left, right);
+
+		DownscaleImage(left, 0, frames[i].Left);
+		DownscaleImage(right, 0, frames[i].Right);
+
+		renderer.SetFrames(left, right);
+		renderer.Render(ledData);
+
+		std::vector<LEDOutputData16> colors(areas.size());
+		colorBuffer.SetFromShaderOutput(ledData->sampleOutput);
+		GradeColorBatch(colorParams, colorBuffer, colors.data(), (int)areas.size());
+
+		outputs[i].resize(areas.size());
+		TruncateOutputColors(colors.data(), outputs[i].data(), (int)areas.size());
+	}
+
+	// Same order as the sampler thread, each frame followed by its output.
+	{
+		SessionRecorder recorder;
+
+		if (!recorder.Start(CHECK_SESSION_PATH))
+		{
+			fprintf(stderr, "Failed to create %s\n", CHECK_SESSION_PATH);
+			return 1;
+		}
+
+		recorder.RecordSampleAreas(areas, (int)areas.size());
+
+		for (int i = 0; i < NUM_CHECK_FRAMES; i++)
+		{
+			recorder.RecordFrame(frames[i].Left.GetView(), frames[i].Right.GetView(), CHECK_FRAME_INTERVAL_MS);
+			recorder.RecordOutput(outputs[i]);
+		}
+
+		recorder.Stop();
+		Report("session recorded without dropped frames", recorder.GetDroppedFrames() == 0 && !recorder.HasWriteFailed());
+	}
+
+	{
+		ReplayFrameSource replay(CHECK_SESSION_PATH, false, false);
+		Report("session opened", replay.InitSource() && replay.GetNumFrames() == NUM_CHECK_FRAMES);
+
+		bool bFramesEqual = true;
+		bool bAreasEqual = true;
+		bool bOutputsEqual = true;
+		bool bIntervalsEqual = true;
+		int numFrames = 0;
+
+		while (replay.WaitFrame(0) == FrameWait_Ready)
+		{
+			RGBAImageView left, right;
+			std::vector<LEDSampleArea> replayAreas;
+
+			bFramesEqual = bFramesEqual && numFrames < NUM_CHECK_FRAMES && replay.GetFrameImages(left, right) &&
+				ImagesEqual(left, frames[numFrames].Left) && ImagesEqual(right, frames[numFrames].Right);
+
+			// The areas are only handed out with the first frame, and the output recorded before a frame is the previous one's.
+			bAreasEqual = bAreasEqual && replay.GetSampleAreas(replayAreas) == (numFrames == 0) && (numFrames > 0 || AreasEqual(replayAreas, areas));
+			bOutputsEqual = bOutputsEqual && (numFrames == 0 ? replay.GetRecordedOutput().empty() : OutputsEqual(replay.GetRecordedOutput(), outputs[numFrames - 1]));
+			bIntervalsEqual = bIntervalsEqual && replay.GetFrameIntervalMS() == CHECK_FRAME_INTERVAL_MS;
+
+			numFrames++;
+		}
+
+		Report("session frames replayed", bFramesEqual && numFrames == NUM_CHECK_FRAMES);
+		Report("session sample areas replayed", bAreasEqual);
+		Report("session output replayed", bOutputsEqual);
+		Report("session frame intervals replayed", bIntervalsEqual);
+
+		const int seekFrame = NUM_CHECK_FRAMES / 2;
+		RGBAImageView left, right;
+
+		const bool bSeeked = replay.SeekToFrame(seekFrame) && replay.WaitFrame(0) == FrameWait_Ready && replay.GetFrameImages(left, right);
+
+		Report("session seek", bSeeked && ImagesEqual(left, frames[seekFrame].Left) && ImagesEqual(right, frames[seekFrame].Right) &&
+			OutputsEqual(replay.GetRecordedOutput(), outputs[seekFrame - 1]));
+	}
+
+	// A frame size that overflows when multiplied out is rejected instead of reading past the chunk.
+	{
+		FILE* file = fopen(CHECK_SESSION_PATH, "rb");
+		std::vector<uint8_t> data;
+
+		if (file)
+		{
+			fseek(file, 0, SEEK_END);
+			data.resize((size_t)ftell(file));
+			fseek(file, 0, SEEK_SET);
+			data.resize(fread(data.data(), 1, data.size(), file));
+			fclose(file);
+		}
+
+		bool bPatched = false;
+		size_t offset = sizeof(SessionFileHeader);
+
+		while (!bPatched && offset + sizeof(SessionChunkHeader) + sizeof(SessionFrameInfo) <= data.size())
+		{
+			SessionChunkHeader header;
+			memcpy(&header, data.data() + offset, sizeof(header));
+
+			if (header.Type == SessionChunk_Frame)
+			{
+				SessionFrameInfo info;
+				memcpy(&info, data.data() + offset + sizeof(header), sizeof(info));
+				info.Width = 0x80000000;
+				info.Height = 0x80000000;
+				memcpy(data.data() + offset + sizeof(header), &info, sizeof(info));
+				bPatched = true;
+			}
+
+			offset += sizeof(header) + header.Size;
+		}
+
+		file = bPatched ? fopen(CHECK_CORRUPT_SESSION_PATH, "wb") : nullptr;
+		bPatched = file && fwrite(data.data(), 1, data.size(), file) == data.size();
+
+		if (file)
+		{
+			fclose(file);
+		}
+
+		ReplayFrameSource replay(CHECK_CORRUPT_SESSION_PATH, false, false);
+		Report("session oversized frame rejected", bPatched && replay.InitSource() && replay.WaitFrame(0) == FrameWait_EndOfStream);
+	}
+
+	{
+		Report("raw frame file written", WriteRawFrameFile(CHECK_RAW_FRAMES_PATH, frames, CHECK_FRAME_INTERVAL_MS));
+
+		FileFrameSource fileSource(CHECK_RAW_FRAMES_PATH, false, false);
+		Report("raw frame file replayed", fileSource.InitSource() && ReadsFrames(fileSource, frames));
+
+		MemoryFrameSource memorySource(frames, 0.0f, false);
+		Report("memory frames replayed", memorySource.InitSource() && ReadsFrames(memorySource, frames));
+	}
+
+	remove(CHECK_RAW_FRAMES_PATH);
+	remove(CHECK_CORRUPT_SESSION_PATH);
+
+	return g_bPassed ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+// Checks the CPU sampling backend against the reference implementations of the shaders, on synthetic frames.
+// The exact sampling sums 8-bit integers, so the CPU renderer and the summed area table have to match the gather reference
+// bit for bit.
+// The mip pyramid sampling is an approximation. It has to match on uniform frames, otherwise its deviation from the exact
+// average over the random areas is only reported.
+// Returns a nonzero exit code if any of the checks fails.
+
+#include "cpu_renderer.h"
+#include "gather_reference.h"
+#include "summed_area_table.h"
+#include "synthetic_frame_source.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+#define NUM_CHECK_FRAMES 4
+#define NUM_RANDOM_AREAS 200
+
+// Taps per axis of the mip pyramid sampling, the default of the settings.
+#define CHECK_MIP_TAPS 4
+
+// Allowed mip sampling error on uniform frames, from the single precision filtering.
+#define UNIFORM_MIP_ERROR_BOUND 1e-6
+
+
+struct CheckFrameSize
+{
+	uint32_t Width;
+	uint32_t Height;
+};
+
+// Includes sizes that aren't multiples of the tile size.
+static constexpr CheckFrameSize g_frameSizes[] = { { 1024, 1024 }, { 997, 731 }, { 64, 48 } };
+
+static const char* g_patternNames[] = { "solid_flash", "strobe", "gradient", "moving_bars", "noise" };
+
+
+// The edge cases the gather plan has to handle, followed by random areas anywhere in either eye.
+// Returns the number of edge cases, the mip sampling doesn't treat empty or inverted areas the same way.
+static size_t BuildCheckAreas(std::vector<LEDSampleArea>& outAreas)
+{
+	outAreas.clear();
+
+	outAreas.push_back(LEDSampleArea(0.0f, 0.0f, 1.0f, 1.0f, 0));
+	outAreas.push_back(LEDSampleArea(0.0f, 0.0f, 1.0f, 1.0f, 1));
+	outAreas.push_back(LEDSampleArea(-0.5f, -0.5f, 1.5f, 1.5f, 0));
+	outAreas.push_back(LEDSampleArea(0.5f, 0.5f, 0.5f, 0.5f, 1));
+	outAreas.push_back(LEDSampleArea(0.3f, 0.3f, 0.3001f, 0.3001f, 0));
+	outAreas.push_back(LEDSampleArea(0.9f, 0.1f, 0.1f, 0.9f, 1));
+	outAreas.push_back(LEDSampleArea(0.999f, 0.999f, 1.0f, 1.0f, 0));
+
+	const size_t numEdgeCases = outAreas.size();
+
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+	for (int i = 0; i < NUM_RANDOM_AREAS; i++)
+	{
+		float x = distribution(random);
+		float y = distribution(random);
+		float width = distribution(random) * 0.5f;
+		float height = distribution(random) * 0.5f;
+
+		outAreas.push_back(LEDSampleArea(x, y, x + width, y + height, i & 1));
+	}
+
+	return numEdgeCases;
+}
+
+int main()
+{
+	std::vector<LEDSampleArea> areas;
+	const size_t numEdgeCases = BuildCheckAreas(areas);
+
+	CPURenderer renderer;
+
+	if (!renderer.InitRenderer())
+	{
+		fprintf(stderr, "Failed to initialize the CPU renderer\n");
+		return 1;
+	}
+
+	bool bPassed = true;
+
+	for (const CheckFrameSize& size : g_frameSizes)
+	{
+		for (int pattern = SyntheticPattern_SolidFlash; pattern <= SyntheticPattern_Noise; pattern++)
+		{
+			SyntheticFrameParams frameParams;
+			frameParams.Pattern = pattern;
+			frameParams.Width = size.Width;
+			frameParams.Height = size.Height;
+			frameParams.PeriodMS = 100.0f;
+
+			SyntheticFrameSource source(frameParams, false);
+
+			if (!source.InitSource())
+			{
+				fprintf(stderr, "Failed to initialize the %s pattern\n", g_patternNames[pattern]);
+				return 1;
+			}
+
+			std::shared_ptr<LEDSampleData> ledData = std::make_shared<LEDSampleData>((int)areas.size());
+			ledData->sampleAreas = areas;
+
+			double maxRendererError = 0.0;
+			double maxSummedAreaError = 0.0;
+			double maxMipError = 0.0;
+
+			for (int frame = 0; frame < NUM_CHECK_FRAMES; frame++)
+			{
+				RGBAImageView left, right;
+				source.WaitFrame(0);
+				source.GetFrameImages(left, right);
+
+				renderer.SetFrames(left, right);
+				renderer.Render(ledData);
+
+				CPUFrame leftFrame, rightFrame;
+				CopyToCPUFrame(left, leftFrame);
+				CopyToCPUFrame(right, rightFrame);
+
+				std::vector<LEDShaderOutput> reference;
+				SampleLEDs_Reference(leftFrame, rightFrame, areas, reference);
+
+				SummedAreaTable leftTable, rightTable;
+				leftTable.Build(leftFrame);
+				rightTable.Build(rightFrame);
+
+				std::vector<LEDShaderOutput> summedAreaOutput;
+				SampleLEDs_SummedArea(leftTable, rightTable, areas, summedAreaOutput);
+
+				std::vector<CPUFrame> leftMips, rightMips;
+				BuildMipChain_Reference(leftFrame, leftMips);
+				BuildMipChain_Reference(rightFrame, rightMips);
+
+				std::vector<LEDShaderOutput> mipOutput;
+				SampleLEDsMip_Reference(leftMips, rightMips, areas, CHECK_MIP_TAPS, mipOutput);
+
+				maxRendererError = std::max(maxRendererError, MaxSampleError(ledData->sampleOutput, reference));
+				maxSummedAreaError = std::max(maxSummedAreaError, MaxSampleError(summedAreaOutput, reference));
+				mipOutput.erase(mipOutput.begin(), mipOutput.begin() + numEdgeCases);
+				reference.erase(reference.begin(), reference.begin() + numEdgeCases);
+				maxMipError = std::max(maxMipError, MaxSampleError(mipOutput, reference));
+			}
+
+			const bool bCheckPassed = maxRendererError == 0.0;
+			bPassed = bPassed && bCheckPassed;
+
+			printf("%-4s cpu_renderer %-12s %4ux%-4u max error %g\n", bCheckPassed ? "ok" : "FAIL", g_patternNames[pattern], size.Width, size.Height, maxRendererError);
+			const bool bSummedAreaPassed = maxSummedAreaError == 0.0;
+			bPassed = bPassed && bSummedAreaPassed;
+
+			printf("%-4s summed_area  %-12s %4ux%-4u max error %g\n", bSummedAreaPassed ? "ok" : "FAIL", g_patternNames[pattern], size.Width, size.Height, maxSummedAreaError);
+
+			const bool bUniform = pattern == SyntheticPattern_SolidFlash || pattern == SyntheticPattern_Strobe;
+			const bool bMipPassed = !bUniform || maxMipError <= UNIFORM_MIP_ERROR_BOUND;
+			bPassed = bPassed && bMipPassed;
+
+			printf("%-4s mip_%u_taps   %-12s %4ux%-4u max error %.4f\n", bUniform ? (bMipPassed ? "ok" : "FAIL") : "info", CHECK_MIP_TAPS, g_patternNames[pattern], size.Width, size.Height, maxMipError);
+		}
+	}
+
+	return bPassed ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+#include "color_dither.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+// Packs the low bytes of 16 16-bit values and stores them.
+#if defined(__AVX2__)
+static inline void StoreBytes_AVX2(uint8_t* dest, __m256i values)
+{
+	__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(values, values), 0xD8);
+	_mm_storeu_si128((__m128i*)dest, _mm256_castsi256_si128(packed));
+}
+#endif
+
+
+void TruncateOutputColors(const LEDOutputData16* input, LEDOutputData* output, int count)
+{
+	// The colors are tightly packed channels, see the layout assert in structures.h.
+	const uint16_t* source = reinterpret_cast<const uint16_t*>(input);
+	uint8_t* dest = reinterpret_cast<uint8_t*>(output);
+
+	int numChannels = count * 3;
+	int i = 0;
+
+#if defined(__AVX2__)
+	for (; i + 16 <= numChannels; i += 16)
+	{
+		__m256i values = _mm256_loadu_si256((const __m256i*)&source[i]);
+		StoreBytes_AVX2(&dest[i], _mm256_srli_epi16(values, 8));
+	}
+#endif
+
+	for (; i < numChannels; i++)
+	{
+		dest[i] = (uint8_t)(source[i] >> 8);
+	}
+}
+
+
+void TemporalDither::Reset()
+{
+	// Spread the starting error over the 0-255 range with the golden ratio sequence.
+	for (size_t i = 0; i < m_error.size(); i++)
+	{
+		m_error[i] = (uint16_t)((i * 0x9E3779B1u) >> 24 & 0xFF);
+	}
+}
+
+void TemporalDither::Process(const LEDOutputData16* input, LEDOutputData* output, int count)
+{
+	int numChannels = count * 3;
+
+	// Only allocates when the LED count changes.
+	if ((int)m_error.size() != numChannels)
+	{
+		m_error.resize(numChannels);
+		Reset();
+	}
+
+	const uint16_t* source = reinterpret_cast<const uint16_t*>(input);
+	uint8_t* dest = reinterpret_cast<uint8_t*>(output);
+	uint16_t* error = m_error.data();
+
+	// Inputs are at most 255 * 256, so adding up to 255 of carried error never overflows 16 bits.
+	int i = 0;
+
+#if defined(__AVX2__)
+	const __m256i fracMask = _mm256_set1_epi16(0xFF);
+
+	for (; i + 16 <= numChannels; i += 16)
+	{
+		__m256i sum = _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)&source[i]), _mm256_loadu_si256((const __m256i*)&error[i]));
+
+		_mm256_storeu_si256((__m256i*)&error[i], _mm256_and_si256(sum, fracMask));
+		StoreBytes_AVX2(&dest[i], _mm256_srli_epi16(sum, 8));
+	}
+#endif
+
+	for (; i < numChannels; i++)
+	{
+		uint16_t sum = source[i] + error[i];
+
+		error[i] = sum & 0xFF;
+		dest[i] = (uint8_t)(sum >> 8);
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "structures.h"
+
+
+// Converts 8.8 fixed point colors to bytes by truncation, matching the undithered output.
+void TruncateOutputColors(const LEDOutputData16* input, LEDOutputData* output, int count);
+
+
+// Temporal error diffusion to bytes. The fractional part dropped on each frame is carried over to the next one,
+// so over time every LED averages out to the full 8.8 precision instead of collapsing to a few 8-bit steps in dark scenes.
+// The error accumulators are seeded differently per channel so neighboring LEDs don't step in sync.
+class TemporalDither
+{
+public:
+	void Process(const LEDOutputData16* input, LEDOutputData* output, int count);
+	void Reset();
+
+protected:
+	// Fractional error per channel in the low 8 bits, stored as one flat array for vectorized processing.
+	std::vector<uint16_t> m_error;
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include "mathutil.h"
+
+
+// Color space the contrast and saturation adjustments are done in.
+enum EColorAdjustmentSpace
+{
+	ColorSpace_CIELAB = 0,
+	ColorSpace_Oklab = 1
+};
+
+
+// Subset of the main settings that affect the LED output color.
+struct ColorGradingSettings
+{
+	int AdjustmentSpace = ColorSpace_CIELAB;
+
+	float Brightness = 1.0f;
+	float Contrast = 1.0f;
+	float Saturation = 1.0f;
+
+	float MinRed = 0.0f;
+	float MinGreen = 0.0f;
+	float MinBlue = 0.0f;
+
+	float MaxRed = 1.0f;
+	float MaxGreen = 1.0f;
+	float MaxBlue = 1.0f;
+
+	float GammaRed = 2.2f;
+	float GammaGreen = 2.2f;
+	float GammaBlue = 2.2f;
+
+	bool operator==(const ColorGradingSettings& other) const = default;
+};
+
+
+// Immutable color grading parameters with the per-channel factors precomputed.
+// Published by the settings manager and shared between threads, the version changes whenever the settings do.
+struct ColorParams
+{
+	ColorGradingSettings Settings;
+	uint64_t Version = 0;
+
+	int AdjustmentSpace = ColorSpace_CIELAB;
+	float Contrast = 1.0f;
+	float Saturation = 1.0f;
+
+	// Per channel RGB values.
+	float Min[3] = { 0.0f, 0.0f, 0.0f };
+	float Scale[3] = { 1.0f, 1.0f, 1.0f }; // Brightness / (1 - Min)
+	float InvGamma[3] = { 1.0f / 2.2f, 1.0f / 2.2f, 1.0f / 2.2f };
+	float Max[3] = { 1.0f, 1.0f, 1.0f };
+
+	ColorParams() {}
+
+	ColorParams(const ColorGradingSettings& settings, uint64_t version)
+	{
+		Settings = settings;
+		Version = version;
+
+		AdjustmentSpace = settings.AdjustmentSpace;
+		Contrast = settings.Contrast;
+		Saturation = settings.Saturation;
+
+		Min[0] = settings.MinRed;
+		Min[1] = settings.MinGreen;
+		Min[2] = settings.MinBlue;
+
+		Max[0] = settings.MaxRed;
+		Max[1] = settings.MaxGreen;
+		Max[2] = settings.MaxBlue;
+
+		InvGamma[0] = 1.0f / settings.GammaRed;
+		InvGamma[1] = 1.0f / settings.GammaGreen;
+		InvGamma[2] = 1.0f / settings.GammaBlue;
+
+		for (int i = 0; i < 3; i++)
+		{
+			Scale[i] = settings.Brightness / (1.0f - Min[i]);
+		}
+	}
+};
+
+
+// Clamps to the 0-1 range. NaN values from negative gamma bases map to 0.
+inline double SaturateColor(double value)
+{
+	return !(value > 0.0) ? 0.0 : (value > 1.0 ? 1.0 : value);
+}
+
+
+// Gamma curve for a single channel, with negative bases mapping to 0.
+template<EMathPrecision Precision = EMathPrecision::Exact>
+inline double GradeChannel(const ColorParams& params, int channel, double value)
+{
+	double base = (value - params.Min[channel]) * params.Scale[channel];
+
+	return base > 0.0 ? SaturateColor(Pow<Precision>(base, (double)params.InvGamma[channel]) * params.Max[channel]) : 0.0;
+}
+
+
+// Contrast and saturation adjustment in the selected color space. Takes and returns linear RGB, the output is not clamped.
+// Returns true if the adjusted lightness was clamped.
+template<EMathPrecision Precision = EMathPrecision::Exact>
+inline bool AdjustColor(const ColorParams& params, double inRed, double inGreen, double inBlue, double& red, double& green, double& blue)
+{
+	double L, a, b;
+	bool bClamped;
+
+	if (params.AdjustmentSpace == ColorSpace_Oklab)
+	{
+		LinearRGBtoOklab<Precision>(inRed, inGreen, inBlue, L, a, b);
+
+		L = (L - 0.5) * params.Contrast + 0.5;
+		bClamped = L < 0.0 || L > 1.0;
+		L = L < 0.0 ? 0.0 : (L > 1.0 ? 1.0 : L);
+		a *= params.Saturation;
+		b *= params.Saturation;
+
+		OklabtoLinearRGB(L, a, b, red, green, blue);
+	}
+	else
+	{
+		LinearRGBtoLAB_D65<Precision>(inRed, inGreen, inBlue, L, a, b);
+
+		L = (L - 50.0) * params.Contrast + 50.0;
+		bClamped = L < 0.0 || L > 100.0;
+		L = L < 0.0 ? 0.0 : (L > 100.0 ? 100.0 : L);
+		a *= params.Saturation;
+		b *= params.Saturation;
+
+		LABtoLinearRGB_D65<Precision>(L, a, b, red, green, blue);
+	}
+
+	return bClamped;
+}
+
+
+// Reference implementation of the LED color grading. Takes linear RGB input, outputs values in the 0-1 range.
+template<EMathPrecision Precision = EMathPrecision::Exact>
+inline void GradeColor(const ColorParams& params, double inRed, double inGreen, double inBlue, double& outRed, double& outGreen, double& outBlue)
+{
+	double red, green, blue;
+	AdjustColor<Precision>(params, inRed, inGreen, inBlue, red, green, blue);
+
+	outRed = GradeChannel<Precision>(params, 0, red);
+	outGreen = GradeChannel<Precision>(params, 1, green);
+	outBlue = GradeChannel<Precision>(params, 2, blue);
+}
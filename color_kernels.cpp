@@ -0,0 +1,468 @@
+
+#include "color_kernels.h"
+
+#include <cfloat>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+
+void GradeColorBatch_Scalar(const ColorParams& params, const LEDColorBuffer& input, LEDOutputData16* output, int start, int end)
+{
+	for (int i = start; i < end; i++)
+	{
+		double red, green, blue;
+		GradeColor<EMathPrecision::Fast>(params, input.r[i], input.g[i], input.b[i], red, green, blue);
+
+		output[i].r = (uint16_t)(red * 255.0 * 256.0);
+		output[i].g = (uint16_t)(green * 255.0 * 256.0);
+		output[i].b = (uint16_t)(blue * 255.0 * 256.0);
+	}
+}
+
+
+#if defined(__AVX2__)
+
+// Cube root via exponent bit hack, refined with two Newton steps. Only valid for positive inputs.
+static inline __m256 Cbrt_AVX2(__m256 x)
+{
+	__m256i bits = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_castps_si256(x)), _mm256_set1_ps(1.0f / 3.0f)));
+	__m256 y = _mm256_castsi256_ps(_mm256_add_epi32(bits, _mm256_set1_epi32(709921077)));
+
+	const __m256 oneThird = _mm256_set1_ps(1.0f / 3.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+
+	for (int i = 0; i < 2; i++)
+	{
+		__m256 y2 = _mm256_mul_ps(y, y);
+		y = _mm256_mul_ps(_mm256_fmadd_ps(two, y, _mm256_div_ps(x, y2)), oneThird);
+	}
+
+	return y;
+}
+
+// Base 2 logarithm using the Cephes logf polynomial. Only valid for positive inputs.
+static inline __m256 Log2_AVX2(__m256 x)
+{
+	__m256i bits = _mm256_castps_si256(x);
+	__m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+	__m256 mantissa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f800000)));
+
+	// Shift the mantissa range to [sqrt(0.5), sqrt(2)) to keep the polynomial centered.
+	__m256 isLarge = _mm256_cmp_ps(mantissa, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+	mantissa = _mm256_blendv_ps(mantissa, _mm256_mul_ps(mantissa, _mm256_set1_ps(0.5f)), isLarge);
+	exponent = _mm256_add_ps(exponent, _mm256_and_ps(isLarge, _mm256_set1_ps(1.0f)));
+
+	__m256 m = _mm256_sub_ps(mantissa, _mm256_set1_ps(1.0f));
+	__m256 m2 = _mm256_mul_ps(m, m);
+
+	__m256 p = _mm256_set1_ps(7.0376836292E-2f);
+	p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-1.1514610310E-1f));
+	p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(1.1676998740E-1f));
+	p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-1.2420140846E-1f));
+	p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(1.4249322787E-1f));
+	p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-1.6668057665E-1f));
+	p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(2.0000714765E-1f));
+	p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-2.4999993993E-1f));
+	p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(3.3333331174E-1f));
+	p = _mm256_mul_ps(_mm256_mul_ps(p, m), m2);
+	p = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), m2, p);
+
+	__m256 ln = _mm256_add_ps(m, p);
+
+	return _mm256_fmadd_ps(ln, _mm256_set1_ps(1.44269504f), exponent);
+}
+
+// Base 2 exponent using the Cephes exp2f polynomial.
+static inline __m256 Exp2_AVX2(__m256 x)
+{
+	x = _mm256_max_ps(_mm256_min_ps(x, _mm256_set1_ps(127.0f)), _mm256_set1_ps(-126.0f));
+
+	__m256 n = _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m256 f = _mm256_sub_ps(x, n);
+
+	__m256 p = _mm256_set1_ps(1.535336188319500E-4f);
+	p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.339887440266574E-3f));
+	p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(9.618437357674640E-3f));
+	p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(5.550332471162809E-2f));
+	p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(2.402264791363012E-1f));
+	p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(6.931472028550421E-1f));
+	p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0f));
+
+	__m256i scale = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+
+	return _mm256_mul_ps(p, _mm256_castsi256_ps(scale));
+}
+
+static inline __m256 LabForward_AVX2(__m256 t)
+{
+	__m256 isLinear = _mm256_cmp_ps(t, _mm256_set1_ps(0.008856f), _CMP_LE_OQ);
+	__m256 linear = _mm256_fmadd_ps(t, _mm256_set1_ps(7.787f), _mm256_set1_ps(16.0f / 116.0f));
+	__m256 cubic = Cbrt_AVX2(_mm256_max_ps(t, _mm256_set1_ps(0.008856f)));
+
+	return _mm256_blendv_ps(cubic, linear, isLinear);
+}
+
+static inline __m256 LabInverse_AVX2(__m256 t)
+{
+	__m256 isLinear = _mm256_cmp_ps(t, _mm256_set1_ps(0.206897f), _CMP_LE_OQ);
+	__m256 linear = _mm256_mul_ps(_mm256_sub_ps(t, _mm256_set1_ps(16.0f / 116.0f)), _mm256_set1_ps(1.0f / 7.787f));
+	__m256 cubic = _mm256_mul_ps(_mm256_mul_ps(t, t), t);
+
+	return _mm256_blendv_ps(cubic, linear, isLinear);
+}
+
+static inline __m256 GradeChannel_AVX2(const ColorParams& params, int channel, __m256 value)
+{
+	__m256 base = _mm256_mul_ps(_mm256_sub_ps(value, _mm256_set1_ps(params.Min[channel])), _mm256_set1_ps(params.Scale[channel]));
+	__m256 isPositive = _mm256_cmp_ps(base, _mm256_set1_ps(0.0f), _CMP_GT_OQ);
+
+	__m256 result = Exp2_AVX2(_mm256_mul_ps(Log2_AVX2(_mm256_max_ps(base, _mm256_set1_ps(FLT_MIN))), _mm256_set1_ps(params.InvGamma[channel])));
+	result = _mm256_and_ps(_mm256_mul_ps(result, _mm256_set1_ps(params.Max[channel])), isPositive);
+	result = _mm256_min_ps(_mm256_max_ps(result, _mm256_set1_ps(0.0f)), _mm256_set1_ps(1.0f));
+
+	return _mm256_mul_ps(_mm256_mul_ps(result, _mm256_set1_ps(255.0f)), _mm256_set1_ps(256.0f));
+}
+
+
+// Contrast and saturation adjustment in CIELAB D65, in place on linear RGB.
+static inline void AdjustLAB_AVX2(const ColorParams& params, __m256& red, __m256& green, __m256& blue)
+{
+	const __m256 refX = _mm256_set1_ps((float)(1.0 / D65RefX));
+	const __m256 refZ = _mm256_set1_ps((float)(1.0 / D65RefZ));
+
+	__m256 x = _mm256_fmadd_ps(red, _mm256_set1_ps(0.4124564f), _mm256_fmadd_ps(green, _mm256_set1_ps(0.3575761f), _mm256_mul_ps(blue, _mm256_set1_ps(0.1804375f))));
+	__m256 y = _mm256_fmadd_ps(red, _mm256_set1_ps(0.2126729f), _mm256_fmadd_ps(green, _mm256_set1_ps(0.7151522f), _mm256_mul_ps(blue, _mm256_set1_ps(0.0721750f))));
+	__m256 z = _mm256_fmadd_ps(red, _mm256_set1_ps(0.0193339f), _mm256_fmadd_ps(green, _mm256_set1_ps(0.1191920f), _mm256_mul_ps(blue, _mm256_set1_ps(0.9503041f))));
+
+	x = LabForward_AVX2(_mm256_mul_ps(x, refX));
+	y = LabForward_AVX2(y);
+	z = LabForward_AVX2(_mm256_mul_ps(z, refZ));
+
+	__m256 L = _mm256_fmsub_ps(y, _mm256_set1_ps(116.0f), _mm256_set1_ps(16.0f));
+	__m256 a = _mm256_mul_ps(_mm256_sub_ps(x, y), _mm256_set1_ps(500.0f * params.Saturation));
+	__m256 b = _mm256_mul_ps(_mm256_sub_ps(y, z), _mm256_set1_ps(200.0f * params.Saturation));
+
+	L = _mm256_fmadd_ps(_mm256_sub_ps(L, _mm256_set1_ps(50.0f)), _mm256_set1_ps(params.Contrast), _mm256_set1_ps(50.0f));
+	L = _mm256_min_ps(_mm256_max_ps(L, _mm256_set1_ps(0.0f)), _mm256_set1_ps(100.0f));
+
+	y = _mm256_mul_ps(_mm256_add_ps(L, _mm256_set1_ps(16.0f)), _mm256_set1_ps(1.0f / 116.0f));
+	x = _mm256_fmadd_ps(a, _mm256_set1_ps(1.0f / 500.0f), y);
+	z = _mm256_fnmadd_ps(b, _mm256_set1_ps(1.0f / 200.0f), y);
+
+	x = _mm256_mul_ps(LabInverse_AVX2(x), _mm256_set1_ps((float)D65RefX));
+	y = LabInverse_AVX2(y);
+	z = _mm256_mul_ps(LabInverse_AVX2(z), _mm256_set1_ps((float)D65RefZ));
+
+	red = _mm256_fmadd_ps(x, _mm256_set1_ps(3.2404542f), _mm256_fmadd_ps(y, _mm256_set1_ps(-1.5371385f), _mm256_mul_ps(z, _mm256_set1_ps(-0.4985314f))));
+	green = _mm256_fmadd_ps(x, _mm256_set1_ps(-0.9692660f), _mm256_fmadd_ps(y, _mm256_set1_ps(1.8760108f), _mm256_mul_ps(z, _mm256_set1_ps(0.0415560f))));
+	blue = _mm256_fmadd_ps(x, _mm256_set1_ps(0.0556434f), _mm256_fmadd_ps(y, _mm256_set1_ps(-0.2040259f), _mm256_mul_ps(z, _mm256_set1_ps(1.0572252f))));
+}
+
+// Contrast and saturation adjustment in Oklab, in place on linear RGB. No piecewise segments, so one cbrt per component and no blends.
+static inline void AdjustOklab_AVX2(const ColorParams& params, __m256& red, __m256& green, __m256& blue)
+{
+	__m256 l = _mm256_fmadd_ps(red, _mm256_set1_ps(0.4122214708f), _mm256_fmadd_ps(green, _mm256_set1_ps(0.5363325363f), _mm256_mul_ps(blue, _mm256_set1_ps(0.0514459929f))));
+	__m256 m = _mm256_fmadd_ps(red, _mm256_set1_ps(0.2119034982f), _mm256_fmadd_ps(green, _mm256_set1_ps(0.6806995451f), _mm256_mul_ps(blue, _mm256_set1_ps(0.1073969566f))));
+	__m256 s = _mm256_fmadd_ps(red, _mm256_set1_ps(0.0883024619f), _mm256_fmadd_ps(green, _mm256_set1_ps(0.2817188376f), _mm256_mul_ps(blue, _mm256_set1_ps(0.6299787005f))));
+
+	l = Cbrt_AVX2(_mm256_max_ps(l, _mm256_set1_ps(FLT_MIN)));
+	m = Cbrt_AVX2(_mm256_max_ps(m, _mm256_set1_ps(FLT_MIN)));
+	s = Cbrt_AVX2(_mm256_max_ps(s, _mm256_set1_ps(FLT_MIN)));
+
+	__m256 L = _mm256_fmadd_ps(l, _mm256_set1_ps(0.2104542553f), _mm256_fmadd_ps(m, _mm256_set1_ps(0.7936177850f), _mm256_mul_ps(s, _mm256_set1_ps(-0.0040720468f))));
+	__m256 a = _mm256_fmadd_ps(l, _mm256_set1_ps(1.9779984951f), _mm256_fmadd_ps(m, _mm256_set1_ps(-2.4285922050f), _mm256_mul_ps(s, _mm256_set1_ps(0.4505937099f))));
+	__m256 b = _mm256_fmadd_ps(l, _mm256_set1_ps(0.0259040371f), _mm256_fmadd_ps(m, _mm256_set1_ps(0.7827717662f), _mm256_mul_ps(s, _mm256_set1_ps(-0.8086757660f))));
+
+	L = _mm256_fmadd_ps(_mm256_sub_ps(L, _mm256_set1_ps(0.5f)), _mm256_set1_ps(params.Contrast), _mm256_set1_ps(0.5f));
+	L = _mm256_min_ps(_mm256_max_ps(L, _mm256_set1_ps(0.0f)), _mm256_set1_ps(1.0f));
+	a = _mm256_mul_ps(a, _mm256_set1_ps(params.Saturation));
+	b = _mm256_mul_ps(b, _mm256_set1_ps(params.Saturation));
+
+	l = _mm256_fmadd_ps(a, _mm256_set1_ps(0.3963377774f), _mm256_fmadd_ps(b, _mm256_set1_ps(0.2158037573f), L));
+	m = _mm256_fmadd_ps(a, _mm256_set1_ps(-0.1055613458f), _mm256_fmadd_ps(b, _mm256_set1_ps(-0.0638541728f), L));
+	s = _mm256_fmadd_ps(a, _mm256_set1_ps(-0.0894841775f), _mm256_fmadd_ps(b, _mm256_set1_ps(-1.2914855480f), L));
+
+	l = _mm256_mul_ps(_mm256_mul_ps(l, l), l);
+	m = _mm256_mul_ps(_mm256_mul_ps(m, m), m);
+	s = _mm256_mul_ps(_mm256_mul_ps(s, s), s);
+
+	red = _mm256_fmadd_ps(l, _mm256_set1_ps(4.0767416621f), _mm256_fmadd_ps(m, _mm256_set1_ps(-3.3077115913f), _mm256_mul_ps(s, _mm256_set1_ps(0.2309699292f))));
+	green = _mm256_fmadd_ps(l, _mm256_set1_ps(-1.2684380046f), _mm256_fmadd_ps(m, _mm256_set1_ps(2.6097574011f), _mm256_mul_ps(s, _mm256_set1_ps(-0.3413193965f))));
+	blue = _mm256_fmadd_ps(l, _mm256_set1_ps(-0.0041960863f), _mm256_fmadd_ps(m, _mm256_set1_ps(-0.7034186147f), _mm256_mul_ps(s, _mm256_set1_ps(1.7076147010f))));
+}
+
+
+void GradeColorBatch(const ColorParams& params, const LEDColorBuffer& input, LEDOutputData16* output, int count)
+{
+	const bool bUseOklab = params.AdjustmentSpace == ColorSpace_Oklab;
+
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 red = _mm256_loadu_ps(&input.r[i]);
+		__m256 green = _mm256_loadu_ps(&input.g[i]);
+		__m256 blue = _mm256_loadu_ps(&input.b[i]);
+
+		if (bUseOklab)
+		{
+			AdjustOklab_AVX2(params, red, green, blue);
+		}
+		else
+		{
+			AdjustLAB_AVX2(params, red, green, blue);
+		}
+
+		alignas(32) int32_t outRed[8];
+		alignas(32) int32_t outGreen[8];
+		alignas(32) int32_t outBlue[8];
+
+		_mm256_store_si256((__m256i*)outRed, _mm256_cvttps_epi32(GradeChannel_AVX2(params, 0, red)));
+		_mm256_store_si256((__m256i*)outGreen, _mm256_cvttps_epi32(GradeChannel_AVX2(params, 1, green)));
+		_mm256_store_si256((__m256i*)outBlue, _mm256_cvttps_epi32(GradeChannel_AVX2(params, 2, blue)));
+
+		for (int j = 0; j < 8; j++)
+		{
+			output[i + j].r = (uint16_t)outRed[j];
+			output[i + j].g = (uint16_t)outGreen[j];
+			output[i + j].b = (uint16_t)outBlue[j];
+		}
+	}
+
+	GradeColorBatch_Scalar(params, input, output, i, count);
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+// SSE2 versions of the AVX2 functions above, for CPUs without AVX2. Same approximations, without FMA or blend instructions.
+
+static inline __m128 Select_SSE(__m128 a, __m128 b, __m128 mask)
+{
+	return _mm_or_ps(_mm_andnot_ps(mask, a), _mm_and_ps(mask, b));
+}
+
+// Cube root via exponent bit hack, refined with two Newton steps. Only valid for positive inputs.
+static inline __m128 Cbrt_SSE(__m128 x)
+{
+	__m128i bits = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(x)), _mm_set1_ps(1.0f / 3.0f)));
+	__m128 y = _mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(709921077)));
+
+	const __m128 oneThird = _mm_set1_ps(1.0f / 3.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	for (int i = 0; i < 2; i++)
+	{
+		__m128 y2 = _mm_mul_ps(y, y);
+		y = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(two, y), _mm_div_ps(x, y2)), oneThird);
+	}
+
+	return y;
+}
+
+// Base 2 logarithm using the Cephes logf polynomial. Only valid for positive inputs.
+static inline __m128 Log2_SSE(__m128 x)
+{
+	__m128i bits = _mm_castps_si128(x);
+	__m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+	__m128 mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+
+	// Shift the mantissa range to [sqrt(0.5), sqrt(2)) to keep the polynomial centered.
+	__m128 isLarge = _mm_cmpgt_ps(mantissa, _mm_set1_ps(1.41421356f));
+	mantissa = Select_SSE(mantissa, _mm_mul_ps(mantissa, _mm_set1_ps(0.5f)), isLarge);
+	exponent = _mm_add_ps(exponent, _mm_and_ps(isLarge, _mm_set1_ps(1.0f)));
+
+	__m128 m = _mm_sub_ps(mantissa, _mm_set1_ps(1.0f));
+	__m128 m2 = _mm_mul_ps(m, m);
+
+	__m128 p = _mm_set1_ps(7.0376836292E-2f);
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-1.1514610310E-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(1.1676998740E-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-1.2420140846E-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(1.4249322787E-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-1.6668057665E-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(2.0000714765E-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-2.4999993993E-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(3.3333331174E-1f));
+	p = _mm_mul_ps(_mm_mul_ps(p, m), m2);
+	p = _mm_sub_ps(p, _mm_mul_ps(_mm_set1_ps(0.5f), m2));
+
+	__m128 ln = _mm_add_ps(m, p);
+
+	return _mm_add_ps(_mm_mul_ps(ln, _mm_set1_ps(1.44269504f)), exponent);
+}
+
+// Base 2 exponent using the Cephes exp2f polynomial. Rounds with the default rounding mode, to nearest.
+static inline __m128 Exp2_SSE(__m128 x)
+{
+	x = _mm_max_ps(_mm_min_ps(x, _mm_set1_ps(127.0f)), _mm_set1_ps(-126.0f));
+
+	__m128i rounded = _mm_cvtps_epi32(x);
+	__m128 f = _mm_sub_ps(x, _mm_cvtepi32_ps(rounded));
+
+	__m128 p = _mm_set1_ps(1.535336188319500E-4f);
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.339887440266574E-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.618437357674640E-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.550332471162809E-2f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.402264791363012E-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.931472028550421E-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+	__m128i scale = _mm_slli_epi32(_mm_add_epi32(rounded, _mm_set1_epi32(127)), 23);
+
+	return _mm_mul_ps(p, _mm_castsi128_ps(scale));
+}
+
+static inline __m128 LabForward_SSE(__m128 t)
+{
+	__m128 isLinear = _mm_cmple_ps(t, _mm_set1_ps(0.008856f));
+	__m128 linear = _mm_add_ps(_mm_mul_ps(t, _mm_set1_ps(7.787f)), _mm_set1_ps(16.0f / 116.0f));
+	__m128 cubic = Cbrt_SSE(_mm_max_ps(t, _mm_set1_ps(0.008856f)));
+
+	return Select_SSE(cubic, linear, isLinear);
+}
+
+static inline __m128 LabInverse_SSE(__m128 t)
+{
+	__m128 isLinear = _mm_cmple_ps(t, _mm_set1_ps(0.206897f));
+	__m128 linear = _mm_mul_ps(_mm_sub_ps(t, _mm_set1_ps(16.0f / 116.0f)), _mm_set1_ps(1.0f / 7.787f));
+	__m128 cubic = _mm_mul_ps(_mm_mul_ps(t, t), t);
+
+	return Select_SSE(cubic, linear, isLinear);
+}
+
+static inline __m128 GradeChannel_SSE(const ColorParams& params, int channel, __m128 value)
+{
+	__m128 base = _mm_mul_ps(_mm_sub_ps(value, _mm_set1_ps(params.Min[channel])), _mm_set1_ps(params.Scale[channel]));
+	__m128 isPositive = _mm_cmpgt_ps(base, _mm_set1_ps(0.0f));
+
+	__m128 result = Exp2_SSE(_mm_mul_ps(Log2_SSE(_mm_max_ps(base, _mm_set1_ps(FLT_MIN))), _mm_set1_ps(params.InvGamma[channel])));
+	result = _mm_and_ps(_mm_mul_ps(result, _mm_set1_ps(params.Max[channel])), isPositive);
+	result = _mm_min_ps(_mm_max_ps(result, _mm_set1_ps(0.0f)), _mm_set1_ps(1.0f));
+
+	return _mm_mul_ps(_mm_mul_ps(result, _mm_set1_ps(255.0f)), _mm_set1_ps(256.0f));
+}
+
+// Linear combination of three vectors.
+static inline __m128 Dot_SSE(__m128 x, float a, __m128 y, float b, __m128 z, float c)
+{
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(a)), _mm_mul_ps(y, _mm_set1_ps(b))), _mm_mul_ps(z, _mm_set1_ps(c)));
+}
+
+
+// Contrast and saturation adjustment in CIELAB D65, in place on linear RGB.
+static inline void AdjustLAB_SSE(const ColorParams& params, __m128& red, __m128& green, __m128& blue)
+{
+	__m128 x = Dot_SSE(red, 0.4124564f, green, 0.3575761f, blue, 0.1804375f);
+	__m128 y = Dot_SSE(red, 0.2126729f, green, 0.7151522f, blue, 0.0721750f);
+	__m128 z = Dot_SSE(red, 0.0193339f, green, 0.1191920f, blue, 0.9503041f);
+
+	x = LabForward_SSE(_mm_mul_ps(x, _mm_set1_ps((float)(1.0 / D65RefX))));
+	y = LabForward_SSE(y);
+	z = LabForward_SSE(_mm_mul_ps(z, _mm_set1_ps((float)(1.0 / D65RefZ))));
+
+	__m128 L = _mm_sub_ps(_mm_mul_ps(y, _mm_set1_ps(116.0f)), _mm_set1_ps(16.0f));
+	__m128 a = _mm_mul_ps(_mm_sub_ps(x, y), _mm_set1_ps(500.0f * params.Saturation));
+	__m128 b = _mm_mul_ps(_mm_sub_ps(y, z), _mm_set1_ps(200.0f * params.Saturation));
+
+	L = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(L, _mm_set1_ps(50.0f)), _mm_set1_ps(params.Contrast)), _mm_set1_ps(50.0f));
+	L = _mm_min_ps(_mm_max_ps(L, _mm_set1_ps(0.0f)), _mm_set1_ps(100.0f));
+
+	y = _mm_mul_ps(_mm_add_ps(L, _mm_set1_ps(16.0f)), _mm_set1_ps(1.0f / 116.0f));
+	x = _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(1.0f / 500.0f)), y);
+	z = _mm_sub_ps(y, _mm_mul_ps(b, _mm_set1_ps(1.0f / 200.0f)));
+
+	x = _mm_mul_ps(LabInverse_SSE(x), _mm_set1_ps((float)D65RefX));
+	y = LabInverse_SSE(y);
+	z = _mm_mul_ps(LabInverse_SSE(z), _mm_set1_ps((float)D65RefZ));
+
+	red = Dot_SSE(x, 3.2404542f, y, -1.5371385f, z, -0.4985314f);
+	green = Dot_SSE(x, -0.9692660f, y, 1.8760108f, z, 0.0415560f);
+	blue = Dot_SSE(x, 0.0556434f, y, -0.2040259f, z, 1.0572252f);
+}
+
+// Contrast and saturation adjustment in Oklab, in place on linear RGB.
+static inline void AdjustOklab_SSE(const ColorParams& params, __m128& red, __m128& green, __m128& blue)
+{
+	__m128 l = Dot_SSE(red, 0.4122214708f, green, 0.5363325363f, blue, 0.0514459929f);
+	__m128 m = Dot_SSE(red, 0.2119034982f, green, 0.6806995451f, blue, 0.1073969566f);
+	__m128 s = Dot_SSE(red, 0.0883024619f, green, 0.2817188376f, blue, 0.6299787005f);
+
+	l = Cbrt_SSE(_mm_max_ps(l, _mm_set1_ps(FLT_MIN)));
+	m = Cbrt_SSE(_mm_max_ps(m, _mm_set1_ps(FLT_MIN)));
+	s = Cbrt_SSE(_mm_max_ps(s, _mm_set1_ps(FLT_MIN)));
+
+	__m128 L = Dot_SSE(l, 0.2104542553f, m, 0.7936177850f, s, -0.0040720468f);
+	__m128 a = Dot_SSE(l, 1.9779984951f, m, -2.4285922050f, s, 0.4505937099f);
+	__m128 b = Dot_SSE(l, 0.0259040371f, m, 0.7827717662f, s, -0.8086757660f);
+
+	L = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(L, _mm_set1_ps(0.5f)), _mm_set1_ps(params.Contrast)), _mm_set1_ps(0.5f));
+	L = _mm_min_ps(_mm_max_ps(L, _mm_set1_ps(0.0f)), _mm_set1_ps(1.0f));
+	a = _mm_mul_ps(a, _mm_set1_ps(params.Saturation));
+	b = _mm_mul_ps(b, _mm_set1_ps(params.Saturation));
+
+	l = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(0.3963377774f)), _mm_mul_ps(b, _mm_set1_ps(0.2158037573f))), L);
+	m = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(-0.1055613458f)), _mm_mul_ps(b, _mm_set1_ps(-0.0638541728f))), L);
+	s = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(-0.0894841775f)), _mm_mul_ps(b, _mm_set1_ps(-1.2914855480f))), L);
+
+	l = _mm_mul_ps(_mm_mul_ps(l, l), l);
+	m = _mm_mul_ps(_mm_mul_ps(m, m), m);
+	s = _mm_mul_ps(_mm_mul_ps(s, s), s);
+
+	red = Dot_SSE(l, 4.0767416621f, m, -3.3077115913f, s, 0.2309699292f);
+	green = Dot_SSE(l, -1.2684380046f, m, 2.6097574011f, s, -0.3413193965f);
+	blue = Dot_SSE(l, -0.0041960863f, m, -0.7034186147f, s, 1.7076147010f);
+}
+
+
+void GradeColorBatch(const ColorParams& params, const LEDColorBuffer& input, LEDOutputData16* output, int count)
+{
+	const bool bUseOklab = params.AdjustmentSpace == ColorSpace_Oklab;
+
+	int i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 red = _mm_loadu_ps(&input.r[i]);
+		__m128 green = _mm_loadu_ps(&input.g[i]);
+		__m128 blue = _mm_loadu_ps(&input.b[i]);
+
+		if (bUseOklab)
+		{
+			AdjustOklab_SSE(params, red, green, blue);
+		}
+		else
+		{
+			AdjustLAB_SSE(params, red, green, blue);
+		}
+
+		alignas(16) int32_t outRed[4];
+		alignas(16) int32_t outGreen[4];
+		alignas(16) int32_t outBlue[4];
+
+		_mm_store_si128((__m128i*)outRed, _mm_cvttps_epi32(GradeChannel_SSE(params, 0, red)));
+		_mm_store_si128((__m128i*)outGreen, _mm_cvttps_epi32(GradeChannel_SSE(params, 1, green)));
+		_mm_store_si128((__m128i*)outBlue, _mm_cvttps_epi32(GradeChannel_SSE(params, 2, blue)));
+
+		for (int j = 0; j < 4; j++)
+		{
+			output[i + j].r = (uint16_t)outRed[j];
+			output[i + j].g = (uint16_t)outGreen[j];
+			output[i + j].b = (uint16_t)outBlue[j];
+		}
+	}
+
+	GradeColorBatch_Scalar(params, input, output, i, count);
+}
+
+#else
+
+void GradeColorBatch(const ColorParams& params, const LEDColorBuffer& input, LEDOutputData16* output, int count)
+{
+	GradeColorBatch_Scalar(params, input, output, 0, count);
+}
+
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "structures.h"
+#include "color_grading.h"
+
+
+// Converts all LEDs at once from a structure-of-arrays buffer. Uses AVX2 or SSE2 when available, with approximate
+// cube root and power functions. Results are typically within one 8-bit step of the reference implementation.
+// Outputs 8.8 fixed point colors for the final truncation or dithering pass.
+void GradeColorBatch(const ColorParams& params, const LEDColorBuffer& input, LEDOutputData16* output, int count);
+
+// Scalar fallback for the LEDs from start up to end, using the reference implementation with the fast math functions.
+void GradeColorBatch_Scalar(const ColorParams& params, const LEDColorBuffer& input, LEDOutputData16* output, int start, int end);
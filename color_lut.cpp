@@ -0,0 +1,289 @@
+#include "color_lut.h"
+
+#include <cfloat>
+#include <cmath>
+
+// Cells with a larger estimated error are graded analytically, in 8-bit output steps.
+// The estimate is conservative, measured errors stay under half of it.
+#define COLOR_LUT_CELL_TOLERANCE 0.75
+
+
+static inline float LUTCoordinate(double value)
+{
+	float clamped = (float)SaturateColor(value);
+	return sqrtf(clamped) * (COLOR_LUT_SIZE - 1);
+}
+
+static inline void SplitCoordinate(float coord, int& index, float& frac)
+{
+	index = (int)coord;
+	index = index > COLOR_LUT_SIZE - 2 ? COLOR_LUT_SIZE - 2 : index;
+	frac = coord - index;
+}
+
+// Signed square root, which interpolates neutral colors exactly and keeps resolution near black.
+static inline float EncodeAdjusted(double value)
+{
+	return (float)(value < 0.0 ? -sqrt(-value) : sqrt(value));
+}
+
+static inline float DecodeAdjusted(float value)
+{
+	return value * fabsf(value);
+}
+
+
+ColorLUT::ColorLUT()
+{
+	m_table.resize(COLOR_LUT_SIZE * COLOR_LUT_SIZE * COLOR_LUT_SIZE * 3);
+	m_exactCells.resize((COLOR_LUT_SIZE - 1) * (COLOR_LUT_SIZE - 1) * (COLOR_LUT_SIZE - 1));
+
+	for (int i = 0; i < 3; i++)
+	{
+		m_curves[i].resize(COLOR_CURVE_SIZE + 1);
+	}
+}
+
+inline int ColorLUT::SampleAdjusted(double red, double green, double blue, float* outAdjusted) const
+{
+	int r, g, b;
+	float fr, fg, fb;
+
+	SplitCoordinate(LUTCoordinate(red), r, fr);
+	SplitCoordinate(LUTCoordinate(green), g, fg);
+	SplitCoordinate(LUTCoordinate(blue), b, fb);
+
+	constexpr int strideG = COLOR_LUT_SIZE * 3;
+	constexpr int strideB = COLOR_LUT_SIZE * COLOR_LUT_SIZE * 3;
+
+	const float* c000 = &m_table[(r + g * COLOR_LUT_SIZE + b * COLOR_LUT_SIZE * COLOR_LUT_SIZE) * 3];
+	const float* c100 = c000 + 3;
+	const float* c010 = c000 + strideG;
+	const float* c110 = c010 + 3;
+	const float* c001 = c000 + strideB;
+	const float* c101 = c001 + 3;
+	const float* c011 = c001 + strideG;
+	const float* c111 = c011 + 3;
+
+	for (int i = 0; i < 3; i++)
+	{
+		float x00 = c000[i] + (c100[i] - c000[i]) * fr;
+		float x10 = c010[i] + (c110[i] - c010[i]) * fr;
+		float x01 = c001[i] + (c101[i] - c001[i]) * fr;
+		float x11 = c011[i] + (c111[i] - c011[i]) * fr;
+
+		float y0 = x00 + (x10 - x00) * fg;
+		float y1 = x01 + (x11 - x01) * fg;
+
+		outAdjusted[i] = DecodeAdjusted(y0 + (y1 - y0) * fb);
+	}
+
+	return r + g * (COLOR_LUT_SIZE - 1) + b * (COLOR_LUT_SIZE - 1) * (COLOR_LUT_SIZE - 1);
+}
+
+inline float ColorLUT::ApplyCurve(int channel, float adjusted) const
+{
+	float base = (adjusted - m_params.Min[channel]) * m_curveScale[channel];
+
+	if (!(base > 0.0f))
+	{
+		return 0.0f;
+	}
+
+	float coord = sqrtf(sqrtf(fminf(base, 1.0f))) * COLOR_CURVE_SIZE;
+	int index = (int)coord;
+	index = index > COLOR_CURVE_SIZE - 1 ? COLOR_CURVE_SIZE - 1 : index;
+	float frac = coord - index;
+
+	const float* curve = m_curves[channel].data();
+
+	return curve[index] + (curve[index + 1] - curve[index]) * frac;
+}
+
+void ColorLUT::Build(const ColorParams& params)
+{
+	m_params = params;
+
+	float* entry = m_table.data();
+	double maxAdjusted[3] = { 0.0, 0.0, 0.0 };
+
+	// Nodes where the adjusted lightness is clamped, the adjustment has a kink between these and the other nodes.
+	std::vector<uint8_t> clampedNodes(COLOR_LUT_SIZE * COLOR_LUT_SIZE * COLOR_LUT_SIZE);
+	uint8_t* clamped = clampedNodes.data();
+
+	for (int b = 0; b < COLOR_LUT_SIZE; b++)
+	{
+		double blue = (double)b / (COLOR_LUT_SIZE - 1);
+		blue *= blue;
+
+		for (int g = 0; g < COLOR_LUT_SIZE; g++)
+		{
+			double green = (double)g / (COLOR_LUT_SIZE - 1);
+			green *= green;
+
+			for (int r = 0; r < COLOR_LUT_SIZE; r++)
+			{
+				double red = (double)r / (COLOR_LUT_SIZE - 1);
+				red *= red;
+
+				double adjusted[3];
+				*clamped++ = AdjustColor(params, red, green, blue, adjusted[0], adjusted[1], adjusted[2]) ? 1 : 0;
+
+				for (int i = 0; i < 3; i++)
+				{
+					entry[i] = EncodeAdjusted(adjusted[i]);
+					maxAdjusted[i] = fmax(maxAdjusted[i], adjusted[i]);
+				}
+
+				entry += 3;
+			}
+		}
+	}
+
+	for (int channel = 0; channel < 3; channel++)
+	{
+		// The curve ends where the output saturates, or at the largest value the interpolation can return.
+		double range = (maxAdjusted[channel] - params.Min[channel]) * params.Scale[channel];
+
+		if (params.Max[channel] > 0.0f)
+		{
+			range = fmin(range, pow(1.0 / params.Max[channel], 1.0 / params.InvGamma[channel]));
+		}
+
+		range = fmax(range, 1e-6);
+		m_curveScale[channel] = (float)(params.Scale[channel] / range);
+
+		for (int i = 0; i <= COLOR_CURVE_SIZE; i++)
+		{
+			double coord = (double)i / COLOR_CURVE_SIZE;
+			double base = coord * coord * coord * coord * range;
+
+			// Same as GradeChannel(), in terms of the gamma base.
+			m_curves[channel][i] = (float)(SaturateColor(pow(base, (double)params.InvGamma[channel]) * params.Max[channel]) * 255.0);
+		}
+	}
+
+	// Measure the interpolation error of each cell at the center and the face centers, where it is largest.
+	const double halfStep = 0.5 / (COLOR_LUT_SIZE - 1);
+	const double offsets[7][3] = { { 0, 0, 0 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+
+	int numExactCells = 0;
+	m_maxError = 0.0f;
+
+	for (int b = 0; b < COLOR_LUT_SIZE - 1; b++)
+	{
+		for (int g = 0; g < COLOR_LUT_SIZE - 1; g++)
+		{
+			for (int r = 0; r < COLOR_LUT_SIZE - 1; r++)
+			{
+				const int cell = r + g * (COLOR_LUT_SIZE - 1) + b * (COLOR_LUT_SIZE - 1) * (COLOR_LUT_SIZE - 1);
+				const int nodeIndex = r + g * COLOR_LUT_SIZE + b * COLOR_LUT_SIZE * COLOR_LUT_SIZE;
+				const float* node = &m_table[nodeIndex * 3];
+
+				int numClampedCorners = 0;
+				bool bBelowMin[3] = { false, false, false };
+				bool bAboveMin[3] = { false, false, false };
+				float minAdjusted[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+				float maxAdjusted[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+				for (int corner = 0; corner < 8; corner++)
+				{
+					const int cornerIndex = (corner & 1) + ((corner >> 1) & 1) * COLOR_LUT_SIZE + (corner >> 2) * COLOR_LUT_SIZE * COLOR_LUT_SIZE;
+					numClampedCorners += clampedNodes[nodeIndex + cornerIndex];
+
+					for (int i = 0; i < 3; i++)
+					{
+						const float value = DecodeAdjusted(node[cornerIndex * 3 + i]);
+						bBelowMin[i] = bBelowMin[i] || value < params.Min[i];
+						bAboveMin[i] = bAboveMin[i] || value > params.Min[i];
+						minAdjusted[i] = fminf(minAdjusted[i], value);
+						maxAdjusted[i] = fmaxf(maxAdjusted[i], value);
+					}
+				}
+
+				// Cells crossing the lightness clamping or where a channel crosses the min value.
+				bool bExact = numClampedCorners > 0 && numClampedCorners < 8;
+
+				for (int i = 0; i < 3; i++)
+				{
+					bExact = bExact || (bBelowMin[i] && bAboveMin[i]);
+				}
+
+				float adjustedError[3] = { 0.0f, 0.0f, 0.0f };
+
+				for (int point = 0; point < 7 && !bExact; point++)
+				{
+					// Stay just inside the cell on the faces.
+					double coords[3];
+					coords[0] = (r + 0.5) / (COLOR_LUT_SIZE - 1) + offsets[point][0] * (halfStep - 1e-6);
+					coords[1] = (g + 0.5) / (COLOR_LUT_SIZE - 1) + offsets[point][1] * (halfStep - 1e-6);
+					coords[2] = (b + 0.5) / (COLOR_LUT_SIZE - 1) + offsets[point][2] * (halfStep - 1e-6);
+
+					double reference[3];
+					AdjustColor<EMathPrecision::Fast>(params, coords[0] * coords[0], coords[1] * coords[1], coords[2] * coords[2], reference[0], reference[1], reference[2]);
+
+					float adjusted[3];
+					SampleAdjusted(coords[0] * coords[0], coords[1] * coords[1], coords[2] * coords[2], adjusted);
+
+					for (int i = 0; i < 3; i++)
+					{
+						adjustedError[i] = fmaxf(adjustedError[i], fabsf(adjusted[i] - (float)reference[i]));
+					}
+				}
+
+				// The output error is bounded by how much the curve changes over the adjusted error. The curves are monotonic
+				// with the steepest slope at either end of the range of the cell, or right before they saturate.
+				float cellError = 0.0f;
+
+				for (int i = 0; i < 3 && !bExact; i++)
+				{
+					const float error = adjustedError[i];
+					const float curveEnd = params.Min[i] + 1.0f / m_curveScale[i];
+					const float values[3] = { minAdjusted[i], maxAdjusted[i], fminf(fmaxf(curveEnd - error, minAdjusted[i]), maxAdjusted[i]) };
+
+					for (float value : values)
+					{
+						cellError = fmaxf(cellError, ApplyCurve(i, value + error) - ApplyCurve(i, value - error));
+					}
+				}
+
+				bExact = bExact || cellError > COLOR_LUT_CELL_TOLERANCE;
+
+				m_exactCells[cell] = bExact ? 1 : 0;
+
+				if (bExact)
+				{
+					numExactCells++;
+				}
+				else
+				{
+					m_maxError = fmaxf(m_maxError, cellError);
+				}
+			}
+		}
+	}
+
+	m_exactCellFraction = (float)numExactCells / m_exactCells.size();
+	m_bIsBuilt = true;
+}
+
+void ColorLUT::Apply(const LEDShaderOutput& input, LEDOutputData16& output) const
+{
+	float adjusted[3];
+	int cell = SampleAdjusted(input.r, input.g, input.b, adjusted);
+
+	if (m_exactCells[cell])
+	{
+		double red, green, blue;
+		GradeColor<EMathPrecision::Fast>(m_params, input.r, input.g, input.b, red, green, blue);
+
+		output.r = (uint16_t)(red * 255.0 * 256.0);
+		output.g = (uint16_t)(green * 255.0 * 256.0);
+		output.b = (uint16_t)(blue * 255.0 * 256.0);
+		return;
+	}
+
+	output.r = (uint16_t)(ApplyCurve(0, adjusted[0]) * 256.0f);
+	output.g = (uint16_t)(ApplyCurve(1, adjusted[1]) * 256.0f);
+	output.b = (uint16_t)(ApplyCurve(2, adjusted[2]) * 256.0f);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "structures.h"
+#include "color_grading.h"
+
+// Number of nodes per axis. The LUT is indexed in square root encoded space to give dark colors more resolution.
+#define COLOR_LUT_SIZE 33
+
+// Entries in the per-channel output curves.
+#define COLOR_CURVE_SIZE 1024
+
+
+// Lookup tables for the color grading pipeline, rebuilt only when the color settings change.
+//
+// The contrast and saturation adjustment is baked into a 3D grid of unclamped, signed values. The clamping, min, brightness,
+// gamma and max are applied per channel after the interpolation, from 1D curves, so the kinks of the clamping don't get
+// interpolated across. The gamma curve is still too steep to interpolate into where an adjusted channel crosses the min
+// value, grid cells where the interpolation may be off by more than a fraction of a step are graded analytically instead.
+// Those cells make it slower than GradeColorBatch(), which the sampler uses. Kept for the benchmark and accuracy checks.
+class ColorLUT
+{
+public:
+	ColorLUT();
+
+	void Build(const ColorParams& params);
+	bool IsValid(uint64_t paramsVersion) const { return m_bIsBuilt && m_params.Version == paramsVersion; }
+
+	void Apply(const LEDShaderOutput& input, LEDOutputData16& output) const;
+
+	// Estimated bound of the deviation from the analytic path in 8-bit output steps, over the interpolated cells.
+	float GetMaxError() const { return m_maxError; }
+
+	// Fraction of the grid cells that are graded analytically.
+	float GetExactCellFraction() const { return m_exactCellFraction; }
+
+protected:
+
+	int SampleAdjusted(double red, double green, double blue, float* outAdjusted) const;
+	float ApplyCurve(int channel, float adjusted) const;
+
+	bool m_bIsBuilt = false;
+	ColorParams m_params;
+
+	// Interleaved RGB adjusted values, stored as signed square roots.
+	std::vector<float> m_table;
+
+	// Nonzero for cells that are graded analytically.
+	std::vector<uint8_t> m_exactCells;
+
+	// Output values premultiplied to the 0-255 range, indexed by the fourth root of the gamma base.
+	// That keeps the steep start of the curve interpolable for any gamma setting.
+	std::vector<float> m_curves[3];
+	float m_curveScale[3] = { 1.0f, 1.0f, 1.0f };
+
+	float m_maxError = 0.0f;
+	float m_exactCellFraction = 0.0f;
+};
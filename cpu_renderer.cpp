@@ -0,0 +1,265 @@
+#include "cpu_renderer.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+CPURenderer::CPURenderer(int numThreads)
+	: m_numThreads(numThreads)
+{
+
+}
+
+CPURenderer::~CPURenderer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_workerMutex);
+		m_bStopWorkers = true;
+	}
+
+	m_workStarted.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+bool CPURenderer::InitRenderer()
+{
+	if (m_bIsInitalized)
+	{
+		return true;
+	}
+
+	int numThreads = m_numThreads > 0 ? m_numThreads : (int)std::thread::hardware_concurrency();
+	numThreads = numThreads > 1 ? numThreads : 1;
+
+	// The thread calling Render does its share of the work.
+	for (int i = 1; i < numThreads; i++)
+	{
+		m_workers.emplace_back(&CPURenderer::WorkerThread, this);
+	}
+
+	m_bIsInitalized = true;
+
+	return true;
+}
+
+void CPURenderer::SetFrames(const RGBAImageView& left, const RGBAImageView& right)
+{
+	m_frames[0] = left;
+	m_frames[1] = right;
+}
+
+
+// Sums the 8-bit color over one tile of an LED, equal to the gather_light_cs result for the same tile.
+static void SumTile(const RGBAImageView& image, const LEDTileInfo& info, uint32_t tile, uint32_t outSum[3])
+{
+	uint32_t xStart = info.xMin + (tile & 0xFFFF) * GATHER_TILE_PIXELS;
+	uint32_t yStart = info.yMin + (tile >> 16) * GATHER_TILE_PIXELS;
+	uint32_t xEnd = xStart + GATHER_TILE_PIXELS < info.xMax ? xStart + GATHER_TILE_PIXELS : info.xMax;
+	uint32_t yEnd = yStart + GATHER_TILE_PIXELS < info.yMax ? yStart + GATHER_TILE_PIXELS : info.yMax;
+
+	uint32_t width = xEnd - xStart;
+	uint32_t sum[3] = { 0, 0, 0 };
+
+#if defined(__AVX2__)
+
+	// Four pixels per step, widened to 16 bits. Each lane sums at most 32 rows of 8 steps, which can't overflow.
+	__m256i accumulator = _mm256_setzero_si256();
+	uint32_t vectorWidth = width & ~3u;
+
+	for (uint32_t y = yStart; y < yEnd; y++)
+	{
+		const uint8_t* row = image.GetRow(y) + xStart * 4;
+
+		for (uint32_t x = 0; x < vectorWidth; x += 4)
+		{
+			__m128i pixels = _mm_loadu_si128((const __m128i*)(row + x * 4));
+			accumulator = _mm256_add_epi16(accumulator, _mm256_cvtepu8_epi16(pixels));
+		}
+
+		for (uint32_t x = vectorWidth; x < width; x++)
+		{
+			sum[0] += row[x * 4 + 0];
+			sum[1] += row[x * 4 + 1];
+			sum[2] += row[x * 4 + 2];
+		}
+	}
+
+	__m256i lanes32 = _mm256_add_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(accumulator)), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(accumulator, 1)));
+
+	alignas(32) uint32_t lanes[8];
+	_mm256_store_si256((__m256i*)lanes, lanes32);
+
+	for (int c = 0; c < 3; c++)
+	{
+		sum[c] += lanes[c] + lanes[4 + c];
+	}
+
+#else
+
+	for (uint32_t y = yStart; y < yEnd; y++)
+	{
+		const uint8_t* row = image.GetRow(y) + xStart * 4;
+
+		for (uint32_t x = 0; x < width; x++)
+		{
+			sum[0] += row[x * 4 + 0];
+			sum[1] += row[x * 4 + 1];
+			sum[2] += row[x * 4 + 2];
+		}
+	}
+
+#endif
+
+	outSum[0] = sum[0];
+	outSum[1] = sum[1];
+	outSum[2] = sum[2];
+}
+
+// Claims chunks of the work list until it is exhausted, run by the render thread and every worker.
+void CPURenderer::ProcessTiles()
+{
+	const uint32_t numTiles = m_plan.GetNumTiles();
+
+	while (true)
+	{
+		uint32_t first = m_nextTile.fetch_add(CPU_RENDERER_TILES_PER_CHUNK);
+
+		if (first >= numTiles)
+		{
+			break;
+		}
+
+		uint32_t last = first + CPU_RENDERER_TILES_PER_CHUNK < numTiles ? first + CPU_RENDERER_TILES_PER_CHUNK : numTiles;
+
+		for (uint32_t i = first; i < last; i++)
+		{
+			const GatherWorkItem& item = m_plan.WorkItems[i];
+			const LEDTileInfo& info = m_plan.LEDTiles[item.ledID];
+
+			SumTile(m_frames[info.eye == 0 ? 0 : 1], info, item.tile, &m_tileSums[(size_t)i * 3]);
+		}
+	}
+}
+
+void CPURenderer::WorkerThread()
+{
+	uint64_t lastWorkIndex = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_workerMutex);
+			m_workStarted.wait(lock, [&] { return m_bStopWorkers || m_workIndex != lastWorkIndex; });
+
+			if (m_bStopWorkers)
+			{
+				return;
+			}
+
+			lastWorkIndex = m_workIndex;
+		}
+
+		ProcessTiles();
+
+		{
+			std::lock_guard<std::mutex> lock(m_workerMutex);
+
+			if (--m_numBusyWorkers == 0)
+			{
+				m_workDone.notify_one();
+			}
+		}
+	}
+}
+
+
+// Rebuilds the work list only when the frame size or the sample areas have changed.
+void CPURenderer::UpdatePlan(std::shared_ptr<LEDSampleData> ledData)
+{
+	const uint32_t frameWidth = m_frames[0].Width;
+	const uint32_t frameHeight = m_frames[0].Height;
+
+	if (m_bPlanValid && m_planFrameSize[0] == frameWidth && m_planFrameSize[1] == frameHeight &&
+		m_planGeometryVersion == ledData->GeometryVersion && m_planNumLEDs == ledData->NumLEDs && !ledData->IsInputUpdated)
+	{
+		return;
+	}
+
+	m_plan.Build(ledData->sampleAreas, ledData->NumLEDs, frameWidth, frameHeight);
+	m_tileSums.resize((size_t)m_plan.GetNumTiles() * 3);
+
+	m_planFrameSize[0] = frameWidth;
+	m_planFrameSize[1] = frameHeight;
+	m_planGeometryVersion = ledData->GeometryVersion;
+	m_planNumLEDs = ledData->NumLEDs;
+	m_bPlanValid = true;
+
+	ledData->IsInputUpdated = false;
+}
+
+bool CPURenderer::Render(std::shared_ptr<LEDSampleData> ledData)
+{
+	if (!m_bIsInitalized || !m_frames[0].IsValid() || !m_frames[1].IsValid())
+	{
+		return false;
+	}
+
+	// Both eyes are sampled with the pixel bounds computed from the left one, like in the D3D11 renderer.
+	if (m_frames[1].Width != m_frames[0].Width || m_frames[1].Height != m_frames[0].Height)
+	{
+		return false;
+	}
+
+	UpdatePlan(ledData);
+
+	m_nextTile = 0;
+
+	if (!m_workers.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_workerMutex);
+			m_numBusyWorkers = (int)m_workers.size();
+			m_workIndex++;
+		}
+
+		m_workStarted.notify_all();
+	}
+
+	ProcessTiles();
+
+	if (!m_workers.empty())
+	{
+		std::unique_lock<std::mutex> lock(m_workerMutex);
+		m_workDone.wait(lock, [&] { return m_numBusyWorkers == 0; });
+	}
+
+	// Combine the tiles of each LED, they are stored contiguously.
+	for (int i = 0; i < ledData->NumLEDs; i++)
+	{
+		const LEDTileInfo& info = m_plan.LEDTiles[i];
+		const uint32_t numTiles = info.numTilesX * info.numTilesY;
+
+		uint32_t ledSum[3] = { 0, 0, 0 };
+
+		for (uint32_t tile = info.firstTile; tile < info.firstTile + numTiles; tile++)
+		{
+			ledSum[0] += m_tileSums[(size_t)tile * 3 + 0];
+			ledSum[1] += m_tileSums[(size_t)tile * 3 + 1];
+			ledSum[2] += m_tileSums[(size_t)tile * 3 + 2];
+		}
+
+		double numPixels = (double)((info.xMax - info.xMin) * (info.yMax - info.yMin));
+		double divisor = 255.0 * (numPixels > 1.0 ? numPixels : 1.0);
+
+		ledData->sampleOutput[i] = LEDShaderOutput(ledSum[0] / divisor, ledSum[1] / divisor, ledSum[2] / divisor);
+	}
+
+	ledData->IsOutputGraded = false;
+
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "light_renderer.h"
+#include "rgba_frame.h"
+#include "gather_plan.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Number of tiles a worker thread claims at once.
+#define CPU_RENDERER_TILES_PER_CHUNK 8
+
+
+// Software sampling backend, computing the same per-LED averages as the exact gather and combine passes
+// from frames in CPU memory. The tiles of the gather plan are split between a pool of worker threads.
+class CPURenderer : public ILightRenderer
+{
+public:
+
+	// Zero threads uses one per hardware thread, the thread calling Render included.
+	CPURenderer(int numThreads = 0);
+	~CPURenderer();
+
+	bool InitRenderer() override;
+	bool IsIntialized() override { return m_bIsInitalized; }
+	bool Render(std::shared_ptr<LEDSampleData> ledData) override;
+	void SetFrames(const RGBAImageView& left, const RGBAImageView& right) override;
+
+	int GetNumThreads() const { return (int)m_workers.size() + 1; }
+
+protected:
+
+	void UpdatePlan(std::shared_ptr<LEDSampleData> ledData);
+	void WorkerThread();
+	void ProcessTiles();
+
+	bool m_bIsInitalized = false;
+	int m_numThreads = 0;
+
+	RGBAImageView m_frames[2];
+
+	GatherPlan m_plan;
+	bool m_bPlanValid = false;
+	uint32_t m_planFrameSize[2] = { 0, 0 };
+	uint64_t m_planGeometryVersion = 0;
+	int m_planNumLEDs = 0;
+
+	// Color sums of each tile, 3 per tile in the order of the work list.
+	std::vector<uint32_t> m_tileSums;
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_workerMutex;
+	std::condition_variable m_workStarted;
+	std::condition_variable m_workDone;
+	uint64_t m_workIndex = 0;
+	int m_numBusyWorkers = 0;
+	bool m_bStopWorkers = false;
+	std::atomic<uint32_t> m_nextTile = 0;
+};
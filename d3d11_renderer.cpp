@@ -7,10 +7,15 @@
 
 #include "shaders/gather_light_cs.h"
 #include "shaders/combine_light_cs.h"
+#include "shaders/sample_mip_cs.h"
+#include "shaders/summed_area_rows_cs.h"
+#include "shaders/summed_area_columns_cs.h"
+#include "shaders/sample_summed_area_cs.h"
 
 
 
 #include "d3d11_renderer.h"
+#include "profiling.h"
 
 
 RENDERDOC_API_1_6_0* g_renderDocAPI = nullptr;
@@ -24,7 +29,22 @@ struct alignas(16) CSConstantBuffer
 {
 	uint32_t frameSize[2];
 	uint32_t numLEDs;
-	uint32_t LEDStartIndex;
+	uint32_t sampleTaps;
+	uint32_t numWorkItems;
+	uint32_t workGroupsX;
+	uint32_t _pad0[2];
+};
+
+struct alignas(16) CSColorConstantBuffer
+{
+	float contrast;
+	float saturation;
+	uint32_t useOklab;
+	uint32_t gradeColors;
+	float minColor[4];
+	float scale[4];
+	float maxColor[4];
+	float invGamma[4];
 };
 
 
@@ -50,16 +70,7 @@ D3D11Renderer::~D3D11Renderer()
 		debugDevice->Release();
 	}
 	
-	if (m_mirrorSRVLeft)
-	{
-		vr::VRCompositor()->ReleaseMirrorTextureD3D11(m_mirrorSRVLeft);
-		m_mirrorSRVLeft = nullptr;
-	}
-	if (m_mirrorSRVRight)
-	{
-		vr::VRCompositor()->ReleaseMirrorTextureD3D11(m_mirrorSRVRight);
-		m_mirrorSRVRight = nullptr;
-	}
+	ReleaseMirrorTextures();
 }
 
 
@@ -134,6 +145,34 @@ bool D3D11Renderer::InitRenderer()
 	}
 	SET_DXGI_DEBUGNAME(m_combineLightCS);
 
+	if (FAILED(m_device->CreateComputeShader(g_sampleMipCS, sizeof(g_sampleMipCS), nullptr, &m_sampleMipCS)))
+	{
+		g_logger->error("g_sampleMipCS creation failure!");
+		return false;
+	}
+	SET_DXGI_DEBUGNAME(m_sampleMipCS);
+
+	if (FAILED(m_device->CreateComputeShader(g_summedAreaRowsCS, sizeof(g_summedAreaRowsCS), nullptr, &m_summedAreaRowsCS)))
+	{
+		g_logger->error("g_summedAreaRowsCS creation failure!");
+		return false;
+	}
+	SET_DXGI_DEBUGNAME(m_summedAreaRowsCS);
+
+	if (FAILED(m_device->CreateComputeShader(g_summedAreaColumnsCS, sizeof(g_summedAreaColumnsCS), nullptr, &m_summedAreaColumnsCS)))
+	{
+		g_logger->error("g_summedAreaColumnsCS creation failure!");
+		return false;
+	}
+	SET_DXGI_DEBUGNAME(m_summedAreaColumnsCS);
+
+	if (FAILED(m_device->CreateComputeShader(g_sampleSummedAreaCS, sizeof(g_sampleSummedAreaCS), nullptr, &m_sampleSummedAreaCS)))
+	{
+		g_logger->error("g_sampleSummedAreaCS creation failure!");
+		return false;
+	}
+	SET_DXGI_DEBUGNAME(m_sampleSummedAreaCS);
+
 	D3D11_SAMPLER_DESC samplerDesc = {};
 	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
 	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
@@ -160,110 +199,127 @@ bool D3D11Renderer::InitRenderer()
 	}
 	SET_DXGI_DEBUGNAME(m_csConstantBuffer)
 
-	m_bIsInitalized = true;
-	return true;
-}
+	bufferDesc.ByteWidth = Align(sizeof(CSColorConstantBuffer), 16);
 
-bool D3D11Renderer::Render(std::shared_ptr<LEDSampleData> ledData)
-{
+	if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &m_colorConstantBuffer)))
+	{
+		g_logger->error("m_colorConstantBuffer creation failure!");
+		return false;
+	}
+	SET_DXGI_DEBUGNAME(m_colorConstantBuffer)
+
+	D3D11_QUERY_DESC queryDesc = {};
+	queryDesc.Query = D3D11_QUERY_EVENT;
+
+	for (int i = 0; i < READBACK_RING_SIZE; i++)
 	{
-		if (!m_settingsManager->GetSettings_Main().SkipMirrorTextureRelease)
+		if (FAILED(m_device->CreateQuery(&queryDesc, &m_readbackRing[i].CopyDoneQuery)))
 		{
-			if (m_mirrorSRVLeft)
-			{
-				vr::VRCompositor()->ReleaseMirrorTextureD3D11(m_mirrorSRVLeft);
-				m_mirrorSRVLeft = nullptr;
-			}
-			if (m_mirrorSRVRight)
-			{
-				vr::VRCompositor()->ReleaseMirrorTextureD3D11(m_mirrorSRVRight);
-				m_mirrorSRVRight = nullptr;
-			}
+			g_logger->error("Readback query creation failure!");
+			return false;
 		}
+	}
 
-		vr::EVRCompositorError compError;
-
-		compError = vr::VRCompositor()->GetMirrorTextureD3D11(vr::Eye_Left, m_device.Get(), (void**)&m_mirrorSRVLeft);
+	for (int i = 0; i < GPU_TIMING_FRAMES; i++)
+	{
+		queryDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
 
-		if (compError != vr::VRCompositorError_None)
+		if (FAILED(m_device->CreateQuery(&queryDesc, &m_timingRing[i].DisjointQuery)))
 		{
-			g_logger->error("Error getting mirror texture!");
+			g_logger->error("Timestamp disjoint query creation failure!");
 			return false;
 		}
 
-		compError = vr::VRCompositor()->GetMirrorTextureD3D11(vr::Eye_Right, m_device.Get(), (void**)&m_mirrorSRVRight);
+		queryDesc.Query = D3D11_QUERY_TIMESTAMP;
 
-		if (compError != vr::VRCompositorError_None)
+		for (int j = 0; j < GPUTimestamp_Count; j++)
 		{
-			g_logger->error("Error getting mirror texture!");
-			vr::VRCompositor()->ReleaseMirrorTextureD3D11(m_mirrorSRVLeft);
-			m_mirrorSRVLeft = nullptr;
-			return false;
+			if (FAILED(m_device->CreateQuery(&queryDesc, &m_timingRing[i].Timestamps[j])))
+			{
+				g_logger->error("Timestamp query creation failure!");
+				return false;
+			}
 		}
 	}
 
-	uint32_t frameWidth = 1;
-	uint32_t frameHeight = 1;
+	m_bIsInitalized = true;
+	return true;
+}
+
+bool D3D11Renderer::Render(std::shared_ptr<LEDSampleData> ledData)
+{
+	// Without the workaround the textures are released and acquired every frame.
+	// With it they are kept, and only released and acquired again when they may have changed.
+	const bool bCacheMirrorTextures = m_settingsManager->GetSettings_Main().SkipMirrorTextureRelease;
 
+	if (!bCacheMirrorTextures)
 	{
-		ComPtr<ID3D11Resource> res;
-		ComPtr <ID3D11Texture2D> tex;
+		ReleaseMirrorTextures();
+	}
 
-		m_mirrorSRVLeft->GetResource(res.GetAddressOf());
+	if (!bCacheMirrorTextures || m_bMirrorTexturesInvalidated || !m_mirrorSRVLeft || !m_mirrorSRVRight ||
+		EndPerfTimer(m_mirrorTextureAcquireTime) > MIRROR_TEXTURE_REVALIDATE_MS)
+	{
+		// Acquiring again over the cached views would leak the references they hold.
+		ReleaseMirrorTextures();
 
-		if (res.Get() && FAILED(res->QueryInterface(IID_PPV_ARGS(tex.GetAddressOf()))))
+		if (!AcquireMirrorTextures())
 		{
-			vr::VRCompositor()->ReleaseMirrorTextureD3D11(m_mirrorSRVLeft);
-			vr::VRCompositor()->ReleaseMirrorTextureD3D11(m_mirrorSRVRight);
-			m_mirrorSRVLeft = nullptr;
-			m_mirrorSRVRight = nullptr;
-
-			g_logger->error("Querying mirror texture resource failure!");
 			return false;
 		}
-		D3D11_TEXTURE2D_DESC desc = {};
-		tex->GetDesc(&desc);
 
-		frameWidth = desc.Width;
-		frameHeight = desc.Height;
+		m_bMirrorTexturesInvalidated = false;
 	}
 
+	const uint32_t frameWidth = m_mirrorDesc.Width;
+	const uint32_t frameHeight = m_mirrorDesc.Height;
 
-	uint32_t numTiles = 0;
-	uint32_t maxTilesX = 1;
-	uint32_t maxTilesY = 1;
-
-	for (int i = 0; i < ledData->NumLEDs; i++)
-	{
-		uint32_t xMin = (uint32_t)floor(ledData->sampleAreas[i].xMin * frameWidth);
-		uint32_t yMin = (uint32_t)floor(ledData->sampleAreas[i].yMin * frameHeight);
-		uint32_t xMax = (uint32_t)ceil(ledData->sampleAreas[i].xMax * frameWidth);
-		uint32_t yMax = (uint32_t)ceil(ledData->sampleAreas[i].yMax * frameHeight);
+	const int samplingMode = m_settingsManager->GetSettings_Main().SamplingMode;
+	const bool bUseMipPyramid = samplingMode == SamplingMode_MipPyramid;
+	const bool bUseSummedArea = samplingMode == SamplingMode_SummedArea;
+	const bool bGradeColors = m_settingsManager->GetSettings_Main().GPUColorGrading;
 
-		uint32_t numTilesX = (uint32_t)ceil((xMax - xMin) / 32);
-		uint32_t numTilesY = (uint32_t)ceil((yMax - yMin) / 32);
+	UpdateTilePlan(ledData, frameWidth, frameHeight);
 
-		numTiles += numTilesX * numTilesY;
+	if (!ReserveBuffers(ledData->NumLEDs, m_tilePlan.Plan.GetNumTiles()))
+	{
+		ReleaseMirrorTextures();
+		return false;
+	}
 
-		maxTilesX = maxTilesX < numTilesX ? numTilesX : maxTilesX;
-		maxTilesY = maxTilesY < numTilesY ? numTilesY : maxTilesY;
+	if (m_numLEDs != ledData->NumLEDs)
+	{
+		// Results still in flight belong to a different set of LEDs.
+		ResetReadbackRing();
+		m_numLEDs = ledData->NumLEDs;
 	}
 
-	if (m_numLEDs != ledData->NumLEDs || ledData->IsInputUpdated)
+	if (ledData->IsInputUpdated || !m_bSampleAreasUploaded)
 	{
-		if (!CreateBuffers(ledData, numTiles))
+		if (!UploadSampleAreas(ledData))
 		{
-			vr::VRCompositor()->ReleaseMirrorTextureD3D11(m_mirrorSRVLeft);
-			vr::VRCompositor()->ReleaseMirrorTextureD3D11(m_mirrorSRVRight);
-			m_mirrorSRVLeft = nullptr;
-			m_mirrorSRVRight = nullptr;
+			ReleaseMirrorTextures();
 			return false;
 		}
 
-		m_numLEDs = ledData->NumLEDs;
 		ledData->IsInputUpdated = false;
 	}
 
+	if (!m_bTilePlanUploaded && !UploadTilePlan())
+	{
+		ReleaseMirrorTextures();
+		return false;
+	}
+
+	BeginGPUTiming();
+
+	if ((bUseMipPyramid && !UpdateMipPyramid(m_mirrorDesc)) || (bUseSummedArea && !UpdateSummedAreaTable(frameWidth, frameHeight)))
+	{
+		AbortGPUTiming();
+		ReleaseMirrorTextures();
+		return false;
+	}
+
 	m_frameIndex++;
 
 	if (g_renderDocAPI && m_frameIndex == 100)
@@ -271,96 +327,326 @@ bool D3D11Renderer::Render(std::shared_ptr<LEDSampleData> ledData)
 		g_renderDocAPI->StartFrameCapture(m_device.Get(), NULL);
 	}
 
-	m_deviceContext->CSSetShader(m_gatherLightCS.Get(), nullptr, 0);
+	ID3D11ShaderResourceView* SRVs[6] = { m_mirrorSRVLeft, m_lightInputDataSRV.Get(), m_mirrorSRVRight, bUseMipPyramid ? m_mipPyramidSRV.Get() : nullptr,
+		m_ledTileInfoSRV.Get(), m_gatherWorkItemsSRV.Get() };
+	m_deviceContext->CSSetShaderResources(0, 6, SRVs);
+	ID3D11UnorderedAccessView* UAVs[3] = { m_lightIntermediaryUAV.Get() , m_lightOutputDataUAV.Get(), m_lightPackedOutputUAV.Get() };
+	m_deviceContext->CSSetUnorderedAccessViews(0, 3, UAVs, nullptr);
+	ID3D11Buffer* constantBuffers[2] = { m_csConstantBuffer.Get(), m_colorConstantBuffer.Get() };
+	m_deviceContext->CSSetConstantBuffers(0, 2, constantBuffers);
+
+	// Only updated when the settings change, the shaders skip the grading and the packed output while the flag is off.
+	UpdateColorConstants(bGradeColors);
+
+	if (bGradeColors)
+	{
+		const UINT clearValues[4] = { 0, 0, 0, 0 };
+		m_deviceContext->ClearUnorderedAccessViewUint(m_lightPackedOutputUAV.Get(), clearValues);
+	}
 
-	ID3D11ShaderResourceView* SRVs[2] = { m_mirrorSRVLeft , m_lightInputDataSRV.Get() };
-	m_deviceContext->CSSetShaderResources(0, 2, SRVs);
-	ID3D11UnorderedAccessView* UAVs[2] = { m_lightIntermediaryUAV.Get() , m_lightOutputDataUAV.Get()};
-	m_deviceContext->CSSetUnorderedAccessViews(0, 2, UAVs, nullptr);
-	m_deviceContext->CSSetConstantBuffers(0, 1, m_csConstantBuffer.GetAddressOf());
 	m_deviceContext->CSSetSamplers(0, 1, m_bilinearSampler.GetAddressOf());
 
 	CSConstantBuffer csBuffer = {};
 	csBuffer.frameSize[0] = frameWidth;
 	csBuffer.frameSize[1] = frameHeight;
-	csBuffer.numLEDs = ledData->NumLEDs / 2;
-	csBuffer.LEDStartIndex = 0;
+	csBuffer.numLEDs = ledData->NumLEDs;
+	csBuffer.sampleTaps = min(max(m_settingsManager->GetSettings_Main().MipSampleTaps, 1), 8);
+	csBuffer.numWorkItems = m_tilePlan.Plan.GetNumTiles();
+	csBuffer.workGroupsX = m_tilePlan.WorkGroupsX;
 
 	m_deviceContext->UpdateSubresource(m_csConstantBuffer.Get(), 0, nullptr, &csBuffer, 0, 0);
 
-	m_deviceContext->Dispatch(maxTilesX, maxTilesY, ledData->NumLEDs / 2);
-	m_deviceContext->CSSetShader(m_combineLightCS.Get(), nullptr, 0);
-	m_deviceContext->Dispatch(1, 1, ledData->NumLEDs / 2);
+	if (bUseMipPyramid)
+	{
+		WriteGPUTimestamp(GPUTimestamp_Prepare);
 
+		m_deviceContext->CSSetShader(m_sampleMipCS.Get(), nullptr, 0);
+		m_deviceContext->Dispatch((ledData->NumLEDs + 63) / 64, 1, 1);
 
-	SRVs[0] = m_mirrorSRVRight;
-	m_deviceContext->CSSetShaderResources(0, 2, SRVs);
+		WriteGPUTimestamp(GPUTimestamp_Sample);
+		WriteGPUTimestamp(GPUTimestamp_Combine);
+	}
+	else if (bUseSummedArea)
+	{
+		// Prefix sums along the rows then the columns, one group per line and eye.
+		ID3D11UnorderedAccessView* tableUAV = m_summedAreaTableUAV.Get();
+		m_deviceContext->CSSetUnorderedAccessViews(0, 1, &tableUAV, nullptr);
 
-	csBuffer.LEDStartIndex = ledData->NumLEDs / 2;
-	m_deviceContext->UpdateSubresource(m_csConstantBuffer.Get(), 0, nullptr, &csBuffer, 0, 0);
+		m_deviceContext->CSSetShader(m_summedAreaRowsCS.Get(), nullptr, 0);
+		m_deviceContext->Dispatch(frameHeight, 2, 1);
+		m_deviceContext->CSSetShader(m_summedAreaColumnsCS.Get(), nullptr, 0);
+		m_deviceContext->Dispatch(frameWidth, 2, 1);
+
+		WriteGPUTimestamp(GPUTimestamp_Prepare);
+
+		// The table is read as a shader resource in the sampling pass, so it has to be unbound as a UAV first.
+		ID3D11UnorderedAccessView* nullUAV = nullptr;
+		m_deviceContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+		ID3D11ShaderResourceView* tableSRV = m_summedAreaTableSRV.Get();
+		m_deviceContext->CSSetShaderResources(3, 1, &tableSRV);
+
+		m_deviceContext->CSSetShader(m_sampleSummedAreaCS.Get(), nullptr, 0);
+		m_deviceContext->Dispatch((ledData->NumLEDs + 63) / 64, 1, 1);
+
+		WriteGPUTimestamp(GPUTimestamp_Sample);
+		WriteGPUTimestamp(GPUTimestamp_Combine);
+	}
+	else
+	{
+		WriteGPUTimestamp(GPUTimestamp_Prepare);
+
+		// One group per entry in the work list, covering every tile of every LED in both eyes.
+		m_deviceContext->CSSetShader(m_gatherLightCS.Get(), nullptr, 0);
+		m_deviceContext->DispatchIndirect(m_gatherDispatchArgs.Get(), 0);
+
+		WriteGPUTimestamp(GPUTimestamp_Sample);
 
+		m_deviceContext->CSSetShader(m_combineLightCS.Get(), nullptr, 0);
+		m_deviceContext->Dispatch(1, 1, ledData->NumLEDs);
 
-	m_deviceContext->CSSetShader(m_gatherLightCS.Get(), nullptr, 0);
-	m_deviceContext->Dispatch(maxTilesX, maxTilesY, ledData->NumLEDs / 2);
-	m_deviceContext->CSSetShader(m_combineLightCS.Get(), nullptr, 0);
-	m_deviceContext->Dispatch(1, 1, ledData->NumLEDs / 2);
+		WriteGPUTimestamp(GPUTimestamp_Combine);
+	}
 
 
 	m_deviceContext->CSSetShader(nullptr, nullptr, 0);
-	ID3D11ShaderResourceView* nullSRVs[2] = { nullptr, nullptr };
-	m_deviceContext->CSSetShaderResources(0, 2, nullSRVs);
-	ID3D11UnorderedAccessView* nullUAVs[2] = { nullptr, nullptr };
-	m_deviceContext->CSSetUnorderedAccessViews(0, 2, nullUAVs, nullptr);
-	ID3D11Buffer* nullBuffer = nullptr;
-	m_deviceContext->CSSetConstantBuffers(0, 1, &nullBuffer);
+	ID3D11ShaderResourceView* nullSRVs[6] = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+	m_deviceContext->CSSetShaderResources(0, 6, nullSRVs);
+	ID3D11UnorderedAccessView* nullUAVs[3] = { nullptr, nullptr, nullptr };
+	m_deviceContext->CSSetUnorderedAccessViews(0, 3, nullUAVs, nullptr);
+	ID3D11Buffer* nullBuffers[2] = { nullptr, nullptr };
+	m_deviceContext->CSSetConstantBuffers(0, 2, nullBuffers);
 	ID3D11SamplerState* nullSampler = nullptr;
 	m_deviceContext->CSSetSamplers(0, 1, &nullSampler);
 	
 
 
-	m_deviceContext->CopyResource(m_lightOutputDownload.Get(), m_lightOutputData.Get());
+	bool bHasOutput = false;
+	ReadbackSlot& writeSlot = m_readbackRing[m_readbackWriteIndex];
+
+	// The ring is full, the oldest frame has to be waited on before its buffers can be reused.
+	if (writeSlot.bPending)
+	{
+		bHasOutput = ReadbackOldestSlot(ledData, true);
+	}
+
+	writeSlot.bIsGraded = bGradeColors;
+
+	// The buffers may be larger than needed, only the used part is copied.
+	D3D11_BOX copyBox = {};
+	copyBox.bottom = 1;
+	copyBox.back = 1;
+
+	if (writeSlot.bIsGraded)
+	{
+		// Only the packed output bytes need to be read back when grading on the GPU.
+		copyBox.right = Align((uint32_t)sizeof(LEDOutputData) * m_numLEDs, 4);
+		m_deviceContext->CopySubresourceRegion(writeSlot.PackedOutputDownload.Get(), 0, 0, 0, 0, m_lightPackedOutput.Get(), 0, &copyBox);
+	}
+	else
+	{
+		copyBox.right = (uint32_t)sizeof(LEDShaderOutput) * m_numLEDs;
+		m_deviceContext->CopySubresourceRegion(writeSlot.OutputDownload.Get(), 0, 0, 0, 0, m_lightOutputData.Get(), 0, &copyBox);
+	}
+
+	m_deviceContext->End(writeSlot.CopyDoneQuery.Get());
+
+	WriteGPUTimestamp(GPUTimestamp_Readback);
+	EndGPUTiming();
+	writeSlot.bPending = true;
+	writeSlot.SubmitTime = StartPerfTimer();
+	m_readbackWriteIndex = (m_readbackWriteIndex + 1) % READBACK_RING_SIZE;
+
+	// Kept out of the timed passes.
+	if (m_bCaptureFrames)
+	{
+		CaptureFrame(bUseMipPyramid);
+	}
+
+	// Consume every frame the GPU has finished without waiting, the newest one ends up in ledData.
+	while (m_readbackRing[m_readbackReadIndex].bPending && ReadbackOldestSlot(ledData, false))
+	{
+		bHasOutput = true;
+	}
+
+
+	if (g_renderDocAPI && m_frameIndex == 100)
+	{
+		g_renderDocAPI->EndFrameCapture(m_device.Get(), NULL);
+	}
+
+	return bHasOutput;
+}
+
+
+// Copies the results of the oldest in-flight frame into ledData.
+// Without bWait, returns false immediately if the GPU has not finished the frame yet.
+bool D3D11Renderer::ReadbackOldestSlot(std::shared_ptr<LEDSampleData> ledData, bool bWait)
+{
+	ReadbackSlot& slot = m_readbackRing[m_readbackReadIndex];
+
+	if (!bWait && m_deviceContext->GetData(slot.CopyDoneQuery.Get(), nullptr, 0, 0) != S_OK)
+	{
+		return false;
+	}
+
+	ID3D11Buffer* download = slot.bIsGraded ? slot.PackedOutputDownload.Get() : slot.OutputDownload.Get();
 
 	D3D11_MAPPED_SUBRESOURCE resource;
-	HRESULT result = m_deviceContext->Map(m_lightOutputDownload.Get(), 0, D3D11_MAP_READ, 0, &resource);
+	HRESULT result = m_deviceContext->Map(download, 0, D3D11_MAP_READ, bWait ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT, &resource);
+
+	if (result == DXGI_ERROR_WAS_STILL_DRAWING)
+	{
+		return false;
+	}
+
+	slot.bPending = false;
+	m_readbackReadIndex = (m_readbackReadIndex + 1) % READBACK_RING_SIZE;
+
+	if (FAILED(result))
+	{
+		g_logger->error("Readback buffer map failure: 0x%x", result);
+		return false;
+	}
 
-	if (SUCCEEDED(result))
+	if (slot.bIsGraded)
+	{
+		ledData->gradedOutput.resize(m_numLEDs);
+		memcpy(ledData->gradedOutput.data(), resource.pData, sizeof(LEDOutputData) * m_numLEDs);
+		ledData->IsOutputGraded = true;
+	}
+	else
 	{
 		ledData->sampleOutput.resize(m_numLEDs);
 		memcpy(ledData->sampleOutput.data(), resource.pData, sizeof(LEDShaderOutput) * m_numLEDs);
+		ledData->IsOutputGraded = false;
+	}
+
+	m_deviceContext->Unmap(download, 0);
+
+	m_readbackLatencyMS = EndPerfTimer(slot.SubmitTime);
+
+	return true;
+}
 
-		m_deviceContext->Unmap(m_lightOutputDownload.Get(), 0);
+
+// Grows the GPU buffers when the LED or tile count exceeds their capacity, they are never shrunk.
+bool D3D11Renderer::ReserveBuffers(uint32_t numLEDs, uint32_t numTiles)
+{
+	numLEDs = max(numLEDs, 1u);
+	numTiles = max(numTiles, 1u);
+
+	if (numLEDs > m_ledCapacity)
+	{
+		// Leave room to grow so adding a few LEDs doesn't reallocate every time.
+		if (!CreateLEDBuffers(max(numLEDs, m_ledCapacity * 2)))
+		{
+			m_ledCapacity = 0;
+			return false;
+		}
+	}
+
+	if (numTiles > m_tileCapacity)
+	{
+		if (!CreateTileBuffers(max(numTiles, m_tileCapacity * 2)))
+		{
+			m_tileCapacity = 0;
+			return false;
+		}
 	}
 
+	return true;
+}
 
-	if (g_renderDocAPI && m_frameIndex == 100)
+bool D3D11Renderer::UploadSampleAreas(std::shared_ptr<LEDSampleData> ledData)
+{
+	D3D11_MAPPED_SUBRESOURCE resource;
+
+	if (FAILED(m_deviceContext->Map(m_lightInputData.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource)))
 	{
-		g_renderDocAPI->EndFrameCapture(m_device.Get(), NULL);
+		g_logger->error("m_lightInputData map failure!");
+		return false;
+	}
+
+	memcpy(resource.pData, ledData->sampleAreas.data(), sizeof(LEDSampleArea) * ledData->NumLEDs);
+
+	m_deviceContext->Unmap(m_lightInputData.Get(), 0);
+
+	m_bSampleAreasUploaded = true;
+
+	return true;
+}
+
+bool D3D11Renderer::UploadTilePlan()
+{
+	const GatherPlan& plan = m_tilePlan.Plan;
+	D3D11_MAPPED_SUBRESOURCE resource;
+
+	if (!plan.LEDTiles.empty())
+	{
+		if (FAILED(m_deviceContext->Map(m_ledTileInfo.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource)))
+		{
+			g_logger->error("m_ledTileInfo map failure!");
+			return false;
+		}
+
+		memcpy(resource.pData, plan.LEDTiles.data(), sizeof(LEDTileInfo) * plan.LEDTiles.size());
+		m_deviceContext->Unmap(m_ledTileInfo.Get(), 0);
+	}
+
+	if (!plan.WorkItems.empty())
+	{
+		if (FAILED(m_deviceContext->Map(m_gatherWorkItems.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource)))
+		{
+			g_logger->error("m_gatherWorkItems map failure!");
+			return false;
+		}
+
+		memcpy(resource.pData, plan.WorkItems.data(), sizeof(GatherWorkItem) * plan.WorkItems.size());
+		m_deviceContext->Unmap(m_gatherWorkItems.Get(), 0);
 	}
 
-	return SUCCEEDED(result);
+	// Thread group counts for DispatchIndirect, wrapped into rows when the list exceeds the per-dimension limit.
+	const uint32_t numWorkItems = plan.GetNumTiles();
+	const uint32_t groupsX = min(max(numWorkItems, 1u), (uint32_t)D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION);
+	const uint32_t dispatchArgs[3] = { groupsX, (numWorkItems + groupsX - 1) / groupsX, 1 };
+
+	m_deviceContext->UpdateSubresource(m_gatherDispatchArgs.Get(), 0, nullptr, dispatchArgs, 0, 0);
+
+	m_tilePlan.WorkGroupsX = groupsX;
+	m_bTilePlanUploaded = true;
+
+	return true;
 }
 
+void D3D11Renderer::ResetReadbackRing()
+{
+	for (int i = 0; i < READBACK_RING_SIZE; i++)
+	{
+		m_readbackRing[i].bPending = false;
+	}
+
+	m_readbackWriteIndex = 0;
+	m_readbackReadIndex = 0;
+}
 
-bool D3D11Renderer::CreateBuffers(std::shared_ptr<LEDSampleData> ledData, uint32_t numTiles)
+bool D3D11Renderer::CreateLEDBuffers(uint32_t ledCapacity)
 {
 	{
 		D3D11_BUFFER_DESC bufferDesc = {};
-		bufferDesc.ByteWidth = sizeof(LEDSampleArea) * ledData->NumLEDs;
+		bufferDesc.ByteWidth = sizeof(LEDSampleArea) * ledCapacity;
 		bufferDesc.StructureByteStride = sizeof(LEDSampleArea);
-		bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
 		bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-
-		D3D11_SUBRESOURCE_DATA data = {};
-		data.pSysMem = ledData->sampleAreas.data();
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFEREX;
 		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
 		srvDesc.BufferEx.FirstElement = 0;
-		srvDesc.BufferEx.NumElements = ledData->NumLEDs;
+		srvDesc.BufferEx.NumElements = ledCapacity;
 
-		if (FAILED(m_device->CreateBuffer(&bufferDesc, &data, &m_lightInputData)))
+		if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &m_lightInputData)))
 		{
 			g_logger->error("m_lightInputData creation failure!");
 			return false;
@@ -377,75 +663,731 @@ bool D3D11Renderer::CreateBuffers(std::shared_ptr<LEDSampleData> ledData, uint32
 	}
 
 	{
-		
 		D3D11_BUFFER_DESC bufferDesc = {};
-		bufferDesc.ByteWidth = sizeof(uint32_t) * numTiles * 3;
+		bufferDesc.ByteWidth = sizeof(LEDShaderOutput) * ledCapacity;
+		bufferDesc.StructureByteStride = sizeof(LEDShaderOutput);
 		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
 		bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
 
 		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
-		uavDesc.Format = DXGI_FORMAT_R32_UINT;
+		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
 		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
 		uavDesc.Buffer.FirstElement = 0;
-		uavDesc.Buffer.NumElements = numTiles * 3;
+		uavDesc.Buffer.NumElements = ledCapacity;
 
-		if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &m_lightIntermediary)))
+		if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &m_lightOutputData)))
 		{
-			g_logger->error("m_lightIntermediary creation failure!");
+			g_logger->error("m_lightOutputData creation failure!");
 			return false;
 		}
 
-		if (FAILED(m_device->CreateUnorderedAccessView(m_lightIntermediary.Get(), &uavDesc, &m_lightIntermediaryUAV)))
+		if (FAILED(m_device->CreateUnorderedAccessView(m_lightOutputData.Get(), &uavDesc, &m_lightOutputDataUAV)))
 		{
-			g_logger->error("m_lightIntermediaryUAV creation error!");
+			g_logger->error("m_lightOutputDataUAV creation error!");
 			return false;
 		}
 
-		SET_DXGI_DEBUGNAME(m_lightIntermediary)
-		SET_DXGI_DEBUGNAME(m_lightIntermediaryUAV)
+		bufferDesc.Usage = D3D11_USAGE_STAGING;
+		bufferDesc.BindFlags = 0;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+		for (int i = 0; i < READBACK_RING_SIZE; i++)
+		{
+			ComPtr<ID3D11Buffer> lightOutputDownload;
+
+			if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &lightOutputDownload)))
+			{
+				g_logger->error("lightOutputDownload creation failure!");
+				return false;
+			}
+
+			SET_DXGI_DEBUGNAME(lightOutputDownload)
+			m_readbackRing[i].OutputDownload = lightOutputDownload;
+		}
+
+		SET_DXGI_DEBUGNAME(m_lightOutputData)
+		SET_DXGI_DEBUGNAME(m_lightOutputDataUAV)
 	}
 
 	{
+		// Raw buffer holding 3 bytes per LED, padded to a whole number of 32-bit words.
+		uint32_t packedSize = Align((uint32_t)sizeof(LEDOutputData) * ledCapacity, 4);
+
 		D3D11_BUFFER_DESC bufferDesc = {};
-		bufferDesc.ByteWidth = sizeof(LEDShaderOutput) * ledData->NumLEDs;
-		bufferDesc.StructureByteStride = sizeof(LEDShaderOutput);
+		bufferDesc.ByteWidth = max(packedSize, 4u);
 		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
 		bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
-		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
 
 		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
-		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
 		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
 		uavDesc.Buffer.FirstElement = 0;
-		uavDesc.Buffer.NumElements = ledData->NumLEDs;
+		uavDesc.Buffer.NumElements = bufferDesc.ByteWidth / 4;
+		uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
 
-		if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &m_lightOutputData)))
+		if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &m_lightPackedOutput)))
 		{
-			g_logger->error("m_lightOutputData creation failure!");
+			g_logger->error("m_lightPackedOutput creation failure!");
 			return false;
 		}
 
-		if (FAILED(m_device->CreateUnorderedAccessView(m_lightOutputData.Get(), &uavDesc, &m_lightOutputDataUAV)))
+		if (FAILED(m_device->CreateUnorderedAccessView(m_lightPackedOutput.Get(), &uavDesc, &m_lightPackedOutputUAV)))
 		{
-			g_logger->error("m_lightOutputDataUAV creation error!");
+			g_logger->error("m_lightPackedOutputUAV creation error!");
 			return false;
 		}
 
 		bufferDesc.Usage = D3D11_USAGE_STAGING;
 		bufferDesc.BindFlags = 0;
-		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.MiscFlags = 0;
 		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
 
-		if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &m_lightOutputDownload)))
+		for (int i = 0; i < READBACK_RING_SIZE; i++)
 		{
-			g_logger->error("m_lightOutputData creation failure!");
-			return false;
+			ComPtr<ID3D11Buffer> lightPackedOutputDownload;
+
+			if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &lightPackedOutputDownload)))
+			{
+				g_logger->error("lightPackedOutputDownload creation failure!");
+				return false;
+			}
+
+			SET_DXGI_DEBUGNAME(lightPackedOutputDownload)
+			m_readbackRing[i].PackedOutputDownload = lightPackedOutputDownload;
 		}
 
-		SET_DXGI_DEBUGNAME(m_lightOutputData)
-		SET_DXGI_DEBUGNAME(m_lightOutputDataUAV)
-		SET_DXGI_DEBUGNAME(m_lightOutputDownload)		
+		SET_DXGI_DEBUGNAME(m_lightPackedOutput)
+		SET_DXGI_DEBUGNAME(m_lightPackedOutputUAV)
 	}
 
-	return true;
+	{
+		D3D11_BUFFER_DESC bufferDesc = {};
+		bufferDesc.ByteWidth = sizeof(LEDTileInfo) * ledCapacity;
+		bufferDesc.StructureByteStride = sizeof(LEDTileInfo);
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFEREX;
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.BufferEx.FirstElement = 0;
+		srvDesc.BufferEx.NumElements = ledCapacity;
+
+		if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &m_ledTileInfo)))
+		{
+			g_logger->error("m_ledTileInfo creation failure!");
+			return false;
+		}
+
+		if (FAILED(m_device->CreateShaderResourceView(m_ledTileInfo.Get(), &srvDesc, &m_ledTileInfoSRV)))
+		{
+			g_logger->error("m_ledTileInfoSRV creation error!");
+			return false;
+		}
+
+		SET_DXGI_DEBUGNAME(m_ledTileInfo)
+		SET_DXGI_DEBUGNAME(m_ledTileInfoSRV)
+	}
+
+	// Results still in flight were read from the old buffers.
+	ResetReadbackRing();
+
+	m_ledCapacity = ledCapacity;
+	m_bSampleAreasUploaded = false;
+	m_bTilePlanUploaded = false;
+
+	return true;
+}
+
+
+// Per-tile buffers of the gather pass: the work list, its dispatch arguments and the partial sums.
+bool D3D11Renderer::CreateTileBuffers(uint32_t tileCapacity)
+{
+	{
+		D3D11_BUFFER_DESC bufferDesc = {};
+		bufferDesc.ByteWidth = sizeof(uint32_t) * tileCapacity * 3;
+		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+
+		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+		uavDesc.Format = DXGI_FORMAT_R32_UINT;
+		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.NumElements = tileCapacity * 3;
+
+		if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &m_lightIntermediary)))
+		{
+			g_logger->error("m_lightIntermediary creation failure!");
+			return false;
+		}
+
+		if (FAILED(m_device->CreateUnorderedAccessView(m_lightIntermediary.Get(), &uavDesc, &m_lightIntermediaryUAV)))
+		{
+			g_logger->error("m_lightIntermediaryUAV creation error!");
+			return false;
+		}
+
+		SET_DXGI_DEBUGNAME(m_lightIntermediary)
+		SET_DXGI_DEBUGNAME(m_lightIntermediaryUAV)
+	}
+
+	{
+		D3D11_BUFFER_DESC bufferDesc = {};
+		bufferDesc.ByteWidth = sizeof(GatherWorkItem) * tileCapacity;
+		bufferDesc.StructureByteStride = sizeof(GatherWorkItem);
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFEREX;
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.BufferEx.FirstElement = 0;
+		srvDesc.BufferEx.NumElements = tileCapacity;
+
+		if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &m_gatherWorkItems)))
+		{
+			g_logger->error("m_gatherWorkItems creation failure!");
+			return false;
+		}
+
+		if (FAILED(m_device->CreateShaderResourceView(m_gatherWorkItems.Get(), &srvDesc, &m_gatherWorkItemsSRV)))
+		{
+			g_logger->error("m_gatherWorkItemsSRV creation error!");
+			return false;
+		}
+
+		SET_DXGI_DEBUGNAME(m_gatherWorkItems)
+		SET_DXGI_DEBUGNAME(m_gatherWorkItemsSRV)
+	}
+
+	if (!m_gatherDispatchArgs)
+	{
+		D3D11_BUFFER_DESC bufferDesc = {};
+		bufferDesc.ByteWidth = sizeof(uint32_t) * 3;
+		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+
+		if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &m_gatherDispatchArgs)))
+		{
+			g_logger->error("m_gatherDispatchArgs creation failure!");
+			return false;
+		}
+
+		SET_DXGI_DEBUGNAME(m_gatherDispatchArgs)
+	}
+
+	m_tileCapacity = tileCapacity;
+	m_bTilePlanUploaded = false;
+
+	return true;
+}
+
+
+static inline bool IsCaptureFormatBGRA(DXGI_FORMAT format)
+{
+	return format == DXGI_FORMAT_B8G8R8A8_TYPELESS || format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+}
+
+// Copies a reduced mip level of both eyes into a staging texture. The frame is skipped rather than waited on
+// while every staging texture is still in use.
+bool D3D11Renderer::CaptureFrame(bool bMipPyramidUpdated)
+{
+	const DXGI_FORMAT format = m_mirrorDesc.Format;
+
+	if (format != DXGI_FORMAT_R8G8B8A8_TYPELESS && format != DXGI_FORMAT_R8G8B8A8_UNORM && format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB && !IsCaptureFormatBGRA(format))
+	{
+		if (!m_bCaptureFormatWarned)
+		{
+			g_logger->warn("Frame capture is not supported for mirror texture format {}", (int)format);
+			m_bCaptureFormatWarned = true;
+		}
+
+		return false;
+	}
+
+	if (m_captureRing[m_captureWriteIndex].bPending)
+	{
+		return false;
+	}
+
+	if (!bMipPyramidUpdated && !UpdateMipPyramid(m_mirrorDesc))
+	{
+		return false;
+	}
+
+	const uint32_t mipLevels = m_mipPyramidDesc.MipLevels;
+	const uint32_t level = min(m_captureLevel, mipLevels - 1);
+	const uint32_t width = max(m_mipPyramidDesc.Width >> level, 1u);
+	const uint32_t height = max(m_mipPyramidDesc.Height >> level, 1u);
+
+	if (!m_captureRing[0].Staging || m_captureDesc.Width != width || m_captureDesc.Height != height || m_captureDesc.Format != m_mipPyramidDesc.Format)
+	{
+		D3D11_TEXTURE2D_DESC textureDesc = {};
+		textureDesc.Width = width;
+		textureDesc.Height = height;
+		textureDesc.MipLevels = 1;
+		textureDesc.ArraySize = 2;
+		textureDesc.Format = m_mipPyramidDesc.Format;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.Usage = D3D11_USAGE_STAGING;
+		textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+		D3D11_QUERY_DESC queryDesc = {};
+		queryDesc.Query = D3D11_QUERY_EVENT;
+
+		for (int i = 0; i < READBACK_RING_SIZE; i++)
+		{
+			CaptureSlot& slot = m_captureRing[i];
+			slot.bPending = false;
+			slot.Staging.Reset();
+
+			if (FAILED(m_device->CreateTexture2D(&textureDesc, nullptr, &slot.Staging)))
+			{
+				g_logger->error("Capture staging texture creation failure!");
+				return false;
+			}
+
+			if (!slot.CopyDoneQuery && FAILED(m_device->CreateQuery(&queryDesc, &slot.CopyDoneQuery)))
+			{
+				g_logger->error("Capture query creation failure!");
+				return false;
+			}
+		}
+
+		m_captureDesc = textureDesc;
+		m_captureWriteIndex = 0;
+		m_captureReadIndex = 0;
+	}
+
+	CaptureSlot& slot = m_captureRing[m_captureWriteIndex];
+
+	for (uint32_t eye = 0; eye < 2; eye++)
+	{
+		m_deviceContext->CopySubresourceRegion(slot.Staging.Get(), D3D11CalcSubresource(0, eye, 1), 0, 0, 0, m_mipPyramid.Get(), D3D11CalcSubresource(level, eye, mipLevels), nullptr);
+	}
+
+	m_deviceContext->End(slot.CopyDoneQuery.Get());
+
+	slot.bPending = true;
+	m_captureWriteIndex = (m_captureWriteIndex + 1) % READBACK_RING_SIZE;
+
+	return true;
+}
+
+bool D3D11Renderer::ReadbackCapture(CaptureSlot& slot, StereoFrame& outFrame)
+{
+	if (m_deviceContext->GetData(slot.CopyDoneQuery.Get(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+	{
+		return false;
+	}
+
+	const bool bIsBGRA = IsCaptureFormatBGRA(m_captureDesc.Format);
+
+	for (uint32_t eye = 0; eye < 2; eye++)
+	{
+		RGBAFrame& image = eye == 0 ? outFrame.Left : outFrame.Right;
+		image.Resize(m_captureDesc.Width, m_captureDesc.Height);
+
+		const UINT subresource = D3D11CalcSubresource(0, eye, 1);
+		D3D11_MAPPED_SUBRESOURCE resource;
+
+		if (FAILED(m_deviceContext->Map(slot.Staging.Get(), subresource, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &resource)))
+		{
+			return false;
+		}
+
+		for (uint32_t y = 0; y < image.Height; y++)
+		{
+			memcpy(image.GetPixel(0, y), (const uint8_t*)resource.pData + (size_t)y * resource.RowPitch, (size_t)image.Width * 4);
+		}
+
+		m_deviceContext->Unmap(slot.Staging.Get(), subresource);
+
+		if (bIsBGRA)
+		{
+			for (size_t i = 0; i < image.Pixels.size(); i += 4)
+			{
+				std::swap(image.Pixels[i], image.Pixels[i + 2]);
+			}
+		}
+	}
+
+	slot.bPending = false;
+
+	return true;
+}
+
+bool D3D11Renderer::GetCapturedFrame(StereoFrame& outFrame)
+{
+	bool bHasFrame = false;
+
+	while (m_captureRing[m_captureReadIndex].bPending && ReadbackCapture(m_captureRing[m_captureReadIndex], outFrame))
+	{
+		m_captureReadIndex = (m_captureReadIndex + 1) % READBACK_RING_SIZE;
+		bHasFrame = true;
+	}
+
+	return bHasFrame;
+}
+
+
+// Starts recording timestamps for this frame, unless all timing slots are still waiting for results.
+void D3D11Renderer::BeginGPUTiming()
+{
+	CollectGPUTimings();
+
+	GPUTimingSlot& slot = m_timingRing[m_timingWriteIndex];
+
+	if (slot.bPending)
+	{
+		m_activeTiming = nullptr;
+		return;
+	}
+
+	m_activeTiming = &slot;
+	m_deviceContext->Begin(slot.DisjointQuery.Get());
+	m_deviceContext->End(slot.Timestamps[GPUTimestamp_Begin].Get());
+}
+
+void D3D11Renderer::WriteGPUTimestamp(EGPUTimestamp timestamp)
+{
+	if (m_activeTiming)
+	{
+		m_deviceContext->End(m_activeTiming->Timestamps[timestamp].Get());
+	}
+}
+
+void D3D11Renderer::EndGPUTiming()
+{
+	if (!m_activeTiming)
+	{
+		return;
+	}
+
+	m_deviceContext->End(m_activeTiming->DisjointQuery.Get());
+	m_activeTiming->bPending = true;
+	m_activeTiming = nullptr;
+
+	m_timingWriteIndex = (m_timingWriteIndex + 1) % GPU_TIMING_FRAMES;
+}
+
+// Closes the disjoint query of a frame that ended before all its timestamps were written, and keeps the slot free.
+// Waiting on the missing timestamps would leave the slot pending forever.
+void D3D11Renderer::AbortGPUTiming()
+{
+	if (!m_activeTiming)
+	{
+		return;
+	}
+
+	m_deviceContext->End(m_activeTiming->DisjointQuery.Get());
+	m_activeTiming = nullptr;
+}
+
+// Reads the timestamps of finished frames without stalling, the newest completed frame is kept.
+void D3D11Renderer::CollectGPUTimings()
+{
+	for (int i = 0; i < GPU_TIMING_FRAMES; i++)
+	{
+		// Oldest first, starting from the next slot to be written.
+		GPUTimingSlot& slot = m_timingRing[(m_timingWriteIndex + i) % GPU_TIMING_FRAMES];
+
+		if (!slot.bPending)
+		{
+			continue;
+		}
+
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+
+		if (m_deviceContext->GetData(slot.DisjointQuery.Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		{
+			continue;
+		}
+
+		uint64_t timestamps[GPUTimestamp_Count];
+		bool bIsComplete = true;
+
+		for (int j = 0; j < GPUTimestamp_Count; j++)
+		{
+			if (m_deviceContext->GetData(slot.Timestamps[j].Get(), &timestamps[j], sizeof(uint64_t), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			{
+				bIsComplete = false;
+				break;
+			}
+		}
+
+		if (!bIsComplete)
+		{
+			continue;
+		}
+
+		slot.bPending = false;
+
+		// The timestamps are unreliable if the GPU clock changed during the frame.
+		if (disjoint.Disjoint || disjoint.Frequency == 0)
+		{
+			continue;
+		}
+
+		float* passTimes[GPUTimestamp_Count - 1] = { &m_gpuPassTimes.PrepareMS, &m_gpuPassTimes.SampleMS, &m_gpuPassTimes.CombineMS, &m_gpuPassTimes.ReadbackMS };
+
+		for (int j = 1; j < GPUTimestamp_Count; j++)
+		{
+			*passTimes[j - 1] = (float)((double)(timestamps[j] - timestamps[j - 1]) * 1000.0 / disjoint.Frequency);
+		}
+	}
+}
+
+
+bool D3D11Renderer::AcquireMirrorTextures()
+{
+	vr::EVRCompositorError compError;
+
+	compError = vr::VRCompositor()->GetMirrorTextureD3D11(vr::Eye_Left, m_device.Get(), (void**)&m_mirrorSRVLeft);
+
+	if (compError != vr::VRCompositorError_None)
+	{
+		g_logger->error("Error getting mirror texture!");
+		m_mirrorSRVLeft = nullptr;
+		return false;
+	}
+
+	compError = vr::VRCompositor()->GetMirrorTextureD3D11(vr::Eye_Right, m_device.Get(), (void**)&m_mirrorSRVRight);
+
+	if (compError != vr::VRCompositorError_None)
+	{
+		g_logger->error("Error getting mirror texture!");
+		m_mirrorSRVRight = nullptr;
+		ReleaseMirrorTextures();
+		return false;
+	}
+
+	ComPtr<ID3D11Resource> res;
+	ComPtr <ID3D11Texture2D> tex;
+
+	m_mirrorSRVLeft->GetResource(res.GetAddressOf());
+
+	if (!res.Get() || FAILED(res->QueryInterface(IID_PPV_ARGS(tex.GetAddressOf()))))
+	{
+		ReleaseMirrorTextures();
+
+		g_logger->error("Querying mirror texture resource failure!");
+		return false;
+	}
+
+	tex->GetDesc(&m_mirrorDesc);
+	m_mirrorTextureAcquireTime = StartPerfTimer();
+
+	return true;
+}
+
+void D3D11Renderer::ReleaseMirrorTextures()
+{
+	if (m_mirrorSRVLeft)
+	{
+		vr::VRCompositor()->ReleaseMirrorTextureD3D11(m_mirrorSRVLeft);
+		m_mirrorSRVLeft = nullptr;
+	}
+	if (m_mirrorSRVRight)
+	{
+		vr::VRCompositor()->ReleaseMirrorTextureD3D11(m_mirrorSRVRight);
+		m_mirrorSRVRight = nullptr;
+	}
+}
+
+
+// Rebuilds the gather work list only when the frame size or the sample areas have changed.
+void D3D11Renderer::UpdateTilePlan(std::shared_ptr<LEDSampleData> ledData, uint32_t frameWidth, uint32_t frameHeight)
+{
+	if (m_tilePlan.bIsValid && m_tilePlan.FrameWidth == frameWidth && m_tilePlan.FrameHeight == frameHeight && 
+		m_tilePlan.GeometryVersion == ledData->GeometryVersion && m_tilePlan.NumLEDs == ledData->NumLEDs)
+	{
+		return;
+	}
+
+	m_tilePlan.Plan.Build(ledData->sampleAreas, ledData->NumLEDs, frameWidth, frameHeight);
+
+	m_tilePlan.FrameWidth = frameWidth;
+	m_tilePlan.FrameHeight = frameHeight;
+	m_tilePlan.GeometryVersion = ledData->GeometryVersion;
+	m_tilePlan.NumLEDs = ledData->NumLEDs;
+	m_tilePlan.bIsValid = true;
+
+	m_bTilePlanUploaded = false;
+}
+
+
+// Copies both eyes into the slices of a mip-mapped texture array and regenerates the mip chain.
+bool D3D11Renderer::UpdateMipPyramid(const D3D11_TEXTURE2D_DESC& mirrorDesc)
+{
+	if (!m_mipPyramid || m_mipPyramidDesc.Width != mirrorDesc.Width || m_mipPyramidDesc.Height != mirrorDesc.Height || m_mipPyramidDesc.Format != mirrorDesc.Format)
+	{
+		m_mipPyramid.Reset();
+		m_mipPyramidSRV.Reset();
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC mirrorSRVDesc = {};
+		m_mirrorSRVLeft->GetDesc(&mirrorSRVDesc);
+
+		D3D11_TEXTURE2D_DESC textureDesc = {};
+		textureDesc.Width = mirrorDesc.Width;
+		textureDesc.Height = mirrorDesc.Height;
+		textureDesc.MipLevels = 0;
+		textureDesc.ArraySize = 2;
+		textureDesc.Format = mirrorDesc.Format;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.Usage = D3D11_USAGE_DEFAULT;
+		textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+		textureDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+		if (FAILED(m_device->CreateTexture2D(&textureDesc, nullptr, &m_mipPyramid)))
+		{
+			g_logger->error("m_mipPyramid creation failure!");
+			return false;
+		}
+
+		m_mipPyramid->GetDesc(&m_mipPyramidDesc);
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = mirrorSRVDesc.Format;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = m_mipPyramidDesc.MipLevels;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = 2;
+
+		if (FAILED(m_device->CreateShaderResourceView(m_mipPyramid.Get(), &srvDesc, &m_mipPyramidSRV)))
+		{
+			g_logger->error("m_mipPyramidSRV creation error!");
+			m_mipPyramid.Reset();
+			return false;
+		}
+
+		SET_DXGI_DEBUGNAME(m_mipPyramid)
+		SET_DXGI_DEBUGNAME(m_mipPyramidSRV)
+	}
+
+	ComPtr<ID3D11Resource> leftResource;
+	ComPtr<ID3D11Resource> rightResource;
+
+	m_mirrorSRVLeft->GetResource(leftResource.GetAddressOf());
+	m_mirrorSRVRight->GetResource(rightResource.GetAddressOf());
+
+	if (!leftResource.Get() || !rightResource.Get())
+	{
+		g_logger->error("Querying mirror texture resource failure!");
+		return false;
+	}
+
+	const uint32_t mipLevels = m_mipPyramidDesc.MipLevels;
+
+	m_deviceContext->CopySubresourceRegion(m_mipPyramid.Get(), D3D11CalcSubresource(0, 0, mipLevels), 0, 0, 0, leftResource.Get(), 0, nullptr);
+	m_deviceContext->CopySubresourceRegion(m_mipPyramid.Get(), D3D11CalcSubresource(0, 1, mipLevels), 0, 0, 0, rightResource.Get(), 0, nullptr);
+	m_deviceContext->GenerateMips(m_mipPyramidSRV.Get());
+
+	return true;
+}
+
+
+// Allocates the summed area table holding RGB sums for every pixel of both eyes.
+bool D3D11Renderer::UpdateSummedAreaTable(uint32_t frameWidth, uint32_t frameHeight)
+{
+	if (m_summedAreaTable && m_summedAreaTableSize[0] == frameWidth && m_summedAreaTableSize[1] == frameHeight)
+	{
+		return true;
+	}
+
+	m_summedAreaTable.Reset();
+	m_summedAreaTableUAV.Reset();
+	m_summedAreaTableSRV.Reset();
+	m_summedAreaTableSize[0] = 0;
+	m_summedAreaTableSize[1] = 0;
+
+	uint32_t numElements = frameWidth * frameHeight * 2;
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = sizeof(uint32_t) * 3 * numElements;
+	bufferDesc.StructureByteStride = sizeof(uint32_t) * 3;
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.FirstElement = 0;
+	uavDesc.Buffer.NumElements = numElements;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFEREX;
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.BufferEx.FirstElement = 0;
+	srvDesc.BufferEx.NumElements = numElements;
+
+	if (FAILED(m_device->CreateBuffer(&bufferDesc, nullptr, &m_summedAreaTable)))
+	{
+		g_logger->error("m_summedAreaTable creation failure!");
+		return false;
+	}
+
+	if (FAILED(m_device->CreateUnorderedAccessView(m_summedAreaTable.Get(), &uavDesc, &m_summedAreaTableUAV)))
+	{
+		g_logger->error("m_summedAreaTableUAV creation error!");
+		m_summedAreaTable.Reset();
+		return false;
+	}
+
+	if (FAILED(m_device->CreateShaderResourceView(m_summedAreaTable.Get(), &srvDesc, &m_summedAreaTableSRV)))
+	{
+		g_logger->error("m_summedAreaTableSRV creation error!");
+		m_summedAreaTable.Reset();
+		m_summedAreaTableUAV.Reset();
+		return false;
+	}
+
+	SET_DXGI_DEBUGNAME(m_summedAreaTable)
+	SET_DXGI_DEBUGNAME(m_summedAreaTableUAV)
+	SET_DXGI_DEBUGNAME(m_summedAreaTableSRV)
+
+	m_summedAreaTableSize[0] = frameWidth;
+	m_summedAreaTableSize[1] = frameHeight;
+
+	return true;
+}
+
+
+void D3D11Renderer::UpdateColorConstants(bool bGradeColors)
+{
+	std::shared_ptr<const ColorParams> params = m_settingsManager->GetColorParams();
+
+	if (m_bColorConstantsValid && params->Version == m_colorParamsVersion && bGradeColors == m_bColorConstantsGrade)
+	{
+		return;
+	}
+
+	m_colorParamsVersion = params->Version;
+	m_bColorConstantsGrade = bGradeColors;
+	m_bColorConstantsValid = true;
+
+	CSColorConstantBuffer colorBuffer = {};
+	colorBuffer.contrast = params->Contrast;
+	colorBuffer.saturation = params->Saturation;
+	colorBuffer.useOklab = params->AdjustmentSpace == ColorSpace_Oklab ? 1 : 0;
+	colorBuffer.gradeColors = bGradeColors ? 1 : 0;
+
+	for (int i = 0; i < 3; i++)
+	{
+		colorBuffer.minColor[i] = params->Min[i];
+		colorBuffer.scale[i] = params->Scale[i];
+		colorBuffer.maxColor[i] = params->Max[i];
+		colorBuffer.invGamma[i] = params->InvGamma[i];
+	}
+
+	m_deviceContext->UpdateSubresource(m_colorConstantBuffer.Get(), 0, nullptr, &colorBuffer, 0, 0);
 }
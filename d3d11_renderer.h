@@ -4,21 +4,106 @@
 #include "framework.h"
 #include "structures.h"
 #include "settings_manager.h"
+#include "gather_plan.h"
+#include "light_renderer.h"
 
+// Number of frames whose results can be in flight between the GPU and the CPU.
+#define READBACK_RING_SIZE 3
 
-class D3D11Renderer
+// Cached mirror textures are re-acquired at least this often, in case a change was not signaled.
+#define MIRROR_TEXTURE_REVALIDATE_MS 5000.0f
+
+// Frames of GPU timestamp queries in flight, results are collected once the GPU has finished them.
+#define GPU_TIMING_FRAMES 4
+
+// Points in the frame where a GPU timestamp is written, each pass is timed as the difference to the previous one.
+enum EGPUTimestamp
+{
+	GPUTimestamp_Begin = 0,
+	GPUTimestamp_Prepare, // Mip generation or summed area table build
+	GPUTimestamp_Sample, // Gather or sampling pass
+	GPUTimestamp_Combine,
+	GPUTimestamp_Readback, // Copy into the staging buffer
+	GPUTimestamp_Count
+};
+
+
+class D3D11Renderer : public ILightRenderer
 {
 public:
 	D3D11Renderer(std::shared_ptr<SettingsManager> settingsManager);
 	~D3D11Renderer();
 
-	bool InitRenderer();
-	bool Render(std::shared_ptr<LEDSampleData> ledData);
-	const bool IsIntialized() { return m_bIsInitalized; }
+	bool InitRenderer() override;
+	bool Render(std::shared_ptr<LEDSampleData> ledData) override;
+	bool IsIntialized() override { return m_bIsInitalized; }
+	float GetReadbackLatencyMS() const override { return m_readbackLatencyMS; }
+	const GPUPassTimes& GetGPUPassTimes() const override { return m_gpuPassTimes; }
+	void InvalidateMirrorTextures() override { m_bMirrorTexturesInvalidated = true; }
+	void SetFrameCapture(bool bEnable, uint32_t level) override { m_bCaptureFrames = bEnable; m_captureLevel = level; }
+	bool GetCapturedFrame(StereoFrame& outFrame) override;
 
 protected:
 
-	bool CreateBuffers(std::shared_ptr<LEDSampleData> ledData, uint32_t numTiles);
+	// Staging buffers for one frame of results, signaled by an event query once the copy has executed.
+	struct ReadbackSlot
+	{
+		ComPtr<ID3D11Buffer> OutputDownload;
+		ComPtr<ID3D11Buffer> PackedOutputDownload;
+		ComPtr<ID3D11Query> CopyDoneQuery;
+		bool bPending = false;
+		bool bIsGraded = false;
+		LARGE_INTEGER SubmitTime = {};
+	};
+
+	// Gather work list and dispatch size, derived from the frame size and the sample areas.
+	struct TilePlan
+	{
+		bool bIsValid = false;
+		uint32_t FrameWidth = 0;
+		uint32_t FrameHeight = 0;
+		uint64_t GeometryVersion = 0;
+		int NumLEDs = 0;
+		GatherPlan Plan;
+		uint32_t WorkGroupsX = 1;
+	};
+
+	// Staging copy of a reduced mip level of both eyes.
+	struct CaptureSlot
+	{
+		ComPtr<ID3D11Texture2D> Staging;
+		ComPtr<ID3D11Query> CopyDoneQuery;
+		bool bPending = false;
+	};
+
+	struct GPUTimingSlot
+	{
+		ComPtr<ID3D11Query> DisjointQuery;
+		ComPtr<ID3D11Query> Timestamps[GPUTimestamp_Count];
+		bool bPending = false;
+	};
+
+	void BeginGPUTiming();
+	void WriteGPUTimestamp(EGPUTimestamp timestamp);
+	void EndGPUTiming();
+	void AbortGPUTiming();
+	void CollectGPUTimings();
+
+	bool AcquireMirrorTextures();
+	void ReleaseMirrorTextures();
+	void UpdateTilePlan(std::shared_ptr<LEDSampleData> ledData, uint32_t frameWidth, uint32_t frameHeight);
+	bool ReserveBuffers(uint32_t numLEDs, uint32_t numTiles);
+	bool CreateLEDBuffers(uint32_t ledCapacity);
+	bool CreateTileBuffers(uint32_t tileCapacity);
+	bool UploadSampleAreas(std::shared_ptr<LEDSampleData> ledData);
+	bool UploadTilePlan();
+	void ResetReadbackRing();
+	bool ReadbackOldestSlot(std::shared_ptr<LEDSampleData> ledData, bool bWait);
+	bool UpdateMipPyramid(const D3D11_TEXTURE2D_DESC& mirrorDesc);
+	bool UpdateSummedAreaTable(uint32_t frameWidth, uint32_t frameHeight);
+	bool CaptureFrame(bool bMipPyramidUpdated);
+	bool ReadbackCapture(CaptureSlot& slot, StereoFrame& outFrame);
+	void UpdateColorConstants(bool bGradeColors);
 
 	std::shared_ptr<SettingsManager> m_settingsManager;
 
@@ -29,25 +114,78 @@ protected:
 
 	ComPtr<ID3D11ComputeShader> m_gatherLightCS;
 	ComPtr<ID3D11ComputeShader> m_combineLightCS;
+	ComPtr<ID3D11ComputeShader> m_sampleMipCS;
+	ComPtr<ID3D11ComputeShader> m_summedAreaRowsCS;
+	ComPtr<ID3D11ComputeShader> m_summedAreaColumnsCS;
+	ComPtr<ID3D11ComputeShader> m_sampleSummedAreaCS;
 
 	ID3D11ShaderResourceView *m_mirrorSRVLeft = nullptr;
 	ID3D11ShaderResourceView *m_mirrorSRVRight = nullptr;
+	D3D11_TEXTURE2D_DESC m_mirrorDesc = {};
+	LARGE_INTEGER m_mirrorTextureAcquireTime = {};
+	bool m_bMirrorTexturesInvalidated = false;
+
+	TilePlan m_tilePlan;
 
 	ComPtr<ID3D11Buffer> m_csConstantBuffer;
+	ComPtr<ID3D11Buffer> m_colorConstantBuffer;
 
 	ComPtr<ID3D11Buffer> m_lightInputData;
 	ComPtr<ID3D11ShaderResourceView> m_lightInputDataSRV;
 
+	ComPtr<ID3D11Buffer> m_ledTileInfo;
+	ComPtr<ID3D11ShaderResourceView> m_ledTileInfoSRV;
+
+	ComPtr<ID3D11Buffer> m_gatherWorkItems;
+	ComPtr<ID3D11ShaderResourceView> m_gatherWorkItemsSRV;
+	ComPtr<ID3D11Buffer> m_gatherDispatchArgs;
+
 	ComPtr<ID3D11Buffer> m_lightIntermediary;
 	ComPtr<ID3D11UnorderedAccessView> m_lightIntermediaryUAV;
 
 	ComPtr<ID3D11Buffer> m_lightOutputData;
 	ComPtr<ID3D11UnorderedAccessView> m_lightOutputDataUAV;
-	ComPtr<ID3D11Buffer> m_lightOutputDownload;
+
+	ComPtr<ID3D11Buffer> m_lightPackedOutput;
+	ComPtr<ID3D11UnorderedAccessView> m_lightPackedOutputUAV;
+
+	ReadbackSlot m_readbackRing[READBACK_RING_SIZE];
+	uint32_t m_readbackWriteIndex = 0;
+	uint32_t m_readbackReadIndex = 0;
+	float m_readbackLatencyMS = 0;
+
+	GPUTimingSlot m_timingRing[GPU_TIMING_FRAMES];
+	uint32_t m_timingWriteIndex = 0;
+	GPUTimingSlot* m_activeTiming = nullptr;
+	GPUPassTimes m_gpuPassTimes;
+
+	ComPtr<ID3D11Texture2D> m_mipPyramid;
+	ComPtr<ID3D11ShaderResourceView> m_mipPyramidSRV;
+	D3D11_TEXTURE2D_DESC m_mipPyramidDesc = {};
+
+	ComPtr<ID3D11Buffer> m_summedAreaTable;
+	ComPtr<ID3D11UnorderedAccessView> m_summedAreaTableUAV;
+	ComPtr<ID3D11ShaderResourceView> m_summedAreaTableSRV;
+	uint32_t m_summedAreaTableSize[2] = { 0, 0 };
+
+	bool m_bCaptureFrames = false;
+	uint32_t m_captureLevel = 0;
+	CaptureSlot m_captureRing[READBACK_RING_SIZE];
+	uint32_t m_captureWriteIndex = 0;
+	uint32_t m_captureReadIndex = 0;
+	D3D11_TEXTURE2D_DESC m_captureDesc = {};
+	bool m_bCaptureFormatWarned = false;
 
 	ComPtr<ID3D11SamplerState> m_bilinearSampler;
 
 	int m_numLEDs = 0;
+	uint32_t m_ledCapacity = 0;
+	uint32_t m_tileCapacity = 0;
+	bool m_bSampleAreasUploaded = false;
+	bool m_bTilePlanUploaded = false;
+	bool m_bColorConstantsValid = false;
+	bool m_bColorConstantsGrade = false;
+	uint64_t m_colorParamsVersion = 0;
 	uint64_t m_frameIndex = 0;
 };
 
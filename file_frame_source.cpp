@@ -0,0 +1,123 @@
+#include "file_frame_source.h"
+
+
+bool WriteRawFrameFile(const std::string& path, const std::vector<StereoFrame>& frames, float frameIntervalMS)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open() || frames.empty())
+	{
+		return false;
+	}
+
+	RawFrameFileHeader header;
+	header.Width = frames[0].Left.Width;
+	header.Height = frames[0].Left.Height;
+	header.NumFrames = (uint32_t)frames.size();
+	header.FrameIntervalUS = (uint32_t)(frameIntervalMS * 1000.0f);
+
+	file.write((const char*)&header, sizeof(header));
+
+	for (const StereoFrame& frame : frames)
+	{
+		if (frame.Left.Width != header.Width || frame.Left.Height != header.Height ||
+			frame.Right.Width != header.Width || frame.Right.Height != header.Height)
+		{
+			return false;
+		}
+
+		file.write((const char*)frame.Left.Pixels.data(), frame.Left.Pixels.size());
+		file.write((const char*)frame.Right.Pixels.data(), frame.Right.Pixels.size());
+	}
+
+	return file.good();
+}
+
+
+FileFrameSource::FileFrameSource(const std::string& path, bool bRealTime, bool bLoop)
+	: m_path(path)
+	, m_bRealTime(bRealTime)
+	, m_bLoop(bLoop)
+{
+
+}
+
+bool FileFrameSource::InitSource()
+{
+	m_file.close();
+	m_file.open(m_path, std::ios::binary);
+
+	if (!m_file.is_open())
+	{
+		return false;
+	}
+
+	if (!m_file.read((char*)&m_header, sizeof(m_header)) || m_header.Magic != RAW_FRAME_FILE_MAGIC || m_header.Version != RAW_FRAME_FILE_VERSION ||
+		m_header.Width == 0 || m_header.Height == 0 || m_header.NumFrames == 0)
+	{
+		m_file.close();
+		return false;
+	}
+
+	m_frame.Left.Resize(m_header.Width, m_header.Height);
+	m_frame.Right.Resize(m_header.Width, m_header.Height);
+
+	m_nextFrame = 0;
+	m_bHasFrame = false;
+	m_pacer.Reset();
+
+	return true;
+}
+
+EFrameWaitResult FileFrameSource::WaitFrame(uint32_t timeoutMS)
+{
+	if (!m_file.is_open())
+	{
+		return FrameWait_EndOfStream;
+	}
+
+	if (m_nextFrame >= m_header.NumFrames)
+	{
+		if (!m_bLoop)
+		{
+			return FrameWait_EndOfStream;
+		}
+
+		m_file.clear();
+		m_file.seekg(sizeof(RawFrameFileHeader));
+		m_nextFrame = 0;
+	}
+
+	if (!m_pacer.WaitNextFrame(m_bRealTime ? GetFrameIntervalMS() : 0.0f, timeoutMS))
+	{
+		return FrameWait_TimedOut;
+	}
+
+	m_bHasFrame = false;
+
+	if (!m_file.read((char*)m_frame.Left.Pixels.data(), m_frame.Left.Pixels.size()) ||
+		!m_file.read((char*)m_frame.Right.Pixels.data(), m_frame.Right.Pixels.size()))
+	{
+		// Truncated file, the frames read so far are all there is.
+		m_header.NumFrames = m_nextFrame;
+		return m_bLoop && m_nextFrame > 0 ? WaitFrame(timeoutMS) : FrameWait_EndOfStream;
+	}
+
+	m_nextFrame++;
+	m_bHasFrame = true;
+
+	return FrameWait_Ready;
+}
+
+bool FileFrameSource::GetFrameImages(RGBAImageView& outLeft, RGBAImageView& outRight)
+{
+	if (!m_bHasFrame)
+	{
+		return false;
+	}
+
+	outLeft = m_frame.Left.GetView();
+	outRight = m_frame.Right.GetView();
+
+	return true;
+}
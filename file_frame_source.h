@@ -0,0 +1,53 @@
+#pragma once
+
+#include "frame_source.h"
+
+#include <fstream>
+#include <string>
+
+#define RAW_FRAME_FILE_MAGIC 0x46524C41 // "ALRF"
+#define RAW_FRAME_FILE_VERSION 1
+
+
+// Header of a raw frame sequence file. It is followed by the frames, each the left and then the right eye as tightly packed RGBA.
+struct RawFrameFileHeader
+{
+	uint32_t Magic = RAW_FRAME_FILE_MAGIC;
+	uint32_t Version = RAW_FRAME_FILE_VERSION;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t NumFrames = 0;
+	uint32_t FrameIntervalUS = 0;
+};
+
+bool WriteRawFrameFile(const std::string& path, const std::vector<StereoFrame>& frames, float frameIntervalMS);
+
+
+// Streams frames from a raw frame sequence file, reading one frame at a time.
+class FileFrameSource : public IFrameSource
+{
+public:
+
+	// Without real time pacing the frames are read as fast as they are consumed, still reporting the recorded interval.
+	FileFrameSource(const std::string& path, bool bRealTime = true, bool bLoop = true);
+
+	bool InitSource() override;
+	bool IsActive() override { return true; }
+	EFrameWaitResult WaitFrame(uint32_t timeoutMS) override;
+	float GetFrameIntervalMS() override { return m_header.FrameIntervalUS / 1000.0f; }
+	bool HasFrameImages() const override { return true; }
+	bool GetFrameImages(RGBAImageView& outLeft, RGBAImageView& outRight) override;
+
+protected:
+
+	std::string m_path;
+	bool m_bRealTime = true;
+	bool m_bLoop = true;
+
+	std::ifstream m_file;
+	RawFrameFileHeader m_header;
+	uint32_t m_nextFrame = 0;
+	bool m_bHasFrame = false;
+	StereoFrame m_frame;
+	FramePacer m_pacer;
+};
@@ -0,0 +1,32 @@
+#include "frame_source.h"
+
+#include <thread>
+
+
+bool FramePacer::WaitNextFrame(float intervalMS, uint32_t timeoutMS)
+{
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	if (intervalMS <= 0.0f || !m_bStarted)
+	{
+		m_bStarted = true;
+		m_lastFrameTime = now;
+		return true;
+	}
+
+	const std::chrono::steady_clock::duration interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float, std::milli>(intervalMS));
+	const std::chrono::steady_clock::time_point dueTime = m_lastFrameTime + interval;
+
+	if (dueTime - now > std::chrono::milliseconds(timeoutMS))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMS));
+		return false;
+	}
+
+	std::this_thread::sleep_until(dueTime);
+
+	// Scheduled from the due time so the rate doesn't drift, unless the consumer has fallen behind by more than a frame.
+	m_lastFrameTime = now - dueTime > interval ? now : dueTime;
+
+	return true;
+}
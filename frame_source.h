@@ -0,0 +1,69 @@
+#pragma once
+
+#include "rgba_frame.h"
+#include "structures.h"
+
+#include <chrono>
+
+
+enum EFrameWaitResult
+{
+	FrameWait_Ready = 0,
+	FrameWait_TimedOut,
+	FrameWait_EndOfStream // Only for sources with a fixed number of frames
+};
+
+
+// Both eye images of one frame.
+struct StereoFrame
+{
+	RGBAFrame Left;
+	RGBAFrame Right;
+};
+
+
+// Where the sampler gets its frames and their timing from.
+class IFrameSource
+{
+public:
+
+	virtual ~IFrameSource() {}
+
+	virtual bool InitSource() = 0;
+
+	// False while nobody is looking at the frames, such as with the headset in standby. The LEDs are turned off meanwhile.
+	virtual bool IsActive() = 0;
+
+	// Blocks until the next frame is due.
+	virtual EFrameWaitResult WaitFrame(uint32_t timeoutMS) = 0;
+
+	// Time between the current frame and the previous one.
+	virtual float GetFrameIntervalMS() = 0;
+
+	// Whether the frames are available in CPU memory, otherwise they have to be read on the GPU by the renderer.
+	virtual bool HasFrameImages() const { return false; }
+
+	// Eye images of the current frame, valid until the next WaitFrame call.
+	virtual bool GetFrameImages(RGBAImageView& /*outLeft*/, RGBAImageView& /*outRight*/) { return false; }
+
+	// Sample areas the frames were recorded with, if they changed since the previous call. They replace the configured geometry.
+	virtual bool GetSampleAreas(std::vector<LEDSampleArea>& /*outAreas*/) { return false; }
+};
+
+
+// Releases frames at a fixed interval on the wall clock, for sources that aren't paced by a compositor.
+// An interval of zero releases them as fast as they are requested.
+class FramePacer
+{
+public:
+
+	void Reset() { m_bStarted = false; }
+
+	// Waits until the interval has passed since the previous frame. Returns false if that is beyond the timeout, the frame then stays pending.
+	bool WaitNextFrame(float intervalMS, uint32_t timeoutMS);
+
+protected:
+
+	bool m_bStarted = false;
+	std::chrono::steady_clock::time_point m_lastFrameTime;
+};
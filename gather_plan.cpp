@@ -0,0 +1,58 @@
+#include "gather_plan.h"
+
+#include <cmath>
+
+
+static inline float Saturate(float value)
+{
+	return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+
+LEDTileInfo GetLEDTileInfo(const LEDSampleArea& area, uint32_t frameWidth, uint32_t frameHeight)
+{
+	LEDTileInfo info;
+
+	info.xMin = (uint32_t)floorf(Saturate(area.xMin) * (float)frameWidth);
+	info.yMin = (uint32_t)floorf(Saturate(area.yMin) * (float)frameHeight);
+	info.xMax = (uint32_t)ceilf(Saturate(area.xMax) * (float)frameWidth);
+	info.yMax = (uint32_t)ceilf(Saturate(area.yMax) * (float)frameHeight);
+
+	info.xMax = info.xMax > info.xMin ? info.xMax : info.xMin;
+	info.yMax = info.yMax > info.yMin ? info.yMax : info.yMin;
+
+	// Partial tiles at the edges are included, the shader skips the pixels outside the area.
+	info.numTilesX = (info.xMax - info.xMin + GATHER_TILE_PIXELS - 1) / GATHER_TILE_PIXELS;
+	info.numTilesY = (info.yMax - info.yMin + GATHER_TILE_PIXELS - 1) / GATHER_TILE_PIXELS;
+
+	info.eye = area.eye;
+
+	return info;
+}
+
+
+void GatherPlan::Build(const std::vector<LEDSampleArea>& areas, int numLEDs, uint32_t frameWidth, uint32_t frameHeight)
+{
+	LEDTiles.resize(numLEDs);
+	WorkItems.clear();
+
+	for (int i = 0; i < numLEDs; i++)
+	{
+		LEDTileInfo& info = LEDTiles[i];
+
+		info = GetLEDTileInfo(areas[i], frameWidth, frameHeight);
+		info.firstTile = (uint32_t)WorkItems.size();
+
+		for (uint32_t tileY = 0; tileY < info.numTilesY; tileY++)
+		{
+			for (uint32_t tileX = 0; tileX < info.numTilesX; tileX++)
+			{
+				GatherWorkItem item;
+				item.ledID = (uint32_t)i;
+				item.tile = tileX | (tileY << 16);
+
+				WorkItems.push_back(item);
+			}
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "structures.h"
+
+// Must match TILE_PIXELS_X/Y in gather_light_cs.hlsl.
+#define GATHER_TILE_PIXELS 32
+
+
+// Pixel bounds and tile range of an LED, matches LEDTileInfo in the gather and combine shaders.
+struct alignas(16) LEDTileInfo
+{
+	uint32_t xMin = 0;
+	uint32_t yMin = 0;
+	uint32_t xMax = 0;
+	uint32_t yMax = 0;
+
+	// Index of the first tile of the LED in the work list, its tiles are stored contiguously row by row.
+	uint32_t firstTile = 0;
+	uint32_t numTilesX = 0;
+	uint32_t numTilesY = 0;
+	uint32_t eye = 0;
+};
+
+// One thread group of the gather pass, covering a single tile of a single LED.
+struct GatherWorkItem
+{
+	uint32_t ledID = 0;
+	uint32_t tile = 0; // Tile X in the low 16 bits, tile Y in the high 16 bits
+};
+
+static_assert(sizeof(LEDTileInfo) == 32 && sizeof(GatherWorkItem) == 8, "Layouts must match the shader structures");
+
+
+// Pixel bounds of an LED area, rounded outwards, and the number of tiles needed to cover them.
+LEDTileInfo GetLEDTileInfo(const LEDSampleArea& area, uint32_t frameWidth, uint32_t frameHeight);
+
+
+// Compacted list of every (LED, tile) pair, so the gather dispatch is sized to the tiles actually covered
+// instead of every LED launching as many groups as the largest one.
+struct GatherPlan
+{
+	std::vector<LEDTileInfo> LEDTiles;
+	std::vector<GatherWorkItem> WorkItems;
+
+	void Build(const std::vector<LEDSampleArea>& areas, int numLEDs, uint32_t frameWidth, uint32_t frameHeight);
+
+	uint32_t GetNumTiles() const { return (uint32_t)WorkItems.size(); }
+};
@@ -0,0 +1,248 @@
+#include "gather_reference.h"
+
+#include <cmath>
+
+
+static inline float Saturate(float value)
+{
+	return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+
+void CopyToCPUFrame(const RGBAImageView& image, CPUFrame& outFrame)
+{
+	outFrame.Resize(image.Width, image.Height);
+
+	for (uint32_t y = 0; y < image.Height; y++)
+	{
+		const uint8_t* source = image.GetRow(y);
+		float* dest = &outFrame.Pixels[(size_t)y * image.Width * 3];
+
+		for (uint32_t x = 0; x < image.Width; x++)
+		{
+			dest[x * 3 + 0] = source[x * 4 + 0] / 255.0f;
+			dest[x * 3 + 1] = source[x * 4 + 1] / 255.0f;
+			dest[x * 3 + 2] = source[x * 4 + 2] / 255.0f;
+		}
+	}
+}
+
+
+void GatherTileSum_Reference(const CPUFrame& frame, const LEDTileInfo& info, uint32_t tileX, uint32_t tileY, uint32_t outSum[3])
+{
+	outSum[0] = outSum[1] = outSum[2] = 0;
+
+	// Each shader thread gathers the 2x2 texel quad starting at its sample position,
+	// skipping the texels past the right and bottom edges of the area.
+	for (uint32_t localY = 0; localY < GATHER_TILE_PIXELS / 2; localY++)
+	{
+		uint32_t sampleY = info.yMin + tileY * GATHER_TILE_PIXELS + localY * 2;
+
+		if (sampleY >= info.yMax)
+		{
+			break;
+		}
+
+		for (uint32_t localX = 0; localX < GATHER_TILE_PIXELS / 2; localX++)
+		{
+			uint32_t sampleX = info.xMin + tileX * GATHER_TILE_PIXELS + localX * 2;
+
+			if (sampleX >= info.xMax)
+			{
+				break;
+			}
+
+			for (uint32_t quad = 0; quad < 4; quad++)
+			{
+				uint32_t x = sampleX + (quad & 1);
+				uint32_t y = sampleY + (quad >> 1);
+
+				if (x >= info.xMax || y >= info.yMax)
+				{
+					continue;
+				}
+
+				const float* pixel = frame.GetPixel(x, y);
+
+				outSum[0] += QuantizeChannel(pixel[0]);
+				outSum[1] += QuantizeChannel(pixel[1]);
+				outSum[2] += QuantizeChannel(pixel[2]);
+			}
+		}
+	}
+}
+
+void SampleLEDs_Reference(const CPUFrame& leftEye, const CPUFrame& rightEye, const std::vector<LEDSampleArea>& areas, std::vector<LEDShaderOutput>& output)
+{
+	output.resize(areas.size());
+
+	// The frame size is taken from the left eye, like in the renderer.
+	GatherPlan plan;
+	plan.Build(areas, (int)areas.size(), leftEye.Width, leftEye.Height);
+
+	for (size_t i = 0; i < areas.size(); i++)
+	{
+		const LEDTileInfo& info = plan.LEDTiles[i];
+		const CPUFrame& frame = info.eye == 0 ? leftEye : rightEye;
+
+		uint32_t ledSum[3] = { 0, 0, 0 };
+
+		for (uint32_t tileY = 0; tileY < info.numTilesY; tileY++)
+		{
+			for (uint32_t tileX = 0; tileX < info.numTilesX; tileX++)
+			{
+				uint32_t tileSum[3];
+				GatherTileSum_Reference(frame, info, tileX, tileY, tileSum);
+
+				ledSum[0] += tileSum[0];
+				ledSum[1] += tileSum[1];
+				ledSum[2] += tileSum[2];
+			}
+		}
+
+		double numPixels = (double)((info.xMax - info.xMin) * (info.yMax - info.yMin));
+		double divisor = 255.0 * (numPixels > 1.0 ? numPixels : 1.0);
+
+		output[i] = LEDShaderOutput(ledSum[0] / divisor, ledSum[1] / divisor, ledSum[2] / divisor);
+	}
+}
+
+
+void BuildMipChain_Reference(const CPUFrame& frame, std::vector<CPUFrame>& outLevels)
+{
+	outLevels.clear();
+	outLevels.push_back(frame);
+
+	while (outLevels.back().Width > 1 || outLevels.back().Height > 1)
+	{
+		const CPUFrame& source = outLevels.back();
+		CPUFrame level;
+
+		level.Resize(source.Width > 1 ? source.Width / 2 : 1, source.Height > 1 ? source.Height / 2 : 1);
+
+		for (uint32_t y = 0; y < level.Height; y++)
+		{
+			uint32_t y0 = y * 2 < source.Height ? y * 2 : source.Height - 1;
+			uint32_t y1 = y * 2 + 1 < source.Height ? y * 2 + 1 : source.Height - 1;
+
+			for (uint32_t x = 0; x < level.Width; x++)
+			{
+				uint32_t x0 = x * 2 < source.Width ? x * 2 : source.Width - 1;
+				uint32_t x1 = x * 2 + 1 < source.Width ? x * 2 + 1 : source.Width - 1;
+
+				float* pixel = &level.Pixels[((size_t)y * level.Width + x) * 3];
+
+				for (int c = 0; c < 3; c++)
+				{
+					pixel[c] = 0.25f * (source.GetPixel(x0, y0)[c] + source.GetPixel(x1, y0)[c] + source.GetPixel(x0, y1)[c] + source.GetPixel(x1, y1)[c]);
+				}
+			}
+		}
+
+		outLevels.push_back(std::move(level));
+	}
+}
+
+// Bilinear filtered sample with clamp addressing, like SampleLevel with a linear sampler.
+static void SampleBilinear(const CPUFrame& frame, float u, float v, float outColor[3])
+{
+	float x = u * frame.Width - 0.5f;
+	float y = v * frame.Height - 0.5f;
+
+	float xFloor = floorf(x);
+	float yFloor = floorf(y);
+	float fracX = x - xFloor;
+	float fracY = y - yFloor;
+
+	int maxX = (int)frame.Width - 1;
+	int maxY = (int)frame.Height - 1;
+	int x0 = (int)xFloor;
+	int y0 = (int)yFloor;
+	int x1 = x0 + 1 > maxX ? maxX : x0 + 1;
+	int y1 = y0 + 1 > maxY ? maxY : y0 + 1;
+	x0 = x0 < 0 ? 0 : (x0 > maxX ? maxX : x0);
+	y0 = y0 < 0 ? 0 : (y0 > maxY ? maxY : y0);
+	x1 = x1 < 0 ? 0 : x1;
+	y1 = y1 < 0 ? 0 : y1;
+
+	for (int c = 0; c < 3; c++)
+	{
+		float top = frame.GetPixel(x0, y0)[c] * (1.0f - fracX) + frame.GetPixel(x1, y0)[c] * fracX;
+		float bottom = frame.GetPixel(x0, y1)[c] * (1.0f - fracX) + frame.GetPixel(x1, y1)[c] * fracX;
+		outColor[c] = top * (1.0f - fracY) + bottom * fracY;
+	}
+}
+
+void SampleLEDsMip_Reference(const std::vector<CPUFrame>& leftMips, const std::vector<CPUFrame>& rightMips, const std::vector<LEDSampleArea>& areas, uint32_t taps, std::vector<LEDShaderOutput>& output)
+{
+	output.resize(areas.size());
+
+	if (leftMips.empty() || rightMips.empty())
+	{
+		return;
+	}
+
+	taps = taps < 1 ? 1 : taps;
+
+	for (size_t i = 0; i < areas.size(); i++)
+	{
+		const std::vector<CPUFrame>& mips = areas[i].eye == 0 ? leftMips : rightMips;
+
+		float xMin = Saturate(areas[i].xMin);
+		float yMin = Saturate(areas[i].yMin);
+		float spacingX = (Saturate(areas[i].xMax) - xMin) / taps;
+		float spacingY = (Saturate(areas[i].yMax) - yMin) / taps;
+
+		// The frame size is taken from the left eye, like in the renderer.
+		float spacingPixels = fmaxf(spacingX * leftMips[0].Width, spacingY * leftMips[0].Height);
+		float lod = log2f(fmaxf(spacingPixels, 1.0f));
+
+		int maxLevel = (int)mips.size() - 1;
+		lod = lod < (float)maxLevel ? lod : (float)maxLevel;
+		int level0 = (int)floorf(lod);
+		int level1 = level0 + 1 < maxLevel ? level0 + 1 : maxLevel;
+		float levelFrac = lod - level0;
+
+		double sum[3] = { 0.0, 0.0, 0.0 };
+
+		for (uint32_t y = 0; y < taps; y++)
+		{
+			for (uint32_t x = 0; x < taps; x++)
+			{
+				float u = xMin + (x + 0.5f) * spacingX;
+				float v = yMin + (y + 0.5f) * spacingY;
+
+				float color0[3];
+				float color1[3];
+				SampleBilinear(mips[level0], u, v, color0);
+				SampleBilinear(mips[level1], u, v, color1);
+
+				for (int c = 0; c < 3; c++)
+				{
+					sum[c] += color0[c] * (1.0f - levelFrac) + color1[c] * levelFrac;
+				}
+			}
+		}
+
+		double numTaps = (double)(taps * taps);
+		output[i] = LEDShaderOutput(sum[0] / numTaps, sum[1] / numTaps, sum[2] / numTaps);
+	}
+}
+
+double MaxSampleError(const std::vector<LEDShaderOutput>& a, const std::vector<LEDShaderOutput>& b)
+{
+	double maxError = 0.0;
+	size_t count = a.size() < b.size() ? a.size() : b.size();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		double errors[3] = { fabs(a[i].r - b[i].r), fabs(a[i].g - b[i].g), fabs(a[i].b - b[i].b) };
+
+		for (int c = 0; c < 3; c++)
+		{
+			maxError = errors[c] > maxError ? errors[c] : maxError;
+		}
+	}
+
+	return maxError;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "structures.h"
+#include "gather_plan.h"
+#include "rgba_frame.h"
+
+
+// Frame held on the CPU, storing the floating point values the shaders read from the mirror texture.
+struct CPUFrame
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+
+	// Interleaved RGB, row major.
+	std::vector<float> Pixels;
+
+	void Resize(uint32_t width, uint32_t height)
+	{
+		Width = width;
+		Height = height;
+		Pixels.resize((size_t)width * height * 3);
+	}
+
+	const float* GetPixel(uint32_t x, uint32_t y) const { return &Pixels[((size_t)y * Width + x) * 3]; }
+};
+
+// Converts 8-bit RGBA to the normalized values the shaders read from the mirror texture.
+void CopyToCPUFrame(const RGBAImageView& image, CPUFrame& outFrame);
+
+
+// Same conversion as "uint4 red = GatherRed(...) * 255" in the shaders, single precision and truncated.
+inline uint32_t QuantizeChannel(float value)
+{
+	float scaled = value * 255.0f;
+	return scaled > 0.0f ? (uint32_t)scaled : 0;
+}
+
+
+// CPU reference implementations of the gather and combine passes, for checking the GPU results without a GPU.
+// The per-tile and per-LED sums are integer, so they are identical regardless of the reduction order the GPU uses.
+
+// Sums the 8-bit quantized color over one tile of an LED, like a single gather_light_cs thread group.
+void GatherTileSum_Reference(const CPUFrame& frame, const LEDTileInfo& info, uint32_t tileX, uint32_t tileY, uint32_t outSum[3]);
+
+// Full gather and combine for all LEDs, producing the values read back into LEDSampleData::sampleOutput.
+void SampleLEDs_Reference(const CPUFrame& leftEye, const CPUFrame& rightEye, const std::vector<LEDSampleArea>& areas, std::vector<LEDShaderOutput>& output);
+
+
+// Mip chain of a frame, level 0 being the frame itself. Each level is a 2x2 box filter of the previous one,
+// approximating ID3D11DeviceContext::GenerateMips, whose exact filter is up to the driver.
+void BuildMipChain_Reference(const CPUFrame& frame, std::vector<CPUFrame>& outLevels);
+
+// Reference of sample_mip_cs, taps x taps trilinear samples per LED at the level matching the tap spacing.
+void SampleLEDsMip_Reference(const std::vector<CPUFrame>& leftMips, const std::vector<CPUFrame>& rightMips, const std::vector<LEDSampleArea>& areas, uint32_t taps, std::vector<LEDShaderOutput>& output);
+
+// Largest per-channel difference between two sets of LED colors, for comparing the sampling modes.
+double MaxSampleError(const std::vector<LEDShaderOutput>& a, const std::vector<LEDShaderOutput>& b);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "structures.h"
+#include "frame_source.h"
+
+
+// Time spent in each pass of a frame, as measured by the renderer.
+struct GPUPassTimes
+{
+	float PrepareMS = 0;
+	float SampleMS = 0;
+	float CombineMS = 0;
+	float ReadbackMS = 0;
+};
+
+
+// Sampling backend of the light sampler, computing the per-LED colors of a frame.
+class ILightRenderer
+{
+public:
+
+	virtual ~ILightRenderer() {}
+
+	virtual bool InitRenderer() = 0;
+	virtual bool IsIntialized() = 0;
+
+	// Fills sampleOutput, or gradedOutput when IsOutputGraded is set. Returns false if no results are available this frame.
+	virtual bool Render(std::shared_ptr<LEDSampleData> ledData) = 0;
+
+	// Frames sampled by the next Render call, for renderers working on frames in CPU memory. They have to stay valid until it returns.
+	virtual void SetFrames(const RGBAImageView& /*left*/, const RGBAImageView& /*right*/) {}
+
+	// Time from submitting a frame to its results being read back, for backends that run asynchronously.
+	virtual float GetReadbackLatencyMS() const { return 0; }
+
+	virtual const GPUPassTimes& GetGPUPassTimes() const
+	{
+		static const GPUPassTimes noTimes;
+		return noTimes;
+	}
+
+	// Reads back a copy of the frames reduced by 2^level in each dimension, for recording.
+	virtual void SetFrameCapture(bool /*bEnable*/, uint32_t /*level*/) {}
+
+	// Newest captured frame read back since the previous call, if any.
+	virtual bool GetCapturedFrame(StereoFrame& /*outFrame*/) { return false; }
+
+	// Makes the next frame re-acquire the mirror textures, for when the compositor may have recreated them.
+	virtual void InvalidateMirrorTextures() {}
+};
@@ -11,6 +11,8 @@
 #include "settings_manager.h"
 #include "settings_menu.h"
 #include "async_data.h"
+#include "replay_frame_source.h"
+#include "file_frame_source.h"
 #include "spdlog/sinks/basic_file_sink.h"
 #include "spdlog/sinks/dup_filter_sink.h"
 #include "spdlog/sinks/msvc_sink.h"
@@ -31,6 +33,8 @@
 
 #define LOG_FILE_DIR L"OpenVR Ambient Light"
 #define LOG_FILE_NAME L"log.txt"
+#define RECORDING_DIR L"recordings"
+#define RECORDING_EXTENSION L".alrec"
 
 #define OPENVR_APP_KEY "no_vendor.openvr_ambient_light"
 #define VR_MANIFEST_FILE_NAME "openvr_ambient_light.vrmanifest"
@@ -45,6 +49,8 @@ std::shared_ptr<spdlog::logger> g_logger;
 std::shared_ptr<spdlog::sinks::ringbuffer_sink_mt> g_logRingbuffer;
 
 AsyncData g_asyncData;
+std::string g_recordingDirectory;
+std::filesystem::path g_replayPath;
 
 HINSTANCE g_hInstance;
 HANDLE g_instanceMutex;
@@ -108,6 +114,10 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
         {
             g_bExitOnClose = true;
         }
+        if (_wcsicmp(arglist[i], L"--replay") == 0 && i + 1 < numArgs)
+        {
+            g_replayPath = arglist[++i];
+        }
     }
 
     // Set a mutex to prevent multiple instances of the application.
@@ -145,6 +155,11 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 
         g_logger->info("Starting OpenVR Ambient Light version {}", APP_VERSION);
         g_logger->info("Logging to {}", logFileName);
+
+        std::error_code error;
+        std::filesystem::path recordingPath = std::filesystem::path(localAppDataPath) / LOG_FILE_DIR / RECORDING_DIR;
+        std::filesystem::create_directories(recordingPath, error);
+        g_recordingDirectory = recordingPath.string();
     }
 
     {
@@ -230,6 +245,14 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
                 PostQuitMessage(0);
                 g_bRun = false;
             }
+            else if (event.eventType == vr::VREvent_SteamVRSectionSettingChanged || event.eventType == vr::VREvent_SceneApplicationChanged)
+            {
+                // The render resolution may have changed, which recreates the mirror textures.
+                if (g_lightSampler.get())
+                {
+                    g_lightSampler->SetMirrorTexturesInvalidated();
+                }
+            }
         }
 
         std::this_thread::yield();
@@ -255,23 +278,42 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 
 bool TryInitSteamVRAndSampler()
 {
-    vr::EVRInitError initError;
+    // Replays are sampled on the CPU and don't need SteamVR running.
+    if (g_replayPath.empty())
+    {
+        vr::EVRInitError initError;
 
-    vr::VR_Init(&initError, vr::VRApplication_Background, nullptr);
+        vr::VR_Init(&initError, vr::VRApplication_Background, nullptr);
+
+        if (initError != vr::VRInitError_None)
+        {
+            g_logger->warn("SteamVR not initialized: {}", vr::VR_GetVRInitErrorAsEnglishDescription(initError));
+            return false;
+        }
 
-    if (initError != vr::VRInitError_None)
-    {
-        g_logger->warn("SteamVR not initialized: {}", vr::VR_GetVRInitErrorAsEnglishDescription(initError));
-        return false;
-    }
-    else
-    {
         UpdateOpenVRAppManifest();
         g_asyncData.SteamVRInitialized = true;
-        g_lightSampler = std::make_unique<AmbientLightSampler>(g_settingsManager, g_asyncData);
-        g_lightSampler->InitSampler();
-        return true;
     }
+
+    g_lightSampler = std::make_unique<AmbientLightSampler>(g_settingsManager, g_asyncData, g_recordingDirectory);
+
+    // Plays a recorded session or raw frame file in a loop instead of sampling the headset.
+    if (!g_replayPath.empty())
+    {
+        g_logger->info(L"Replaying {}", g_replayPath.wstring());
+
+        if (_wcsicmp(g_replayPath.extension().c_str(), RECORDING_EXTENSION) == 0)
+        {
+            g_lightSampler->SetFrameSource(std::make_unique<ReplayFrameSource>(g_replayPath.string(), true, true));
+        }
+        else
+        {
+            g_lightSampler->SetFrameSource(std::make_unique<FileFrameSource>(g_replayPath.string(), true, true));
+        }
+    }
+
+    g_lightSampler->InitSampler();
+    return true;
 }
 
 void UpdateOpenVRAppManifest(bool bInstall, bool bUninstall)
@@ -388,13 +430,14 @@ void DispatchSettingsUpdated(int updateType)
             {
                 g_logger->info("Enabling lights...");
 
-                if (!g_asyncData.SteamVRInitialized && !TryInitSteamVRAndSampler())
+                if (!g_asyncData.SteamVRInitialized || !g_replayPath.empty())
                 {
-                     return;
+                    TryInitSteamVRAndSampler();
+                    return;
                 }
 
                 g_lightSampler.reset();
-                g_lightSampler = std::make_unique<AmbientLightSampler>(g_settingsManager, g_asyncData);
+                g_lightSampler = std::make_unique<AmbientLightSampler>(g_settingsManager, g_asyncData, g_recordingDirectory);
                 g_lightSampler->InitSampler();
             }
         }
@@ -0,0 +1,172 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize = {};
+
+	// Empty files can't be mapped.
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || (uint64_t)fileSize.QuadPart > SIZE_MAX)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+	m_data = (const uint8_t*)data;
+	m_size = (uint64_t)fileSize.QuadPart;
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+
+	if (m_mappingHandle)
+	{
+		CloseHandle(m_mappingHandle);
+	}
+
+	if (m_fileHandle)
+	{
+		CloseHandle(m_fileHandle);
+	}
+
+	m_data = nullptr;
+	m_size = 0;
+	m_mappingHandle = nullptr;
+	m_fileHandle = nullptr;
+}
+
+void MappedFile::Prefetch(uint64_t offset, uint64_t size) const
+{
+	if (!m_data || offset >= m_size)
+	{
+		return;
+	}
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = (PVOID)(m_data + offset);
+	range.NumberOfBytes = (SIZE_T)(size < m_size - offset ? size : m_size - offset);
+
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	int fileDescriptor = open(path.c_str(), O_RDONLY);
+
+	if (fileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat = {};
+
+	// Empty files can't be mapped.
+	if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0 || (uint64_t)fileStat.st_size > SIZE_MAX)
+	{
+		close(fileDescriptor);
+		return false;
+	}
+
+	void* data = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+
+	if (data == MAP_FAILED)
+	{
+		close(fileDescriptor);
+		return false;
+	}
+
+	m_fileDescriptor = fileDescriptor;
+	m_data = (const uint8_t*)data;
+	m_size = (uint64_t)fileStat.st_size;
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_data)
+	{
+		munmap((void*)m_data, (size_t)m_size);
+	}
+
+	if (m_fileDescriptor >= 0)
+	{
+		close(m_fileDescriptor);
+	}
+
+	m_data = nullptr;
+	m_size = 0;
+	m_fileDescriptor = -1;
+}
+
+void MappedFile::Prefetch(uint64_t offset, uint64_t size) const
+{
+	if (!m_data || offset >= m_size)
+	{
+		return;
+	}
+
+	// madvise needs a page aligned start.
+	const uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+	const uint64_t start = offset & ~(pageSize - 1);
+	const uint64_t end = offset + size < m_size ? offset + size : m_size;
+
+	madvise((void*)(m_data + start), (size_t)(end - start), MADV_WILLNEED);
+}
+
+#endif
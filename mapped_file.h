@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+// Read-only mapping of a whole file into memory. Pages are loaded on first access and can be evicted again,
+// so files larger than the physical memory can be mapped, as long as they fit in the address space.
+class MappedFile
+{
+public:
+
+	MappedFile() {}
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return m_data != nullptr; }
+
+	const uint8_t* GetData() const { return m_data; }
+	uint64_t GetSize() const { return m_size; }
+
+	// Hints that a range will be read soon, so it can be loaded in the background.
+	void Prefetch(uint64_t offset, uint64_t size) const;
+
+protected:
+
+	const uint8_t* m_data = nullptr;
+	uint64_t m_size = 0;
+
+#ifdef _WIN32
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+#else
+	int m_fileDescriptor = -1;
+#endif
+};
@@ -2,6 +2,130 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
+#include <bit>
+
+
+// Fast approximate math functions, selectable at compile time.
+// Error bounds are maximum errors in units in the last place against the standard library, measured by
+// benchmark/math_check.cpp. Single precision cube roots are swept exhaustively, the rest over strided bit patterns.
+//
+// Exact:   Uses the standard library.
+// Fast:    Cbrt 15 ulp (float) / 5300 ulp (double) for inputs in [0.008, 2].
+//          Under 1e-9 deltaE in LinearRGBtoLAB_D65, under 1e-11 in LinearRGBtoOklab.
+// Fastest: Cbrt 11100 ulp (float) / 5.5e9 ulp (double) for inputs in [0.008, 2].
+//          Under 0.001 deltaE in LinearRGBtoLAB_D65, under 1e-5 in LinearRGBtoOklab.
+//
+// Pow is the same for both approximate variants, 128 ulp (float) / 1e8 ulp (double)
+// for bases in [1e-6, 4], exponents in [0.25, 10] and results above FLT_MIN.
+
+enum class EMathPrecision
+{
+    Exact,
+    Fast,
+    Fastest
+};
+
+// Initial cube root estimate by dividing the exponent bits by three.
+inline float CbrtEstimate(float x)
+{
+    uint32_t bits = std::bit_cast<uint32_t>(x);
+    return std::bit_cast<float>(bits / 3 + 709921077u);
+}
+
+inline double CbrtEstimate(double x)
+{
+    uint64_t bits = std::bit_cast<uint64_t>(x);
+    return std::bit_cast<double>(bits / 3 + 0x2A9F789300000000ull);
+}
+
+// Cube root for positive inputs.
+template<EMathPrecision Precision = EMathPrecision::Exact, typename T>
+inline T Cbrt(T x)
+{
+    if constexpr (Precision == EMathPrecision::Exact)
+    {
+        return std::cbrt(x);
+    }
+    else
+    {
+        constexpr int numSteps = (Precision == EMathPrecision::Fast ? 2 : 1) + (sizeof(T) == sizeof(double) ? 1 : 0);
+
+        T y = CbrtEstimate(x);
+
+        for (int i = 0; i < numSteps; i++)
+        {
+            y = (T(2) * y + x / (y * y)) * T(1.0 / 3.0);
+        }
+        return y;
+    }
+}
+
+// Base 2 logarithm for positive normal inputs, using the Cephes logf polynomial.
+template<typename T>
+inline T FastLog2(T x)
+{
+    int exponent;
+    T mantissa = std::frexp(x, &exponent);
+
+    // Keep the mantissa in [sqrt(0.5), sqrt(2)) to center the polynomial.
+    if (mantissa < T(0.70710678))
+    {
+        mantissa *= T(2);
+        exponent--;
+    }
+
+    T m = mantissa - T(1);
+    T m2 = m * m;
+
+    T p = T(7.0376836292E-2);
+    p = p * m - T(1.1514610310E-1);
+    p = p * m + T(1.1676998740E-1);
+    p = p * m - T(1.2420140846E-1);
+    p = p * m + T(1.4249322787E-1);
+    p = p * m - T(1.6668057665E-1);
+    p = p * m + T(2.0000714765E-1);
+    p = p * m - T(2.4999993993E-1);
+    p = p * m + T(3.3333331174E-1);
+    p = p * m * m2 - T(0.5) * m2;
+
+    return (m + p) * T(1.4426950408889634) + (T)exponent;
+}
+
+// Base 2 exponent, using the Cephes exp2f polynomial.
+template<typename T>
+inline T FastExp2(T x)
+{
+    x = x < T(-126) ? T(-126) : (x > T(127) ? T(127) : x);
+
+    T n = std::floor(x + T(0.5));
+    T f = x - n;
+
+    T p = T(1.535336188319500E-4);
+    p = p * f + T(1.339887440266574E-3);
+    p = p * f + T(9.618437357674640E-3);
+    p = p * f + T(5.550332471162809E-2);
+    p = p * f + T(2.402264791363012E-1);
+    p = p * f + T(6.931472028550421E-1);
+    p = p * f + T(1);
+
+    return std::ldexp(p, (int)n);
+}
+
+// Power function for positive bases.
+template<EMathPrecision Precision = EMathPrecision::Exact, typename T>
+inline T Pow(T x, T y)
+{
+    if constexpr (Precision == EMathPrecision::Exact)
+    {
+        return std::pow(x, y);
+    }
+    else
+    {
+        return FastExp2(FastLog2(x) * y);
+    }
+}
+
 
 // CIELAB to linear RGB conversions
 
@@ -11,6 +135,7 @@ static constexpr double D65RefY = 100.0 / 100.0;
 static constexpr double D65RefZ = 108.884 / 100.0;
 
 
+template<EMathPrecision Precision = EMathPrecision::Exact>
 inline void LinearRGBtoLAB_D65(double inRed, double inGreen, double inBlue, double& outL, double& outA, double& outB)
 {
     double x = (inRed * 0.4124564 + inGreen * 0.3575761 + inBlue * 0.1804375) / D65RefX;
@@ -18,9 +143,9 @@ inline void LinearRGBtoLAB_D65(double inRed, double inGreen, double inBlue, doub
     double z = (inRed * 0.0193339 + inGreen * 0.1191920 + inBlue * 0.9503041) / D65RefZ;
 
 
-    x = (x > 0.008856) ? pow(x, 1.0 / 3.0) : (7.787 * x) + (16.0 / 116.0);
-    y = (y > 0.008856) ? pow(y, 1.0 / 3.0) : (7.787 * y) + (16.0 / 116.0);
-    z = (z > 0.008856) ? pow(z, 1.0 / 3.0) : (7.787 * z) + (16.0 / 116.0);
+    x = (x > 0.008856) ? Cbrt<Precision>(x) : (7.787 * x) + (16.0 / 116.0);
+    y = (y > 0.008856) ? Cbrt<Precision>(y) : (7.787 * y) + (16.0 / 116.0);
+    z = (z > 0.008856) ? Cbrt<Precision>(z) : (7.787 * z) + (16.0 / 116.0);
 
     outL = (116.0 * y) - 16.0;
     outA = 500.0 * (x - y);
@@ -28,6 +153,7 @@ inline void LinearRGBtoLAB_D65(double inRed, double inGreen, double inBlue, doub
 }
 
 
+template<EMathPrecision Precision = EMathPrecision::Exact>
 inline void LABtoLinearRGB_D65(double inL, double inA, double inB, double& outRed, double& outGreen, double& outBlue)
 {
     double y = (inL + 16.0) / 116.0;
@@ -35,9 +161,9 @@ inline void LABtoLinearRGB_D65(double inL, double inA, double inB, double& outRe
     double z = y - inB / 200.0;
 
 
-    x = ((x > 0.206897) ? pow(x, 3.0) : (x - 16.0 / 116.0) / 7.787);
-    y = ((y > 0.206897) ? pow(y, 3.0) : (y - 16.0 / 116.0) / 7.787);
-    z = ((z > 0.206897) ? pow(z, 3.0) : (z - 16.0 / 116.0) / 7.787);
+    x = ((x > 0.206897) ? x * x * x : (x - 16.0 / 116.0) / 7.787);
+    y = ((y > 0.206897) ? y * y * y : (y - 16.0 / 116.0) / 7.787);
+    z = ((z > 0.206897) ? z * z * z : (z - 16.0 / 116.0) / 7.787);
 
     x *= D65RefX;
     y *= D65RefY;
@@ -46,4 +172,41 @@ inline void LABtoLinearRGB_D65(double inL, double inA, double inB, double& outRe
     outRed = x * 3.2404542 + y * -1.5371385 + z * -0.4985314;
     outGreen = x * -0.9692660 + y * 1.8760108 + z * 0.0415560;
     outBlue = x * 0.0556434 + y * -0.2040259 + z * 1.0572252;
-}
\ No newline at end of file
+}
+
+
+// Oklab to linear RGB conversions
+// From: https://bottosson.github.io/posts/oklab/
+// Cheaper than CIELAB, with no reference white normalization or piecewise segments.
+
+template<EMathPrecision Precision = EMathPrecision::Exact>
+inline void LinearRGBtoOklab(double inRed, double inGreen, double inBlue, double& outL, double& outA, double& outB)
+{
+    double l = 0.4122214708 * inRed + 0.5363325363 * inGreen + 0.0514459929 * inBlue;
+    double m = 0.2119034982 * inRed + 0.6806995451 * inGreen + 0.1073969566 * inBlue;
+    double s = 0.0883024619 * inRed + 0.2817188376 * inGreen + 0.6299787005 * inBlue;
+
+    l = (l > 0.0) ? Cbrt<Precision>(l) : 0.0;
+    m = (m > 0.0) ? Cbrt<Precision>(m) : 0.0;
+    s = (s > 0.0) ? Cbrt<Precision>(s) : 0.0;
+
+    outL = 0.2104542553 * l + 0.7936177850 * m - 0.0040720468 * s;
+    outA = 1.9779984951 * l - 2.4285922050 * m + 0.4505937099 * s;
+    outB = 0.0259040371 * l + 0.7827717662 * m - 0.8086757660 * s;
+}
+
+
+inline void OklabtoLinearRGB(double inL, double inA, double inB, double& outRed, double& outGreen, double& outBlue)
+{
+    double l = inL + 0.3963377774 * inA + 0.2158037573 * inB;
+    double m = inL - 0.1055613458 * inA - 0.0638541728 * inB;
+    double s = inL - 0.0894841775 * inA - 1.2914855480 * inB;
+
+    l = l * l * l;
+    m = m * m * m;
+    s = s * s * s;
+
+    outRed = 4.0767416621 * l - 3.3077115913 * m + 0.2309699292 * s;
+    outGreen = -1.2684380046 * l + 2.6097574011 * m - 0.3413193965 * s;
+    outBlue = -0.0041960863 * l - 0.7034186147 * m + 1.7076147010 * s;
+}
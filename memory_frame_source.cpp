@@ -0,0 +1,70 @@
+#include "memory_frame_source.h"
+
+
+MemoryFrameSource::MemoryFrameSource(std::vector<StereoFrame> frames, float frameIntervalMS, bool bLoop)
+	: m_frames(std::move(frames))
+	, m_frameIntervalMS(frameIntervalMS)
+	, m_bLoop(bLoop)
+{
+
+}
+
+bool MemoryFrameSource::InitSource()
+{
+	if (m_frames.empty())
+	{
+		return false;
+	}
+
+	// The renderers sample both eyes with the pixel bounds of the left one.
+	for (const StereoFrame& frame : m_frames)
+	{
+		if (frame.Left.Width != m_frames[0].Left.Width || frame.Left.Height != m_frames[0].Left.Height ||
+			frame.Right.Width != frame.Left.Width || frame.Right.Height != frame.Left.Height)
+		{
+			return false;
+		}
+	}
+
+	m_nextFrame = 0;
+	m_bHasFrame = false;
+	m_pacer.Reset();
+
+	return true;
+}
+
+EFrameWaitResult MemoryFrameSource::WaitFrame(uint32_t timeoutMS)
+{
+	if (m_nextFrame >= m_frames.size())
+	{
+		if (!m_bLoop || m_frames.empty())
+		{
+			return FrameWait_EndOfStream;
+		}
+
+		m_nextFrame = 0;
+	}
+
+	if (!m_pacer.WaitNextFrame(m_frameIntervalMS, timeoutMS))
+	{
+		return FrameWait_TimedOut;
+	}
+
+	m_currentFrame = m_nextFrame++;
+	m_bHasFrame = true;
+
+	return FrameWait_Ready;
+}
+
+bool MemoryFrameSource::GetFrameImages(RGBAImageView& outLeft, RGBAImageView& outRight)
+{
+	if (!m_bHasFrame)
+	{
+		return false;
+	}
+
+	outLeft = m_frames[m_currentFrame].Left.GetView();
+	outRight = m_frames[m_currentFrame].Right.GetView();
+
+	return true;
+}
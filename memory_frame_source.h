@@ -0,0 +1,31 @@
+#pragma once
+
+#include "frame_source.h"
+
+
+// Plays back frames held in memory, for tests and benchmarks.
+class MemoryFrameSource : public IFrameSource
+{
+public:
+
+	// A frame interval of zero plays the frames back as fast as they are consumed, while still reporting no elapsed time.
+	MemoryFrameSource(std::vector<StereoFrame> frames, float frameIntervalMS, bool bLoop = true);
+
+	bool InitSource() override;
+	bool IsActive() override { return true; }
+	EFrameWaitResult WaitFrame(uint32_t timeoutMS) override;
+	float GetFrameIntervalMS() override { return m_frameIntervalMS; }
+	bool HasFrameImages() const override { return true; }
+	bool GetFrameImages(RGBAImageView& outLeft, RGBAImageView& outRight) override;
+
+protected:
+
+	std::vector<StereoFrame> m_frames;
+	float m_frameIntervalMS = 0;
+	bool m_bLoop = true;
+
+	size_t m_nextFrame = 0;
+	size_t m_currentFrame = 0;
+	bool m_bHasFrame = false;
+	FramePacer m_pacer;
+};
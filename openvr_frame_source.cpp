@@ -0,0 +1,26 @@
+#include "openvr_frame_source.h"
+
+#include "profiling.h"
+
+
+bool OpenVRFrameSource::IsActive()
+{
+	vr::EDeviceActivityLevel level = vr::VRSystem()->GetTrackedDeviceActivityLevel(vr::k_unTrackedDeviceIndex_Hmd);
+
+	return !(level == vr::k_EDeviceActivityLevel_Unknown || level == vr::k_EDeviceActivityLevel_Standby || level == vr::k_EDeviceActivityLevel_Idle_Timeout);
+}
+
+EFrameWaitResult OpenVRFrameSource::WaitFrame(uint32_t timeoutMS)
+{
+	vr::EVROverlayError error = vr::VROverlay()->WaitFrameSync(timeoutMS);
+
+	if (error == vr::VROverlayError_TimedOut)
+	{
+		return FrameWait_TimedOut;
+	}
+
+	m_frameIntervalMS = EndPerfTimer(m_lastFrameTime);
+	m_lastFrameTime = StartPerfTimer();
+
+	return FrameWait_Ready;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "framework.h"
+#include "frame_source.h"
+
+
+// Paces the sampler to the compositor and the headset activity. The frames themselves are the compositor
+// mirror textures, which the D3D11 renderer reads directly.
+class OpenVRFrameSource : public IFrameSource
+{
+public:
+
+	bool InitSource() override { return vr::VRSystem() != nullptr && vr::VROverlay() != nullptr; }
+	bool IsActive() override;
+	EFrameWaitResult WaitFrame(uint32_t timeoutMS) override;
+	float GetFrameIntervalMS() override { return m_frameIntervalMS; }
+
+protected:
+
+	LARGE_INTEGER m_lastFrameTime = {};
+	float m_frameIntervalMS = 0;
+};
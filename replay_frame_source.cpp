@@ -0,0 +1,316 @@
+#include "replay_frame_source.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+ReplayFrameSource::ReplayFrameSource(const std::string& path, bool bRealTime, bool bLoop)
+	: m_path(path)
+	, m_bRealTime(bRealTime)
+	, m_bLoop(bLoop)
+{
+
+}
+
+bool ReplayFrameSource::InitSource()
+{
+	if (!m_file.Open(m_path) || m_file.GetSize() < sizeof(SessionFileHeader))
+	{
+		m_file.Close();
+		return false;
+	}
+
+	SessionFileHeader header;
+	memcpy(&header, m_file.GetData(), sizeof(header));
+
+	if (header.Magic != SESSION_FILE_MAGIC || header.Version != SESSION_FILE_VERSION)
+	{
+		m_file.Close();
+		return false;
+	}
+
+	if (!LoadIndex())
+	{
+		BuildIndex();
+	}
+
+	m_nextFrame = 0;
+	m_bFramePending = false;
+	m_bHasFrame = false;
+	m_sampleAreasOffset = 0;
+	m_bSampleAreasChanged = false;
+	m_recordedOutput.clear();
+	m_pacer.Reset();
+
+	return true;
+}
+
+// Returns the payload of a chunk if it's complete and of the expected type.
+const uint8_t* ReplayFrameSource::GetChunk(uint64_t offset, ESessionChunkType type, size_t minSize, SessionChunkHeader& outHeader) const
+{
+	const uint64_t fileSize = m_file.GetSize();
+
+	if (offset < sizeof(SessionFileHeader) || offset > fileSize || fileSize - offset < sizeof(SessionChunkHeader))
+	{
+		return nullptr;
+	}
+
+	memcpy(&outHeader, m_file.GetData() + offset, sizeof(outHeader));
+
+	if (outHeader.Type != type || outHeader.Size < minSize || fileSize - offset - sizeof(SessionChunkHeader) < outHeader.Size)
+	{
+		return nullptr;
+	}
+
+	return m_file.GetData() + offset + sizeof(SessionChunkHeader);
+}
+
+// Reads the index written when the recording was stopped, found through the trailer ending the file.
+bool ReplayFrameSource::LoadIndex()
+{
+	const uint64_t trailerSize = sizeof(SessionChunkHeader) + AlignSessionChunkSize(sizeof(SessionTrailerInfo));
+
+	if (m_file.GetSize() < sizeof(SessionFileHeader) + trailerSize)
+	{
+		return false;
+	}
+
+	SessionChunkHeader header;
+	const uint8_t* payload = GetChunk(m_file.GetSize() - trailerSize, SessionChunk_Trailer, sizeof(SessionTrailerInfo), header);
+
+	if (!payload)
+	{
+		return false;
+	}
+
+	SessionTrailerInfo trailer;
+	memcpy(&trailer, payload, sizeof(trailer));
+
+	payload = trailer.Magic == SESSION_TRAILER_MAGIC ? GetChunk(trailer.IndexOffset, SessionChunk_Index, sizeof(SessionIndexInfo), header) : nullptr;
+
+	if (!payload)
+	{
+		return false;
+	}
+
+	SessionIndexInfo info;
+	memcpy(&info, payload, sizeof(info));
+
+	if (header.Size < sizeof(info) + sizeof(SessionIndexEntry) * (uint64_t)info.NumFrames)
+	{
+		return false;
+	}
+
+	m_index.resize(info.NumFrames);
+	memcpy(m_index.data(), payload + sizeof(info), sizeof(SessionIndexEntry) * info.NumFrames);
+
+	return true;
+}
+
+// Indexes a file without a trailer, such as one cut short, by walking the chunk headers.
+void ReplayFrameSource::BuildIndex()
+{
+	m_index.clear();
+
+	uint64_t offset = sizeof(SessionFileHeader);
+	uint64_t sampleAreasOffset = 0;
+	uint64_t outputOffset = 0;
+
+	while (m_file.GetSize() - offset >= sizeof(SessionChunkHeader))
+	{
+		SessionChunkHeader header;
+		memcpy(&header, m_file.GetData() + offset, sizeof(header));
+
+		// Stops at the incomplete chunk the recording ended on.
+		if (m_file.GetSize() - offset - sizeof(header) < header.Size)
+		{
+			break;
+		}
+
+		if (header.Type == SessionChunk_SampleAreas)
+		{
+			sampleAreasOffset = offset;
+		}
+		else if (header.Type == SessionChunk_Output)
+		{
+			outputOffset = offset;
+		}
+		else if (header.Type == SessionChunk_Frame)
+		{
+			SessionIndexEntry entry;
+			entry.FrameOffset = offset;
+			entry.TimestampUS = header.TimestampUS;
+			entry.SampleAreasOffset = sampleAreasOffset;
+			entry.OutputOffset = outputOffset;
+			m_index.push_back(entry);
+		}
+
+		offset += sizeof(header) + header.Size;
+	}
+}
+
+// Points the images into the mapped file, and picks up the sample areas and output recorded before the frame.
+bool ReplayFrameSource::ReadFrame(size_t frameIndex)
+{
+	const SessionIndexEntry& entry = m_index[frameIndex];
+
+	SessionChunkHeader header;
+	const uint8_t* payload = GetChunk(entry.FrameOffset, SessionChunk_Frame, sizeof(SessionFrameInfo), header);
+
+	if (!payload)
+	{
+		return false;
+	}
+
+	memcpy(&m_frameInfo, payload, sizeof(m_frameInfo));
+
+	// The size comes from the file, so it's checked against the chunk before multiplying. Both images fit in its payload.
+	const uint32_t maxPixels = (header.Size - (uint32_t)sizeof(m_frameInfo)) / 8;
+
+	if (m_frameInfo.Width == 0 || m_frameInfo.Height == 0 || m_frameInfo.Height > maxPixels / m_frameInfo.Width)
+	{
+		return false;
+	}
+
+	const size_t imageSize = (size_t)m_frameInfo.Width * m_frameInfo.Height * 4;
+
+	m_leftImage.Data = payload + sizeof(m_frameInfo);
+	m_leftImage.Width = m_frameInfo.Width;
+	m_leftImage.Height = m_frameInfo.Height;
+	m_leftImage.RowPitch = m_frameInfo.Width * 4;
+
+	m_rightImage = m_leftImage;
+	m_rightImage.Data = m_leftImage.Data + imageSize;
+
+	m_frameTimestampUS = entry.TimestampUS;
+
+	// Only reported when they differ from the ones in use, such as after seeking past a change.
+	payload = entry.SampleAreasOffset != m_sampleAreasOffset ? GetChunk(entry.SampleAreasOffset, SessionChunk_SampleAreas, sizeof(SessionSampleAreasInfo), header) : nullptr;
+
+	if (payload)
+	{
+		SessionSampleAreasInfo info;
+		memcpy(&info, payload, sizeof(info));
+
+		if (header.Size >= sizeof(info) + sizeof(LEDSampleArea) * (uint64_t)info.NumLEDs)
+		{
+			m_sampleAreas.resize(info.NumLEDs);
+			memcpy(m_sampleAreas.data(), payload + sizeof(info), sizeof(LEDSampleArea) * info.NumLEDs);
+			m_sampleAreasOffset = entry.SampleAreasOffset;
+			m_bSampleAreasChanged = true;
+		}
+	}
+
+	m_recordedOutput.clear();
+	payload = entry.OutputOffset != 0 ? GetChunk(entry.OutputOffset, SessionChunk_Output, sizeof(SessionOutputInfo), header) : nullptr;
+
+	if (payload)
+	{
+		SessionOutputInfo info;
+		memcpy(&info, payload, sizeof(info));
+
+		if (header.Size >= sizeof(info) + sizeof(LEDOutputData) * (uint64_t)info.NumLEDs)
+		{
+			m_recordedOutput.resize(info.NumLEDs);
+			memcpy(m_recordedOutput.data(), payload + sizeof(info), sizeof(LEDOutputData) * info.NumLEDs);
+		}
+	}
+
+	// Starts loading the next frame from disk while this one is sampled.
+	if (frameIndex + 1 < m_index.size())
+	{
+		const SessionIndexEntry& nextEntry = m_index[frameIndex + 1];
+		m_file.Prefetch(nextEntry.FrameOffset, sizeof(SessionChunkHeader) + sizeof(SessionFrameInfo) + imageSize * 2);
+	}
+
+	return true;
+}
+
+bool ReplayFrameSource::Seek(uint64_t timestampUS)
+{
+	auto iter = std::lower_bound(m_index.begin(), m_index.end(), timestampUS,
+		[](const SessionIndexEntry& entry, uint64_t timestamp) { return entry.TimestampUS < timestamp; });
+
+	return SeekToFrame(iter == m_index.end() ? m_index.size() - 1 : iter - m_index.begin());
+}
+
+bool ReplayFrameSource::SeekToFrame(size_t frameIndex)
+{
+	if (m_index.empty())
+	{
+		return false;
+	}
+
+	m_nextFrame = frameIndex < m_index.size() ? frameIndex : m_index.size() - 1;
+	m_bFramePending = false;
+	m_pacer.Reset();
+
+	return true;
+}
+
+EFrameWaitResult ReplayFrameSource::WaitFrame(uint32_t timeoutMS)
+{
+	if (!m_file.IsOpen())
+	{
+		return FrameWait_EndOfStream;
+	}
+
+	if (!m_bFramePending)
+	{
+		m_bHasFrame = false;
+
+		if (m_nextFrame >= m_index.size())
+		{
+			if (!m_bLoop || m_index.empty())
+			{
+				return FrameWait_EndOfStream;
+			}
+
+			m_nextFrame = 0;
+		}
+
+		if (!ReadFrame(m_nextFrame))
+		{
+			return FrameWait_EndOfStream;
+		}
+
+		m_nextFrame++;
+		m_bFramePending = true;
+	}
+
+	if (!m_pacer.WaitNextFrame(m_bRealTime ? m_frameInfo.IntervalMS : 0.0f, timeoutMS))
+	{
+		return FrameWait_TimedOut;
+	}
+
+	m_bFramePending = false;
+	m_bHasFrame = true;
+
+	return FrameWait_Ready;
+}
+
+bool ReplayFrameSource::GetFrameImages(RGBAImageView& outLeft, RGBAImageView& outRight)
+{
+	if (!m_bHasFrame)
+	{
+		return false;
+	}
+
+	outLeft = m_leftImage;
+	outRight = m_rightImage;
+
+	return true;
+}
+
+bool ReplayFrameSource::GetSampleAreas(std::vector<LEDSampleArea>& outAreas)
+{
+	if (!m_bSampleAreasChanged)
+	{
+		return false;
+	}
+
+	outAreas = m_sampleAreas;
+	m_bSampleAreasChanged = false;
+
+	return true;
+}
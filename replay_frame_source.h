@@ -0,0 +1,66 @@
+#pragma once
+
+#include "frame_source.h"
+#include "session_recording.h"
+#include "mapped_file.h"
+
+
+// Plays back a recorded session through the sampler, with the recorded frame intervals and sample areas,
+// so the filtering and output reproduce the recording.
+// The file is mapped rather than read, the frames are handed out as views into the mapping without copying.
+class ReplayFrameSource : public IFrameSource
+{
+public:
+
+	// Without real time pacing the frames are read as fast as they are consumed, still reporting the recorded intervals.
+	ReplayFrameSource(const std::string& path, bool bRealTime = true, bool bLoop = false);
+
+	bool InitSource() override;
+	bool IsActive() override { return true; }
+	EFrameWaitResult WaitFrame(uint32_t timeoutMS) override;
+	float GetFrameIntervalMS() override { return m_frameInfo.IntervalMS; }
+	bool HasFrameImages() const override { return true; }
+	bool GetFrameImages(RGBAImageView& outLeft, RGBAImageView& outRight) override;
+	bool GetSampleAreas(std::vector<LEDSampleArea>& outAreas) override;
+
+	// Makes the next frame the first one recorded at or after the timestamp, false if there are no frames.
+	bool Seek(uint64_t timestampUS);
+	bool SeekToFrame(size_t frameIndex);
+
+	size_t GetNumFrames() const { return m_index.size(); }
+	uint64_t GetDurationUS() const { return m_index.empty() ? 0 : m_index.back().TimestampUS - m_index.front().TimestampUS; }
+	uint64_t GetFrameTimestampUS() const { return m_frameTimestampUS; }
+
+	// LED colors recorded most recently before the current frame, for comparing a replay against its recording.
+	const std::vector<LEDOutputData>& GetRecordedOutput() const { return m_recordedOutput; }
+
+protected:
+
+	bool LoadIndex();
+	void BuildIndex();
+	const uint8_t* GetChunk(uint64_t offset, ESessionChunkType type, size_t minSize, SessionChunkHeader& outHeader) const;
+	bool ReadFrame(size_t frameIndex);
+
+	std::string m_path;
+	bool m_bRealTime = true;
+	bool m_bLoop = false;
+
+	MappedFile m_file;
+	std::vector<SessionIndexEntry> m_index;
+
+	size_t m_nextFrame = 0;
+	bool m_bFramePending = false;
+	bool m_bHasFrame = false;
+
+	SessionFrameInfo m_frameInfo;
+	uint64_t m_frameTimestampUS = 0;
+	RGBAImageView m_leftImage;
+	RGBAImageView m_rightImage;
+
+	std::vector<LEDSampleArea> m_sampleAreas;
+	uint64_t m_sampleAreasOffset = 0;
+	bool m_bSampleAreasChanged = false;
+	std::vector<LEDOutputData> m_recordedOutput;
+
+	FramePacer m_pacer;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Pixels of one eye as 8-bit RGBA, the layout of the compositor mirror textures.
+// Points to memory held elsewhere, such as an RGBAFrame or a mapped file.
+struct RGBAImageView
+{
+	const uint8_t* Data = nullptr;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t RowPitch = 0;
+
+	bool IsValid() const { return Data != nullptr && Width > 0 && Height > 0; }
+	const uint8_t* GetRow(uint32_t y) const { return Data + (size_t)y * RowPitch; }
+};
+
+
+// 8-bit RGBA frame owning its pixels, rows tightly packed.
+struct RGBAFrame
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<uint8_t> Pixels;
+
+	void Resize(uint32_t width, uint32_t height)
+	{
+		Width = width;
+		Height = height;
+		Pixels.resize((size_t)width * height * 4);
+	}
+
+	uint8_t* GetPixel(uint32_t x, uint32_t y) { return &Pixels[((size_t)y * Width + x) * 4]; }
+	const uint8_t* GetPixel(uint32_t x, uint32_t y) const { return &Pixels[((size_t)y * Width + x) * 4]; }
+
+	RGBAImageView GetView() const
+	{
+		RGBAImageView view;
+		view.Data = Pixels.data();
+		view.Width = Width;
+		view.Height = Height;
+		view.RowPitch = Width * 4;
+		return view;
+	}
+};
@@ -0,0 +1,366 @@
+#include "session_recording.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+void DownscaleImage(const RGBAImageView& source, uint32_t level, RGBAFrame& outFrame)
+{
+	// Keeps the block sums within 32 bits.
+	level = level < 12 ? level : 12;
+
+	const uint32_t width = (source.Width >> level) > 0 ? source.Width >> level : 1;
+	const uint32_t height = (source.Height >> level) > 0 ? source.Height >> level : 1;
+
+	// Pixels past the last whole block are dropped, like when generating mips.
+	const uint32_t blockWidth = (1u << level) < source.Width ? 1u << level : source.Width;
+	const uint32_t blockHeight = (1u << level) < source.Height ? 1u << level : source.Height;
+	const uint32_t blockPixels = blockWidth * blockHeight;
+
+	outFrame.Resize(width, height);
+
+	std::vector<uint32_t> sums((size_t)width * 4);
+
+	for (uint32_t y = 0; y < height; y++)
+	{
+		std::fill(sums.begin(), sums.end(), 0);
+
+		for (uint32_t blockY = 0; blockY < blockHeight; blockY++)
+		{
+			const uint8_t* row = source.GetRow(y * blockHeight + blockY);
+
+			for (uint32_t x = 0; x < width; x++)
+			{
+				const uint8_t* block = row + (size_t)x * blockWidth * 4;
+				uint32_t* sum = &sums[(size_t)x * 4];
+
+				for (uint32_t i = 0; i < blockWidth * 4; i += 4)
+				{
+					sum[0] += block[i + 0];
+					sum[1] += block[i + 1];
+					sum[2] += block[i + 2];
+					sum[3] += block[i + 3];
+				}
+			}
+		}
+
+		uint8_t* output = outFrame.GetPixel(0, y);
+
+		for (size_t i = 0; i < sums.size(); i++)
+		{
+			output[i] = (uint8_t)((sums[i] + blockPixels / 2) / blockPixels);
+		}
+	}
+}
+
+
+SessionRecorder::~SessionRecorder()
+{
+	Stop();
+}
+
+bool SessionRecorder::Start(const std::string& path)
+{
+	Stop();
+
+	m_file.open(path, std::ios::binary | std::ios::trunc);
+
+	if (!m_file.is_open())
+	{
+		return false;
+	}
+
+	SessionFileHeader header;
+
+	if (!m_file.write((const char*)&header, sizeof(header)))
+	{
+		m_file.close();
+		return false;
+	}
+
+	m_fileOffset = sizeof(header);
+	m_lastSampleAreasOffset = 0;
+	m_lastOutputOffset = 0;
+	m_index.clear();
+
+	m_startTime = std::chrono::steady_clock::now();
+	m_droppedFrames = 0;
+	m_bWriteFailed = false;
+	m_bDropOutput = false;
+	m_bStopWriter = false;
+	m_bRecording = true;
+
+	m_writerThread = std::thread(&SessionRecorder::WriterThread, this);
+
+	return true;
+}
+
+void SessionRecorder::Stop()
+{
+	if (!m_writerThread.joinable())
+	{
+		return;
+	}
+
+	m_bRecording = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_bStopWriter = true;
+	}
+
+	m_queueCondition.notify_one();
+	m_writerThread.join();
+
+	// Chunks queued after a failed write were never written.
+	m_queue.clear();
+
+	// The index of a failed recording would point past the end of the data, so the file is left to be scanned instead.
+	if (!m_bWriteFailed)
+	{
+		WriteIndex();
+	}
+
+	m_file.close();
+}
+
+// Returns false and stops the recording if the chunk couldn't be written, such as when the disk is full.
+bool SessionRecorder::WriteChunk(const std::vector<uint8_t>& chunk)
+{
+	if (m_file.write((const char*)chunk.data(), chunk.size()))
+	{
+		return true;
+	}
+
+	m_bWriteFailed = true;
+	m_bRecording = false;
+	return false;
+}
+
+// Appends the frame index and the trailer pointing to it, once nothing else is written.
+void SessionRecorder::WriteIndex()
+{
+	SessionIndexInfo info;
+	info.NumFrames = (uint32_t)m_index.size();
+
+	const uint64_t indexOffset = m_fileOffset;
+	std::vector<uint8_t> chunk = BeginChunk(SessionChunk_Index, sizeof(info) + sizeof(SessionIndexEntry) * m_index.size());
+	uint8_t* payload = chunk.data() + sizeof(SessionChunkHeader);
+
+	memcpy(payload, &info, sizeof(info));
+	memcpy(payload + sizeof(info), m_index.data(), sizeof(SessionIndexEntry) * m_index.size());
+
+	m_index.clear();
+	m_index.shrink_to_fit();
+
+	if (!WriteChunk(chunk))
+	{
+		return;
+	}
+
+	SessionTrailerInfo trailer;
+	trailer.IndexOffset = indexOffset;
+
+	chunk = BeginChunk(SessionChunk_Trailer, sizeof(trailer));
+	memcpy(chunk.data() + sizeof(SessionChunkHeader), &trailer, sizeof(trailer));
+
+	if (WriteChunk(chunk) && !m_file.flush())
+	{
+		m_bWriteFailed = true;
+	}
+}
+
+std::vector<uint8_t> SessionRecorder::BeginChunk(ESessionChunkType type, size_t payloadSize)
+{
+	std::vector<uint8_t> chunk;
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+
+		if (!m_freeBuffers.empty())
+		{
+			chunk = std::move(m_freeBuffers.back());
+			m_freeBuffers.pop_back();
+		}
+	}
+
+	const size_t alignedSize = AlignSessionChunkSize(payloadSize);
+	chunk.resize(sizeof(SessionChunkHeader) + alignedSize);
+
+	// Reused buffers hold old data in the padding.
+	memset(chunk.data() + sizeof(SessionChunkHeader) + payloadSize, 0, alignedSize - payloadSize);
+
+	SessionChunkHeader header;
+	header.Type = type;
+	header.Size = (uint32_t)alignedSize;
+	header.TimestampUS = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+
+	memcpy(chunk.data(), &header, sizeof(header));
+
+	return chunk;
+}
+
+bool SessionRecorder::QueueChunk(std::vector<uint8_t>&& chunk, bool bCanDrop)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+
+		if (bCanDrop && m_queue.size() >= SESSION_RECORDER_MAX_QUEUED_CHUNKS)
+		{
+			m_freeBuffers.push_back(std::move(chunk));
+			return false;
+		}
+
+		m_queue.push_back(std::move(chunk));
+	}
+
+	m_queueCondition.notify_one();
+
+	return true;
+}
+
+void SessionRecorder::WriterThread()
+{
+	while (true)
+	{
+		std::vector<uint8_t> chunk;
+
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueCondition.wait(lock, [&] { return m_bStopWriter || !m_queue.empty(); });
+
+			// Everything queued before stopping is still written.
+			if (m_queue.empty())
+			{
+				break;
+			}
+
+			chunk = std::move(m_queue.front());
+			m_queue.pop_front();
+		}
+
+		if (!WriteChunk(chunk))
+		{
+			break;
+		}
+
+		// Dropped frames never get here, so the index only lists frames that are in the file.
+		SessionChunkHeader header;
+		memcpy(&header, chunk.data(), sizeof(header));
+
+		if (header.Type == SessionChunk_SampleAreas)
+		{
+			m_lastSampleAreasOffset = m_fileOffset;
+		}
+		else if (header.Type == SessionChunk_Output)
+		{
+			m_lastOutputOffset = m_fileOffset;
+		}
+		else if (header.Type == SessionChunk_Frame)
+		{
+			SessionIndexEntry entry;
+			entry.FrameOffset = m_fileOffset;
+			entry.TimestampUS = header.TimestampUS;
+			entry.SampleAreasOffset = m_lastSampleAreasOffset;
+			entry.OutputOffset = m_lastOutputOffset;
+			m_index.push_back(entry);
+		}
+
+		m_fileOffset += chunk.size();
+
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+
+			if (m_freeBuffers.size() < SESSION_RECORDER_MAX_QUEUED_CHUNKS)
+			{
+				m_freeBuffers.push_back(std::move(chunk));
+			}
+		}
+	}
+
+	if (!m_bWriteFailed && !m_file.flush())
+	{
+		m_bWriteFailed = true;
+		m_bRecording = false;
+	}
+}
+
+
+void SessionRecorder::RecordSampleAreas(const std::vector<LEDSampleArea>& areas, int numLEDs)
+{
+	if (!m_bRecording)
+	{
+		return;
+	}
+
+	SessionSampleAreasInfo info;
+	info.NumLEDs = (uint32_t)numLEDs;
+
+	std::vector<uint8_t> chunk = BeginChunk(SessionChunk_SampleAreas, sizeof(info) + sizeof(LEDSampleArea) * numLEDs);
+	uint8_t* payload = chunk.data() + sizeof(SessionChunkHeader);
+
+	memcpy(payload, &info, sizeof(info));
+	memcpy(payload + sizeof(info), areas.data(), sizeof(LEDSampleArea) * numLEDs);
+
+	// The frames after it are meaningless without their geometry, so this is never dropped.
+	QueueChunk(std::move(chunk), false);
+}
+
+bool SessionRecorder::RecordFrame(const RGBAImageView& left, const RGBAImageView& right, float intervalMS)
+{
+	if (!m_bRecording || !left.IsValid() || right.Width != left.Width || right.Height != left.Height)
+	{
+		return false;
+	}
+
+	SessionFrameInfo info;
+	info.Width = left.Width;
+	info.Height = left.Height;
+	info.IntervalMS = intervalMS;
+
+	const size_t rowSize = (size_t)left.Width * 4;
+	const size_t imageSize = rowSize * left.Height;
+
+	std::vector<uint8_t> chunk = BeginChunk(SessionChunk_Frame, sizeof(info) + imageSize * 2);
+	uint8_t* payload = chunk.data() + sizeof(SessionChunkHeader);
+
+	memcpy(payload, &info, sizeof(info));
+	payload += sizeof(info);
+
+	for (uint32_t y = 0; y < left.Height; y++)
+	{
+		memcpy(payload + rowSize * y, left.GetRow(y), rowSize);
+		memcpy(payload + imageSize + rowSize * y, right.GetRow(y), rowSize);
+	}
+
+	// Replaying compares each frame against the output recorded after the frame before it, so a dropped frame takes its output along.
+	m_bDropOutput = !QueueChunk(std::move(chunk), true);
+
+	if (m_bDropOutput)
+	{
+		m_droppedFrames++;
+	}
+
+	return !m_bDropOutput;
+}
+
+void SessionRecorder::RecordOutput(const std::vector<LEDOutputData>& output)
+{
+	if (!m_bRecording || m_bDropOutput)
+	{
+		m_bDropOutput = false;
+		return;
+	}
+
+	SessionOutputInfo info;
+	info.NumLEDs = (uint32_t)output.size();
+
+	std::vector<uint8_t> chunk = BeginChunk(SessionChunk_Output, sizeof(info) + sizeof(LEDOutputData) * output.size());
+	uint8_t* payload = chunk.data() + sizeof(SessionChunkHeader);
+
+	memcpy(payload, &info, sizeof(info));
+	memcpy(payload + sizeof(info), output.data(), sizeof(LEDOutputData) * output.size());
+
+	// Also dropped when the queue fills up without any frames being recorded, keeping it bounded.
+	QueueChunk(std::move(chunk), true);
+}
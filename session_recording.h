@@ -0,0 +1,155 @@
+#pragma once
+
+#include "structures.h"
+#include "rgba_frame.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define SESSION_FILE_MAGIC 0x534C4C41 // "ALLS"
+#define SESSION_FILE_VERSION 1
+#define SESSION_TRAILER_MAGIC 0x58444E49 // "INDX"
+
+// Chunk payloads are padded to a multiple of this, keeping the frame pixels aligned when the file is mapped.
+#define SESSION_CHUNK_ALIGNMENT 16
+
+// Chunks waiting to be written before the recorder starts dropping frames.
+#define SESSION_RECORDER_MAX_QUEUED_CHUNKS 32
+
+
+// Recorded sessions are a header followed by a stream of chunks, appended as the session goes.
+// Stopping the recording appends an index of the frames and a trailer pointing to it.
+// A file cut short, such as by a crash, is valid up to its last complete chunk and can be indexed by scanning it.
+struct SessionFileHeader
+{
+	uint32_t Magic = SESSION_FILE_MAGIC;
+	uint32_t Version = SESSION_FILE_VERSION;
+	uint32_t _pad[2] = {};
+};
+
+enum ESessionChunkType : uint32_t
+{
+	SessionChunk_SampleAreas = 1, // SessionSampleAreasInfo, then LEDSampleArea[NumLEDs]
+	SessionChunk_Frame = 2, // SessionFrameInfo, then the left and right eye as tightly packed RGBA
+	SessionChunk_Output = 3, // SessionOutputInfo, then LEDOutputData[NumLEDs]
+	SessionChunk_Index = 4, // SessionIndexInfo, then SessionIndexEntry[NumFrames]
+	SessionChunk_Trailer = 5 // SessionTrailerInfo, always the last chunk
+};
+
+// Starts every chunk, followed by Size bytes of payload. Readers skip chunk types they don't know.
+struct SessionChunkHeader
+{
+	uint32_t Type = 0;
+	uint32_t Size = 0;
+	uint64_t TimestampUS = 0; // Since the start of the recording
+};
+
+struct SessionSampleAreasInfo
+{
+	uint32_t NumLEDs = 0;
+	uint32_t _pad[3] = {};
+};
+
+struct SessionFrameInfo
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	float IntervalMS = 0; // Time since the previous recorded frame
+	uint32_t _pad = 0;
+};
+
+struct SessionOutputInfo
+{
+	uint32_t NumLEDs = 0;
+	uint32_t _pad[3] = {};
+};
+
+// Everything needed to start playback at a frame, without reading the chunks before it.
+struct SessionIndexEntry
+{
+	uint64_t FrameOffset = 0; // File offset of the frame chunk
+	uint64_t TimestampUS = 0;
+	uint64_t SampleAreasOffset = 0; // Latest sample areas chunk before the frame, 0 if none
+	uint64_t OutputOffset = 0; // Latest output chunk before the frame, 0 if none
+};
+
+struct SessionIndexInfo
+{
+	uint32_t NumFrames = 0;
+	uint32_t _pad[3] = {};
+};
+
+struct SessionTrailerInfo
+{
+	uint64_t IndexOffset = 0; // File offset of the index chunk
+	uint32_t Magic = SESSION_TRAILER_MAGIC;
+	uint32_t _pad = 0;
+};
+
+static_assert(sizeof(SessionFileHeader) == SESSION_CHUNK_ALIGNMENT && sizeof(SessionChunkHeader) == 16 && sizeof(SessionFrameInfo) == 16, "Recording layout changed");
+
+static inline size_t AlignSessionChunkSize(size_t size)
+{
+	return (size + SESSION_CHUNK_ALIGNMENT - 1) & ~(size_t)(SESSION_CHUNK_ALIGNMENT - 1);
+}
+
+
+// Box filters an image down by 2^level in each dimension.
+void DownscaleImage(const RGBAImageView& source, uint32_t level, RGBAFrame& outFrame);
+
+
+// Streams a session to disk from a background thread, so the sampler thread only copies the data.
+// When the disk can't keep up, frames are dropped along with their output rather than blocking the caller.
+// If writing fails, the recording stops by itself and HasWriteFailed() reports it.
+class SessionRecorder
+{
+public:
+
+	~SessionRecorder();
+
+	bool Start(const std::string& path);
+	void Stop();
+	bool IsRecording() const { return m_bRecording; }
+
+	void RecordSampleAreas(const std::vector<LEDSampleArea>& areas, int numLEDs);
+	// Returns false if the frame was dropped.
+	bool RecordFrame(const RGBAImageView& left, const RGBAImageView& right, float intervalMS);
+	void RecordOutput(const std::vector<LEDOutputData>& output);
+
+	uint32_t GetDroppedFrames() const { return m_droppedFrames; }
+	bool HasWriteFailed() const { return m_bWriteFailed; }
+
+protected:
+
+	std::vector<uint8_t> BeginChunk(ESessionChunkType type, size_t payloadSize);
+	bool QueueChunk(std::vector<uint8_t>&& chunk, bool bCanDrop);
+	void WriterThread();
+	bool WriteChunk(const std::vector<uint8_t>& chunk);
+	void WriteIndex();
+
+	std::atomic_bool m_bRecording = false;
+	std::atomic_bool m_bWriteFailed = false;
+	std::atomic<uint32_t> m_droppedFrames = 0;
+	bool m_bDropOutput = false; // The last frame was dropped, so the output following it is too
+	std::chrono::steady_clock::time_point m_startTime;
+
+	std::ofstream m_file;
+	std::thread m_writerThread;
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueCondition;
+	std::deque<std::vector<uint8_t>> m_queue;
+	std::vector<std::vector<uint8_t>> m_freeBuffers; // Written chunks, reused to avoid allocating every frame
+	bool m_bStopWriter = false;
+
+	// Only touched by the writer thread while recording.
+	uint64_t m_fileOffset = 0;
+	uint64_t m_lastSampleAreasOffset = 0;
+	uint64_t m_lastOutputOffset = 0;
+	std::vector<SessionIndexEntry> m_index;
+};
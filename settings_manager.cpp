@@ -8,6 +8,7 @@ SettingsManager::SettingsManager(std::wstring settingsFile)
 	, m_iniData()
 {
 	m_iniData.SetUnicode(true);
+	m_colorParams.store(std::make_shared<const ColorParams>());
 }
 
 SettingsManager::~SettingsManager()
@@ -29,6 +30,8 @@ void SettingsManager::ReadSettingsFile()
 		m_settingsAdaLight.ParseSettings(m_iniData, "AdaLight");
 	}
 	m_bSettingsUpdated = false;
+
+	PublishColorParams();
 }
 
 void SettingsManager::UpdateSettingsFile()
@@ -63,6 +66,21 @@ void SettingsManager::ResetToDefaults()
 	m_settingsMain = Settings_Main();
 	m_settingsAdaLight = Settings_AdaLight();
 	UpdateSettingsFile();
+
+	PublishColorParams();
+}
+
+void SettingsManager::PublishColorParams()
+{
+	ColorGradingSettings colorSettings = m_settingsMain.GetColorGradingSettings();
+	std::shared_ptr<const ColorParams> current = m_colorParams.load();
+
+	if (current->Settings == colorSettings)
+	{
+		return;
+	}
+
+	m_colorParams.store(std::make_shared<const ColorParams>(colorSettings, current->Version + 1));
 }
 
 
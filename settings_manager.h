@@ -2,7 +2,11 @@
 #pragma once
 
 #include "framework.h"
+#include <atomic>
 #include "SimpleIni.h"
+#include "color_grading.h"
+#include "temporal_filter.h"
+#include "structures.h"
 
 struct Settings_Main
 {
@@ -26,6 +30,9 @@ struct Settings_Main
 	float Curvature = 0.12f;
 	float CurvatureShape = 0.12f;
 
+	int SamplingMode = SamplingMode_Exact;
+	int MipSampleTaps = 4;
+
 	int PreviewMode = 0; // Transient
 	float PreviewValue = 0.0f; // Transient
 
@@ -45,6 +52,59 @@ struct Settings_Main
 	float GammaGreen = 2.2f;
 	float GammaBlue = 2.2f;
 
+	bool GPUColorGrading = false;
+	bool TemporalDithering = false;
+	int ColorAdjustmentSpace = ColorSpace_CIELAB;
+
+	int FilterType = Filter_None;
+	float FilterTimeConstant = 50.0f;
+	float FilterAttack = 20.0f;
+	float FilterRelease = 150.0f;
+	float FilterMinCutoff = 1.0f;
+	float FilterBeta = 5.0f;
+
+	bool RecordSession = false; // Transient
+	int RecordingDownscale = 3;
+
+	TemporalFilterParams GetTemporalFilterParams() const
+	{
+		TemporalFilterParams params;
+
+		params.Type = FilterType;
+		params.TimeConstantMS = FilterTimeConstant;
+		params.AttackMS = FilterAttack;
+		params.ReleaseMS = FilterRelease;
+		params.MinCutoffHz = FilterMinCutoff;
+		params.Beta = FilterBeta;
+
+		return params;
+	}
+
+	ColorGradingSettings GetColorGradingSettings() const
+	{
+		ColorGradingSettings settings;
+
+		settings.AdjustmentSpace = ColorAdjustmentSpace;
+
+		settings.Brightness = Brightness;
+		settings.Contrast = Contrast;
+		settings.Saturation = Saturation;
+
+		settings.MinRed = MinRed;
+		settings.MinGreen = MinGreen;
+		settings.MinBlue = MinBlue;
+
+		settings.MaxRed = MaxRed;
+		settings.MaxGreen = MaxGreen;
+		settings.MaxBlue = MaxBlue;
+
+		settings.GammaRed = GammaRed;
+		settings.GammaGreen = GammaGreen;
+		settings.GammaBlue = GammaBlue;
+
+		return settings;
+	}
+
 	void ParseSettings(CSimpleIniA& ini, const char* section)
 	{
 		InterfaceConfigured = ini.GetBoolValue(section, "InterfaceConfigured", InterfaceConfigured);
@@ -65,6 +125,9 @@ struct Settings_Main
 		Curvature = (float)ini.GetDoubleValue(section, "Curvature", Curvature);
 		CurvatureShape = (float)ini.GetDoubleValue(section, "CurvatureShape", CurvatureShape);
 
+		SamplingMode = (int)ini.GetLongValue(section, "SamplingMode", SamplingMode);
+		MipSampleTaps = (int)ini.GetLongValue(section, "MipSampleTaps", MipSampleTaps);
+
 		Brightness = (float)ini.GetDoubleValue(section, "Brightness", Brightness);
 		Contrast = (float)ini.GetDoubleValue(section, "Contrast", Contrast);
 		Saturation = (float)ini.GetDoubleValue(section, "Saturation", Saturation);
@@ -80,6 +143,19 @@ struct Settings_Main
 		GammaRed = (float)ini.GetDoubleValue(section, "GammaRed", GammaRed);
 		GammaGreen = (float)ini.GetDoubleValue(section, "GammaGreen", GammaGreen);
 		GammaBlue = (float)ini.GetDoubleValue(section, "GammaBlue", GammaBlue);
+
+		GPUColorGrading = ini.GetBoolValue(section, "GPUColorGrading", GPUColorGrading);
+		TemporalDithering = ini.GetBoolValue(section, "TemporalDithering", TemporalDithering);
+		ColorAdjustmentSpace = (int)ini.GetLongValue(section, "ColorAdjustmentSpace", ColorAdjustmentSpace);
+
+		FilterType = (int)ini.GetLongValue(section, "FilterType", FilterType);
+		FilterTimeConstant = (float)ini.GetDoubleValue(section, "FilterTimeConstant", FilterTimeConstant);
+		FilterAttack = (float)ini.GetDoubleValue(section, "FilterAttack", FilterAttack);
+		FilterRelease = (float)ini.GetDoubleValue(section, "FilterRelease", FilterRelease);
+		FilterMinCutoff = (float)ini.GetDoubleValue(section, "FilterMinCutoff", FilterMinCutoff);
+		FilterBeta = (float)ini.GetDoubleValue(section, "FilterBeta", FilterBeta);
+
+		RecordingDownscale = (int)ini.GetLongValue(section, "RecordingDownscale", RecordingDownscale);
 	}
 
 	void UpdateSettings(CSimpleIniA& ini, const char* section)
@@ -102,6 +178,9 @@ struct Settings_Main
 		ini.SetDoubleValue(section, "Curvature", Curvature);
 		ini.SetDoubleValue(section, "CurvatureShape", CurvatureShape);
 
+		ini.SetLongValue(section, "SamplingMode", SamplingMode);
+		ini.SetLongValue(section, "MipSampleTaps", MipSampleTaps);
+
 		ini.SetDoubleValue(section, "Brightness", Brightness);
 		ini.SetDoubleValue(section, "Contrast", Contrast);
 		ini.SetDoubleValue(section, "Saturation", Saturation);
@@ -117,6 +196,19 @@ struct Settings_Main
 		ini.SetDoubleValue(section, "GammaRed", GammaRed);
 		ini.SetDoubleValue(section, "GammaGreen", GammaGreen);
 		ini.SetDoubleValue(section, "GammaBlue", GammaBlue);
+
+		ini.SetBoolValue(section, "GPUColorGrading", GPUColorGrading);
+		ini.SetBoolValue(section, "TemporalDithering", TemporalDithering);
+		ini.SetLongValue(section, "ColorAdjustmentSpace", ColorAdjustmentSpace);
+
+		ini.SetLongValue(section, "FilterType", FilterType);
+		ini.SetDoubleValue(section, "FilterTimeConstant", FilterTimeConstant);
+		ini.SetDoubleValue(section, "FilterAttack", FilterAttack);
+		ini.SetDoubleValue(section, "FilterRelease", FilterRelease);
+		ini.SetDoubleValue(section, "FilterMinCutoff", FilterMinCutoff);
+		ini.SetDoubleValue(section, "FilterBeta", FilterBeta);
+
+		ini.SetLongValue(section, "RecordingDownscale", RecordingDownscale);
 	}
 };
 
@@ -151,6 +243,10 @@ public:
 	void DispatchUpdate();
 	void ResetToDefaults();
 
+	// Publishes a new color parameter snapshot if the color settings have changed. Call from the UI thread.
+	void PublishColorParams();
+
+	std::shared_ptr<const ColorParams> GetColorParams() const { return m_colorParams.load(); }
 
 	Settings_Main& GetSettings_Main() { return m_settingsMain; }
 	Settings_AdaLight& GetSettings_AdaLight() { return m_settingsAdaLight; }
@@ -165,5 +261,7 @@ protected:
 
 	Settings_Main m_settingsMain;
 	Settings_AdaLight m_settingsAdaLight;
+
+	std::atomic<std::shared_ptr<const ColorParams>> m_colorParams;
 };
 
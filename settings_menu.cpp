@@ -9,6 +9,7 @@
 #include <cmath>
 #include "mathutil.h"
 #include "settings_menu.h"
+#include "profiling.h"
 
 #include "fonts/roboto_medium.cpp"
 #include "fonts/cousine_regular.cpp"
@@ -208,6 +209,8 @@ void SettingsMenu::TickMenu()
 	}
 	m_bMenuIsVisible = true;
 
+	LARGE_INTEGER tickStartTime = StartPerfTimer();
+
 	if (m_resizeWidth != 0 && m_resizeHeight != 0)
 	{
 		if (m_d3d11RTV.Get()) 
@@ -316,7 +319,16 @@ if (bIsActiveTab) { ImGui::PopStyleColor(1); bIsActiveTab = false; }
 
 		ImGui::Text("Frame rate\n %.1fHz", 1000.0f / m_asyncData.FrameIntervalMS);
 		ImGui::Text("Render time\n %.1fms", m_asyncData.RenderTimeMS);
+		ImGui::Text("GPU latency\n %.1fms", m_asyncData.ReadbackLatencyMS);
 		ImGui::Text("LED time\n %.1fms", m_asyncData.PresentTimeMS);
+		ImGui::Text("Color time\n %.0fns/LED", m_asyncData.ColorTimePerLEDNS);
+
+		if (mainSettings.FilterType != Filter_None)
+		{
+			ImGui::Text("Filter latency\n %.1fms", m_asyncData.FilterLatencyMS);
+		}
+
+		ImGui::Text("Menu time\n %.2fms", m_tickTimeMS);
 	}
 	ImGui::Unindent();
 	ImGui::PopFont();
@@ -362,12 +374,88 @@ if (bIsActiveTab) { ImGui::PopStyleColor(1); bIsActiveTab = false; }
 		}
 
 		IMGUI_BIG_SPACING;
-		
+
+		ImGui::BeginGroup();
+		ImGui::Text("Temporal Smoothing");
+		if (ImGui::RadioButton("Off", mainSettings.FilterType == Filter_None)) { mainSettings.FilterType = Filter_None; }
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Average", mainSettings.FilterType == Filter_EMA)) { mainSettings.FilterType = Filter_EMA; }
+		ImGui::SameLine();
+		if (ImGui::RadioButton("One Euro", mainSettings.FilterType == Filter_OneEuro)) { mainSettings.FilterType = Filter_OneEuro; }
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Attack/Release", mainSettings.FilterType == Filter_AttackRelease)) { mainSettings.FilterType = Filter_AttackRelease; }
+
+		if (mainSettings.FilterType == Filter_EMA)
+		{
+			ImGui::SliderFloat("Time Constant", &mainSettings.FilterTimeConstant, 0.0f, 500.0f, "%.0fms");
+		}
+		else if (mainSettings.FilterType == Filter_OneEuro)
+		{
+			ImGui::SliderFloat("Min Cutoff", &mainSettings.FilterMinCutoff, 0.1f, 10.0f, "%.1fHz");
+			ImGui::SliderFloat("Speed Coefficient", &mainSettings.FilterBeta, 0.0f, 50.0f, "%.1f");
+		}
+		else if (mainSettings.FilterType == Filter_AttackRelease)
+		{
+			ImGui::SliderFloat("Attack", &mainSettings.FilterAttack, 0.0f, 500.0f, "%.0fms");
+			ImGui::SliderFloat("Release", &mainSettings.FilterRelease, 0.0f, 1000.0f, "%.0fms");
+		}
+		ImGui::EndGroup();
+		TextDescription("Smooths the LED colors between frames to reduce flicker, at the cost of added latency.\nNot applied when color grading on the GPU.");
+
+		IMGUI_BIG_SPACING;
+
+		ImGui::BeginGroup();
+		ImGui::Text("Sampling Mode");
+		if (ImGui::RadioButton("Exact Average", mainSettings.SamplingMode == SamplingMode_Exact)) { mainSettings.SamplingMode = SamplingMode_Exact; }
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Mip Pyramid", mainSettings.SamplingMode == SamplingMode_MipPyramid)) { mainSettings.SamplingMode = SamplingMode_MipPyramid; }
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Summed Area Table", mainSettings.SamplingMode == SamplingMode_SummedArea)) { mainSettings.SamplingMode = SamplingMode_SummedArea; }
+
+		if (mainSettings.SamplingMode == SamplingMode_MipPyramid)
+		{
+			ImGui::SliderInt("Sample Taps", &mainSettings.MipSampleTaps, 1, 8, "%d x %d");
+		}
+		ImGui::EndGroup();
+		TextDescription("Mip Pyramid samples a downscaled copy of the frame with a few taps per LED instead of reading every pixel.\nMore taps are closer to the exact average, fewer taps are faster.\nSummed Area Table builds a per-pixel running sum of the frame and gives the exact average with a fixed cost per LED.");
+
+		if (m_asyncData.OpenVRSampling)
+		{
+			ImGui::Spacing();
+			ImGui::Text("GPU Time");
+			ImGui::PushFont(m_fixedFont);
+			ImGui::Text("Prepare  %.3fms\nSample   %.3fms\nCombine  %.3fms\nReadback %.3fms",
+				m_asyncData.GPUPrepareTimeMS, m_asyncData.GPUSampleTimeMS, m_asyncData.GPUCombineTimeMS, m_asyncData.GPUReadbackTimeMS);
+			ImGui::PopFont();
+			TextDescription("Measured with GPU timestamps, excluding the time spent waiting for results.");
+		}
+
+		IMGUI_BIG_SPACING;
+
+		ImGui::BeginGroup();
+		ImGui::Checkbox("Record Session", &mainSettings.RecordSession);
+		ImGui::SameLine();
+		ImGui::PushItemWidth(150);
+		ImGui::SliderInt("Downscale", &mainSettings.RecordingDownscale, 0, 6, "Level %d");
+		ImGui::PopItemWidth();
+		if (m_asyncData.RecordingActive)
+		{
+			ImGui::Text("Recording, %u frames dropped", m_asyncData.RecordingDroppedFrames);
+		}
+		else if (m_asyncData.RecordingWriteFailed)
+		{
+			ImGui::Text("Recording stopped, failed to write the file");
+		}
+		ImGui::EndGroup();
+		TextDescription("Records the frames, sample areas and LED colors to the recordings folder in Local AppData, for replaying with --replay.\nFrames are downscaled by 2 to the power of the downscale level in each dimension.");
+
+		IMGUI_BIG_SPACING;
+
 		ImGui::BeginChild("Sep3", ImVec2(0, -ImGui::GetFrameHeightWithSpacing() - 180));
 		ImGui::EndChild();
 
 		ImGui::Checkbox("Skip Releasing Mirror Textures", &mainSettings.SkipMirrorTextureRelease);
-		TextDescription("Skips calling ReleaseMirrorTextureD3D11 every frame.\nThis a workaround for a SteamVR(?) bug that may cause hitching.\nDisable this if you notice memory leaks.");
+		TextDescription("Keeps the mirror textures between frames instead of calling ReleaseMirrorTextureD3D11 every frame.\nThis a workaround for a SteamVR(?) bug that may cause hitching, and avoids re-acquiring the textures each frame.\nDisable this if you notice memory leaks.");
 
 		IMGUI_BIG_SPACING;
 
@@ -640,45 +728,33 @@ if (bIsActiveTab) { ImGui::PopStyleColor(1); bIsActiveTab = false; }
 			ImPlot::SetupAxisLimits(ImAxis_Y1, 0, 1, ImPlotCond_Always);
 
 				
-			double xvals[256];
-			double yvals[3][256];
+			// Use the same parameters as the LED output, they only change when a color setting is edited.
+			std::shared_ptr<const ColorParams> params = m_settingsManager->GetColorParams();
 
-			for (int i = 0; i < 256; i++)
+			if (!m_bColorCurvesValid || params->Version != m_colorCurvesVersion)
 			{
-				xvals[i] = i / 256.0;
-
-				double L, a, b, red, green, blue;
-
-				LinearRGBtoLAB_D65(xvals[i], xvals[i], xvals[i], L, a, b);
-				
-				L = min(max((L - 50.0) * mainSettings.Contrast + 50.0, 0.0), 100.0);
-				//L = min(max(L + (mainSettings.Brightness - 1.0) * 100.0, 0.0), 100.0);
-				a *= mainSettings.Saturation;
-				b *= mainSettings.Saturation;
-
-				LABtoLinearRGB_D65(L, a, b, red, green, blue);
-
-				red = min(max((std::pow((red - mainSettings.MinRed) * mainSettings.Brightness / (1.0 - mainSettings.MinRed), 1.0 / mainSettings.GammaRed) * mainSettings.MaxRed), 0.0), 1.0);
-				yvals[0][i] = red;
+				for (int i = 0; i < COLOR_CURVE_SAMPLES; i++)
+				{
+					double input = (double)i / COLOR_CURVE_SAMPLES;
+					m_colorCurveInput[i] = input;
 
-				green = min(max((std::pow((green - mainSettings.MinGreen) * mainSettings.Brightness / (1.0 - mainSettings.MinGreen), 1.0 / mainSettings.GammaGreen) * mainSettings.MaxGreen), 0.0), 1.0);
-				yvals[1][i] = green;
+					GradeColor(*params, input, input, input, m_colorCurves[0][i], m_colorCurves[1][i], m_colorCurves[2][i]);
+				}
 
-				blue = min(max((std::pow((blue - mainSettings.MinBlue) * mainSettings.Brightness / (1.0 - mainSettings.MinBlue), 1.0 / mainSettings.GammaBlue) * mainSettings.MaxBlue), 0.0), 1.0);
-				yvals[2][i] = blue;
-				
+				m_colorCurvesVersion = params->Version;
+				m_bColorCurvesValid = true;
 			}
 
 			ImPlot::PushStyleColor(ImPlotCol_Line, ImVec4(0.8f, 0, 0, 1));
-			ImPlot::PlotLine("Red", xvals, yvals[0], 256);
+			ImPlot::PlotLine("Red", m_colorCurveInput, m_colorCurves[0], COLOR_CURVE_SAMPLES);
 			ImPlot::PopStyleColor();
 			ImPlot::PushStyleColor(ImPlotCol_Line, ImVec4(0, 0.8f, 0, 1));
-			ImPlot::PlotLine("Green", xvals, yvals[1], 256);
+			ImPlot::PlotLine("Green", m_colorCurveInput, m_colorCurves[1], COLOR_CURVE_SAMPLES);
 
 			ImPlot::PopStyleColor();
 
 			ImPlot::PushStyleColor(ImPlotCol_Line, ImVec4(0, 0, 0.8f, 1));
-			ImPlot::PlotLine("Blue", xvals, yvals[2], 256);
+			ImPlot::PlotLine("Blue", m_colorCurveInput, m_colorCurves[2], COLOR_CURVE_SAMPLES);
 			ImPlot::PopStyleColor();
 
 			ImPlot::EndPlot();
@@ -731,6 +807,24 @@ if (bIsActiveTab) { ImGui::PopStyleColor(1); bIsActiveTab = false; }
 		ImGui::SliderFloat("Max Green", &mainSettings.MaxGreen, 0.0f, 1.0f, "%.2f");
 		ImGui::SliderFloat("Max Blue", &mainSettings.MaxBlue, 0.0f, 1.0f, "%.2f");
 
+		IMGUI_BIG_SPACING;
+
+		ImGui::BeginGroup();
+		ImGui::Text("Adjustment Color Space");
+		if (ImGui::RadioButton("CIELAB", mainSettings.ColorAdjustmentSpace == ColorSpace_CIELAB)) { mainSettings.ColorAdjustmentSpace = ColorSpace_CIELAB; }
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Oklab", mainSettings.ColorAdjustmentSpace == ColorSpace_Oklab)) { mainSettings.ColorAdjustmentSpace = ColorSpace_Oklab; }
+		ImGui::EndGroup();
+		TextDescription("Color space used for the contrast and saturation adjustments.\nOklab is cheaper to compute and keeps hues more uniform.");
+
+		IMGUI_BIG_SPACING;
+
+		ImGui::Checkbox("Color Grading on GPU", &mainSettings.GPUColorGrading);
+		TextDescription("Applies the color adjustments in the compute shader,\nand only reads back the final LED colors.");
+
+		ImGui::Checkbox("Temporal Dithering", &mainSettings.TemporalDithering);
+		TextDescription("Carries the fractional color over between frames,\nreducing banding in dark scenes. Works best at high frame rates.\nNot applied when color grading on the GPU.");
+
 		ImGui::EndChild();
 
 		ImGui::EndChild();
@@ -764,6 +858,8 @@ if (bIsActiveTab) { ImGui::PopStyleColor(1); bIsActiveTab = false; }
 
 	bool bGeometryUpdated = false;
 
+	m_settingsManager->PublishColorParams();
+
 	if (ImGui::IsAnyItemActive())
 	{
 		m_settingsManager->SettingsUpdated();
@@ -806,6 +902,9 @@ if (bIsActiveTab) { ImGui::PopStyleColor(1); bIsActiveTab = false; }
 	m_d3d11DeviceContext->ClearRenderTargetView(m_d3d11RTV.Get(), clearColor);
 	ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
 
+	// Excludes the blocking present.
+	m_tickTimeMS = UpdateAveragePerfTime(m_tickTimes, EndPerfTimer(tickStartTime), 20);
+
 	HRESULT hr = m_d3d11SwapChain->Present(1, 0);
 
 	m_bMenuIsVisible = (hr != DXGI_STATUS_OCCLUDED);
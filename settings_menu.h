@@ -6,6 +6,7 @@
 #include "async_data.h"
 #include "imgui.h"
 
+#define COLOR_CURVE_SAMPLES 256
 
 enum EMenuTab
 {
@@ -57,6 +58,15 @@ private:
 
 	bool m_bGeometryTouched = false;
 
+	// Color tab plot data, only recalculated when the published color parameters change.
+	bool m_bColorCurvesValid = false;
+	uint64_t m_colorCurvesVersion = 0;
+	double m_colorCurveInput[COLOR_CURVE_SAMPLES];
+	double m_colorCurves[3][COLOR_CURVE_SAMPLES];
+
+	std::deque<float> m_tickTimes;
+	float m_tickTimeMS = 0;
+
 	ID3D11ShaderResourceView* m_mirrorSRVLeft = nullptr;
 	ID3D11ShaderResourceView* m_mirrorSRVRight = nullptr;
 };
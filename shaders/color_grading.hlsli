@@ -0,0 +1,127 @@
+
+// HLSL port of GradeColor() in color_grading.h. Keep the two in sync.
+
+cbuffer colorConstantBuffer : register(b1)
+{
+	float g_contrast;
+	float g_saturation;
+	uint g_useOklab;
+	uint g_gradeColors; // Set while the colors are graded on the GPU.
+	float3 g_minColor;
+	float _pad1;
+	float3 g_scale;
+	float _pad2;
+	float3 g_maxColor;
+	float _pad3;
+	float3 g_invGamma;
+	float _pad4;
+}
+
+static const float3 D65Ref = float3(0.950489, 1.0, 1.08884);
+
+static const float3x3 LinearRGBToXYZ = 
+{
+	0.4124564, 0.3575761, 0.1804375,
+	0.2126729, 0.7151522, 0.0721750,
+	0.0193339, 0.1191920, 0.9503041
+};
+
+static const float3x3 XYZToLinearRGB = 
+{
+	3.2404542, -1.5371385, -0.4985314,
+	-0.9692660, 1.8760108, 0.0415560,
+	0.0556434, -0.2040259, 1.0572252
+};
+
+float3 LinearRGBtoLAB_D65(float3 color)
+{
+	float3 xyz = mul(LinearRGBToXYZ, color) / D65Ref;
+	
+	xyz = (xyz > 0.008856) ? pow(max(xyz, 0.008856), 1.0 / 3.0) : (7.787 * xyz) + (16.0 / 116.0);
+	
+	return float3(116.0 * xyz.y - 16.0, 500.0 * (xyz.x - xyz.y), 200.0 * (xyz.y - xyz.z));
+}
+
+float3 LABtoLinearRGB_D65(float3 lab)
+{
+	float y = (lab.x + 16.0) / 116.0;
+	float3 xyz = float3(lab.y / 500.0 + y, y, y - lab.z / 200.0);
+	
+	xyz = (xyz > 0.206897) ? xyz * xyz * xyz : (xyz - 16.0 / 116.0) / 7.787;
+	
+	return mul(XYZToLinearRGB, xyz * D65Ref);
+}
+
+static const float3x3 LinearRGBToLMS = 
+{
+	0.4122214708, 0.5363325363, 0.0514459929,
+	0.2119034982, 0.6806995451, 0.1073969566,
+	0.0883024619, 0.2817188376, 0.6299787005
+};
+
+static const float3x3 LMSToOklab = 
+{
+	0.2104542553, 0.7936177850, -0.0040720468,
+	1.9779984951, -2.4285922050, 0.4505937099,
+	0.0259040371, 0.7827717662, -0.8086757660
+};
+
+static const float3x3 OklabToLMS = 
+{
+	1.0, 0.3963377774, 0.2158037573,
+	1.0, -0.1055613458, -0.0638541728,
+	1.0, -0.0894841775, -1.2914855480
+};
+
+static const float3x3 LMSToLinearRGB = 
+{
+	4.0767416621, -3.3077115913, 0.2309699292,
+	-1.2684380046, 2.6097574011, -0.3413193965,
+	-0.0041960863, -0.7034186147, 1.7076147010
+};
+
+float3 LinearRGBtoOklab(float3 color)
+{
+	float3 lms = pow(max(mul(LinearRGBToLMS, color), 0.0), 1.0 / 3.0);
+	
+	return mul(LMSToOklab, lms);
+}
+
+float3 OklabtoLinearRGB(float3 lab)
+{
+	float3 lms = mul(OklabToLMS, lab);
+	
+	return mul(LMSToLinearRGB, lms * lms * lms);
+}
+
+// Returns the graded color in the 0-255 range, truncated the same way as on the CPU.
+uint3 GradeColor(float3 color)
+{
+	float3 rgb;
+	
+	// Uniform branch, the whole dispatch takes the same path.
+	[branch]
+	if (g_useOklab != 0)
+	{
+		float3 lab = LinearRGBtoOklab(color);
+		
+		lab.x = saturate((lab.x - 0.5) * g_contrast + 0.5);
+		lab.yz *= g_saturation;
+		
+		rgb = OklabtoLinearRGB(lab);
+	}
+	else
+	{
+		float3 lab = LinearRGBtoLAB_D65(color);
+		
+		lab.x = clamp((lab.x - 50.0) * g_contrast + 50.0, 0.0, 100.0);
+		lab.yz *= g_saturation;
+		
+		rgb = LABtoLinearRGB_D65(lab);
+	}
+	
+	float3 base = (rgb - g_minColor) * g_scale;
+	float3 graded = (base > 0.0) ? pow(max(base, 1e-30), g_invGamma) * g_maxColor : 0.0;
+	
+	return uint3(saturate(graded) * 255.0);
+}
@@ -1,72 +1,49 @@
-
-struct LEDSampleArea
-{
-	float xMin;
-	float yMin;
-	float xMax;
-	float yMax;
-};
-
-struct LEDOutput
-{
-	double3 color;
-	double _pad;
-};
+#include "led_output.hlsli"
+#include "gather_plan.hlsli"
 
 cbuffer csConstantBuffer : register(b0)
 {
 	uint2 g_frameSize;
     uint g_numLEDs;
-	uint g_LEDStartIndex;
+	uint _pad0;
 }
 
-StructuredBuffer<LEDSampleArea> sampleArea : register(t1);
+StructuredBuffer<LEDTileInfo> ledTiles : register(t4);
 
 RWBuffer<uint> intermediary : register(u0);
-RWStructuredBuffer<LEDOutput> output : register(u1);
 
-groupshared uint3 g_accumulator;
+#define COMBINE_GROUP_SIZE (32 * 32)
 
-#define TILE_X 32
-#define TILE_Y 32
+#define REDUCTION_GROUP_SIZE COMBINE_GROUP_SIZE
+#include "group_reduction.hlsli"
 
 [numthreads(32, 32, 1)]
-void main(uint3 threadID : SV_DispatchThreadID, uint3 localID : SV_GroupThreadID, uint3 groupID : SV_GroupID)
+void main(uint3 threadID : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
 {	
-	uint ledID = threadID.z + g_LEDStartIndex;
-	
-	uint xMin = floor(saturate(sampleArea[ledID].xMin) * g_frameSize.x);
-	uint yMin = floor(saturate(sampleArea[ledID].yMin) * g_frameSize.y);
-	uint xMax = ceil(saturate(sampleArea[ledID].xMax) * g_frameSize.x);
-	uint yMax = ceil(saturate(sampleArea[ledID].yMax) * g_frameSize.y);
+	uint ledID = threadID.z;
 	
-	uint numTilesX = ceil((xMax - xMin) / TILE_X);
-	uint numTilesY = ceil((yMax - yMin) / TILE_Y);
+	LEDTileInfo info = ledTiles[ledID];
 	
-	uint ledOffset = ledID * numTilesX * numTilesY;
+	uint numTiles = info.numTilesX * info.numTilesY;
 	
-	if(localID.x + localID.y == 0)
-    {
-		g_accumulator = uint3(0, 0, 0);
-    }
-	
-	GroupMemoryBarrierWithGroupSync();
+	uint3 tileSum = uint3(0, 0, 0);
 	
-	if(localID.x < numTilesX && localID.y < numTilesY)
+	// Large LEDs can have more tiles than the group has threads, each thread then sums several.
+	for (uint tile = groupIndex; tile < numTiles; tile += COMBINE_GROUP_SIZE)
     {
-		uint accIndex = (localID.x + localID.y * numTilesX + ledOffset) * 3;
+		uint accIndex = (info.firstTile + tile) * 3;
 		
-        InterlockedAdd(g_accumulator.r, intermediary[accIndex + 0]);
-		InterlockedAdd(g_accumulator.g, intermediary[accIndex + 1]);
-		InterlockedAdd(g_accumulator.b, intermediary[accIndex + 2]);
+		tileSum += uint3(intermediary[accIndex + 0], intermediary[accIndex + 1], intermediary[accIndex + 2]);
     }
 	
-	GroupMemoryBarrierWithGroupSync();
+	uint3 ledSum = GroupReduceSum(tileSum, groupIndex);
 	
-	if(localID.x + localID.y == 0)
+	if(groupIndex == 0)
     {
-        double numPixels = (xMax - xMin) * (yMax - yMin);
+        double numPixels = (info.xMax - info.xMin) * (info.yMax - info.yMin);
 	
-        output[ledID].color = g_accumulator / (255.0 * max(numPixels, 1.0));
+        double3 color = ledSum / (255.0 * max(numPixels, 1.0));
+	
+        WriteLEDOutput(ledID, color);
     }
-}
\ No newline at end of file
+}
@@ -1,79 +1,94 @@
 
-
-struct LEDSampleArea
-{
-	float xMin;
-	float yMin;
-	float xMax;
-	float yMax;
-};
-
+#include "gather_plan.hlsli"
 
 cbuffer csConstantBuffer : register(b0)
 {
 	uint2 g_frameSize;
     uint g_numLEDs;
-	uint g_LEDStartIndex;
+	uint _pad0;
+	uint g_numWorkItems;
+	uint g_workGroupsX;
+	uint2 _pad1;
 }
 
-StructuredBuffer<LEDSampleArea> sampleArea : register(t1);
+StructuredBuffer<LEDTileInfo> ledTiles : register(t4);
+StructuredBuffer<GatherWorkItem> workItems : register(t5);
 RWBuffer<uint> intermediary : register(u0);
 
-Texture2D<float4> g_frame : register(t0);
+// Both eyes are bound at once, each LED selects its eye in the tile info.
+Texture2D<float4> g_frameLeft : register(t0);
+Texture2D<float4> g_frameRight : register(t2);
 SamplerState g_bilinearSampler : register(s0);
 
 #define TILE_PIXELS_X 32
 #define TILE_PIXELS_Y 32
 
-groupshared uint3 g_accumulator;
+#define REDUCTION_GROUP_SIZE (TILE_PIXELS_X / 2 * TILE_PIXELS_Y / 2)
+#include "group_reduction.hlsli"
 
 [numthreads(TILE_PIXELS_X / 2, TILE_PIXELS_Y / 2, 1)]
-void main(uint3 threadID : SV_DispatchThreadID, uint3 localID : SV_GroupThreadID, uint3 groupID : SV_GroupID)
+void main(uint3 localID : SV_GroupThreadID, uint3 groupID : SV_GroupID, uint groupIndex : SV_GroupIndex)
 {
-	uint ledID = threadID.z + g_LEDStartIndex;
+	// The dispatch wraps the work list into rows of g_workGroupsX groups, the last row may be partially filled.
+	uint itemIndex = groupID.x + groupID.y * g_workGroupsX;
 	
-	uint xMin = floor(saturate(sampleArea[ledID].xMin) * g_frameSize.x);
-	uint yMin = floor(saturate(sampleArea[ledID].yMin) * g_frameSize.y);
-	uint xMax = ceil(saturate(sampleArea[ledID].xMax) * g_frameSize.x);
-	uint yMax = ceil(saturate(sampleArea[ledID].yMax) * g_frameSize.y);
+	if (itemIndex >= g_numWorkItems)
+	{
+		return;
+	}
 	
-	uint numTilesX = ceil((xMax - xMin) / TILE_PIXELS_X);
-	uint numTilesY = ceil((yMax - yMin) / TILE_PIXELS_Y);
+	GatherWorkItem item = workItems[itemIndex];
+	LEDTileInfo info = ledTiles[item.ledID];
 	
-	uint ledOffset = ledID * numTilesX * numTilesY;
+	uint2 tile = uint2(item.tile & 0xFFFF, item.tile >> 16);
 	
-	uint tileID = groupID.x + groupID.y * numTilesX + ledOffset;
-	
-	if(localID.x + localID.y == 0)
-    {
-		g_accumulator = uint3(0, 0, 0);
-    }
-	
-	GroupMemoryBarrierWithGroupSync();
+	uint3 quadSum = uint3(0, 0, 0);
 
-	uint2 samplePos = uint2(xMin + groupID.x * TILE_PIXELS_X + localID.x * 2, yMin + groupID.y * TILE_PIXELS_Y + localID.y * 2); 
+	uint2 samplePos = uint2(info.xMin + tile.x * TILE_PIXELS_X + localID.x * 2, info.yMin + tile.y * TILE_PIXELS_Y + localID.y * 2); 
 	
-	if(samplePos.x < xMax && samplePos.y < yMax)
+	if(samplePos.x < info.xMax && samplePos.y < info.yMax)
     {
-		float2 sampleFrac = (float2(samplePos) + float2(0.5, 0.5)) / g_frameSize;
+		// Sampling on the shared corner of the quad, so the gather footprint doesn't depend on rounding.
+		float2 sampleFrac = (float2(samplePos) + float2(1.0, 1.0)) / g_frameSize;
+		
+		uint4 red, green, blue;
+		
+		// Uniform within the group, each group covers a single LED.
+		[branch]
+		if (info.eye == 0)
+		{
+			red = g_frameLeft.GatherRed(g_bilinearSampler, sampleFrac) * 255;
+			green = g_frameLeft.GatherGreen(g_bilinearSampler, sampleFrac) * 255;
+			blue = g_frameLeft.GatherBlue(g_bilinearSampler, sampleFrac) * 255;
+		}
+		else
+		{
+			red = g_frameRight.GatherRed(g_bilinearSampler, sampleFrac) * 255;
+			green = g_frameRight.GatherGreen(g_bilinearSampler, sampleFrac) * 255;
+			blue = g_frameRight.GatherBlue(g_bilinearSampler, sampleFrac) * 255;
+		}
 		
-		uint4 red = g_frame.GatherRed(g_bilinearSampler, sampleFrac) * 255;
-		uint4 green = g_frame.GatherGreen(g_bilinearSampler, sampleFrac) * 255;
-		uint4 blue = g_frame.GatherBlue(g_bilinearSampler, sampleFrac) * 255;
+		// Gather returns (bottom left, bottom right, top right, top left), the texels past the edges of the area are dropped.
+		bool bHasRight = samplePos.x + 1 < info.xMax;
+		bool bHasBottom = samplePos.y + 1 < info.yMax;
+		uint4 mask = uint4(bHasBottom, bHasBottom && bHasRight, bHasRight, 1);
 		
-        InterlockedAdd(g_accumulator.r, red.x + red.y + red.z + red.w);
-        InterlockedAdd(g_accumulator.g, green.x + green.y + green.z + green.w);
-        InterlockedAdd(g_accumulator.b, blue.x + blue.y + blue.z + blue.w);
+		red *= mask;
+		green *= mask;
+		blue *= mask;
+		
+		quadSum = uint3(red.x + red.y + red.z + red.w, green.x + green.y + green.z + green.w, blue.x + blue.y + blue.z + blue.w);
     }
 	
-	GroupMemoryBarrierWithGroupSync();
+	uint3 tileSum = GroupReduceSum(quadSum, groupIndex);
 	
-	if(localID.x + localID.y == 0)
+	if(groupIndex == 0)
     {
-		uint outIndex = (groupID.x + groupID.y * numTilesX + ledOffset) * 3;
+		// The work list holds the tiles of each LED contiguously, so the item index is also the tile index.
+		uint outIndex = itemIndex * 3;
 		
-		intermediary[outIndex + 0] = g_accumulator.r;
-		intermediary[outIndex + 1] = g_accumulator.g;
-		intermediary[outIndex + 2] = g_accumulator.b;
+		intermediary[outIndex + 0] = tileSum.r;
+		intermediary[outIndex + 1] = tileSum.g;
+		intermediary[outIndex + 2] = tileSum.b;
     }
-}
\ No newline at end of file
+}
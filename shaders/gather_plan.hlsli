@@ -0,0 +1,21 @@
+// Gather work list built on the CPU, see gather_plan.h.
+
+// Pixel bounds of an LED and the range of its tiles in the work list.
+struct LEDTileInfo
+{
+	uint xMin;
+	uint yMin;
+	uint xMax;
+	uint yMax;
+	uint firstTile;
+	uint numTilesX;
+	uint numTilesY;
+	uint eye;
+};
+
+// A single tile of a single LED, tile X in the low 16 bits and tile Y in the high 16 bits.
+struct GatherWorkItem
+{
+	uint ledID;
+	uint tile;
+};
@@ -0,0 +1,71 @@
+// Sums a uint3 over all threads of a thread group, instead of every thread doing atomics on one groupshared value.
+// Define REDUCTION_GROUP_SIZE as the (power of two) number of threads per group before including.
+//
+// GroupReduceSum must be called by every thread of the group from uniform control flow, the result is only valid
+// on thread 0. The sums are integer, so the wave and tree paths give results identical to the atomic accumulation.
+
+#if defined(__SHADER_TARGET_MAJOR) && __SHADER_TARGET_MAJOR >= 6
+#define USE_WAVE_REDUCTION 1
+#else
+#define USE_WAVE_REDUCTION 0
+#endif
+
+
+#if USE_WAVE_REDUCTION
+
+// Shader model 6 path. Waves have at least 4 lanes, and are assumed to be made of consecutive group indices.
+groupshared uint3 g_waveSums[REDUCTION_GROUP_SIZE / 4];
+
+uint3 GroupReduceSum(uint3 value, uint groupIndex)
+{
+	uint3 waveSum = WaveActiveSum(value);
+	uint laneCount = WaveGetLaneCount();
+	
+	if (WaveIsFirstLane())
+	{
+		g_waveSums[groupIndex / laneCount] = waveSum;
+	}
+	
+	GroupMemoryBarrierWithGroupSync();
+	
+	uint3 total = uint3(0, 0, 0);
+	
+	if (groupIndex == 0)
+	{
+		uint numWaves = (REDUCTION_GROUP_SIZE + laneCount - 1) / laneCount;
+		
+		for (uint i = 0; i < numWaves; i++)
+		{
+			total += g_waveSums[i];
+		}
+	}
+	
+	return total;
+}
+
+#else
+
+// Shader model 5 fallback, pairwise tree reduction in groupshared memory.
+groupshared uint3 g_partialSums[REDUCTION_GROUP_SIZE];
+
+uint3 GroupReduceSum(uint3 value, uint groupIndex)
+{
+	g_partialSums[groupIndex] = value;
+	
+	GroupMemoryBarrierWithGroupSync();
+	
+	[unroll]
+	for (uint stride = REDUCTION_GROUP_SIZE / 2; stride > 0; stride >>= 1)
+	{
+		if (groupIndex < stride)
+		{
+			g_partialSums[groupIndex] += g_partialSums[groupIndex + stride];
+		}
+		
+		GroupMemoryBarrierWithGroupSync();
+	}
+	
+	return g_partialSums[0];
+}
+
+#endif
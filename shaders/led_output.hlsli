@@ -0,0 +1,37 @@
+// Final per-LED outputs, shared by the sampling shaders.
+
+#include "color_grading.hlsli"
+
+struct LEDOutput
+{
+	double3 color;
+	double _pad;
+};
+
+RWStructuredBuffer<LEDOutput> output : register(u1);
+
+// Graded colors packed as consecutive RGB bytes, matching the AdaLight data layout. Cleared every frame while grading on the GPU.
+RWByteAddressBuffer packedOutput : register(u2);
+
+void WritePackedColor(uint ledID, uint3 color)
+{
+	[unroll]
+	for (uint i = 0; i < 3; i++)
+	{
+		uint byteOffset = ledID * 3 + i;
+		packedOutput.InterlockedOr(byteOffset & ~3, (color[i] & 0xff) << ((byteOffset & 3) * 8));
+	}
+}
+
+// Writes the linear average color, and the graded bytes while grading on the GPU is enabled.
+void WriteLEDOutput(uint ledID, double3 color)
+{
+	output[ledID].color = color;
+	
+	// Uniform branch, set for the whole dispatch.
+	[branch]
+	if (g_gradeColors != 0)
+	{
+		WritePackedColor(ledID, GradeColor(float3(color)));
+	}
+}
@@ -0,0 +1,63 @@
+#include "led_output.hlsli"
+
+struct LEDSampleArea
+{
+	float xMin;
+	float yMin;
+	float xMax;
+	float yMax;
+	uint eye;
+	uint3 _pad;
+};
+
+cbuffer csConstantBuffer : register(b0)
+{
+	uint2 g_frameSize;
+    uint g_numLEDs;
+	uint g_sampleTaps;
+}
+
+StructuredBuffer<LEDSampleArea> sampleArea : register(t1);
+
+// Both eyes copied into the slices of a mip-mapped array.
+Texture2DArray<float4> g_framePyramid : register(t3);
+SamplerState g_trilinearSampler : register(s0);
+
+#define THREADS_PER_GROUP 64
+
+// Approximates the area average with a grid of taps, each sampled at the mip level where a texel covers the tap spacing.
+// Cost per LED depends only on the number of taps, not on the area size or the frame resolution.
+[numthreads(THREADS_PER_GROUP, 1, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+	uint ledID = threadID.x;
+	
+	if (ledID >= g_numLEDs)
+	{
+		return;
+	}
+	
+	LEDSampleArea area = sampleArea[ledID];
+	
+	float2 areaMin = saturate(float2(area.xMin, area.yMin));
+	float2 areaMax = saturate(float2(area.xMax, area.yMax));
+	
+	float2 tapSpacing = (areaMax - areaMin) / g_sampleTaps;
+	float2 tapSpacingPixels = tapSpacing * g_frameSize;
+	float lod = max(log2(max(max(tapSpacingPixels.x, tapSpacingPixels.y), 1.0)), 0.0);
+	
+	float3 sum = float3(0, 0, 0);
+	
+	for (uint y = 0; y < g_sampleTaps; y++)
+	{
+		for (uint x = 0; x < g_sampleTaps; x++)
+		{
+			float2 uv = areaMin + (float2(x, y) + 0.5) * tapSpacing;
+			sum += g_framePyramid.SampleLevel(g_trilinearSampler, float3(uv, area.eye), lod).rgb;
+		}
+	}
+	
+	double3 color = sum / (g_sampleTaps * g_sampleTaps);
+	
+	WriteLEDOutput(ledID, color);
+}
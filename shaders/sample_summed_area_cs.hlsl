@@ -0,0 +1,64 @@
+#include "led_output.hlsli"
+
+struct LEDSampleArea
+{
+	float xMin;
+	float yMin;
+	float xMax;
+	float yMax;
+	uint eye;
+	uint3 _pad;
+};
+
+cbuffer csConstantBuffer : register(b0)
+{
+	uint2 g_frameSize;
+    uint g_numLEDs;
+	uint g_sampleTaps;
+}
+
+StructuredBuffer<LEDSampleArea> sampleArea : register(t1);
+StructuredBuffer<uint3> summedAreaTable : register(t3);
+
+#define THREADS_PER_GROUP 64
+
+// Inclusive table value covering the pixels [0, x) x [0, y).
+uint3 TableSum(uint eye, uint x, uint y)
+{
+	if (x == 0 || y == 0)
+	{
+		return uint3(0, 0, 0);
+	}
+	
+	return summedAreaTable[(eye * g_frameSize.y + y - 1) * g_frameSize.x + x - 1];
+}
+
+// Exact area average from the four corners of the summed area table, constant cost regardless of the area size.
+[numthreads(THREADS_PER_GROUP, 1, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+	uint ledID = threadID.x;
+	
+	if (ledID >= g_numLEDs)
+	{
+		return;
+	}
+	
+	LEDSampleArea area = sampleArea[ledID];
+	
+	uint xMin = floor(saturate(area.xMin) * g_frameSize.x);
+	uint yMin = floor(saturate(area.yMin) * g_frameSize.y);
+	uint xMax = ceil(saturate(area.xMax) * g_frameSize.x);
+	uint yMax = ceil(saturate(area.yMax) * g_frameSize.y);
+	
+	xMax = max(xMax, xMin);
+	yMax = max(yMax, yMin);
+	
+	uint3 ledSum = TableSum(area.eye, xMax, yMax) - TableSum(area.eye, xMin, yMax) - TableSum(area.eye, xMax, yMin) + TableSum(area.eye, xMin, yMin);
+	
+	double numPixels = (xMax - xMin) * (yMax - yMin);
+	
+	double3 color = ledSum / (255.0 * max(numPixels, 1.0));
+	
+	WriteLEDOutput(ledID, color);
+}
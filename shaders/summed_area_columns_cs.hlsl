@@ -0,0 +1,51 @@
+cbuffer csConstantBuffer : register(b0)
+{
+	uint2 g_frameSize;
+    uint g_numLEDs;
+	uint g_sampleTaps;
+}
+
+RWStructuredBuffer<uint3> summedAreaTable : register(u0);
+
+#define SCAN_THREADS 64
+
+groupshared uint3 g_chunkSums[SCAN_THREADS];
+
+// Second pass of the summed area table, an inclusive prefix sum down each column of the row sums.
+[numthreads(SCAN_THREADS, 1, 1)]
+void main(uint3 groupID : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+	uint column = groupID.x;
+	uint eye = groupID.y;
+	
+	uint chunkSize = (g_frameSize.y + SCAN_THREADS - 1) / SCAN_THREADS;
+	uint chunkStart = min(groupIndex * chunkSize, g_frameSize.y);
+	uint chunkEnd = min(chunkStart + chunkSize, g_frameSize.y);
+	uint eyeOffset = eye * g_frameSize.y * g_frameSize.x + column;
+	
+	uint3 sum = uint3(0, 0, 0);
+	
+	for (uint y = chunkStart; y < chunkEnd; y++)
+	{
+		uint index = eyeOffset + y * g_frameSize.x;
+		
+		sum += summedAreaTable[index];
+		summedAreaTable[index] = sum;
+	}
+	
+	g_chunkSums[groupIndex] = sum;
+	
+	GroupMemoryBarrierWithGroupSync();
+	
+	uint3 chunkOffset = uint3(0, 0, 0);
+	
+	for (uint i = 0; i < groupIndex; i++)
+	{
+		chunkOffset += g_chunkSums[i];
+	}
+	
+	for (uint offsetY = chunkStart; offsetY < chunkEnd; offsetY++)
+	{
+		summedAreaTable[eyeOffset + offsetY * g_frameSize.x] += chunkOffset;
+	}
+}
@@ -0,0 +1,69 @@
+cbuffer csConstantBuffer : register(b0)
+{
+	uint2 g_frameSize;
+    uint g_numLEDs;
+	uint g_sampleTaps;
+}
+
+// Both eyes are bound at once, the table holds one slice per eye.
+Texture2D<float4> g_frameLeft : register(t0);
+Texture2D<float4> g_frameRight : register(t2);
+
+// Integer sums of the 8-bit quantized color. Wraparound is harmless since every rectangle sum fits in 32 bits.
+RWStructuredBuffer<uint3> summedAreaTable : register(u0);
+
+#define SCAN_THREADS 64
+
+groupshared uint3 g_chunkSums[SCAN_THREADS];
+
+// First pass of the summed area table, an inclusive prefix sum along each row.
+// Each thread scans a contiguous chunk of the row, then adds the totals of the chunks before it.
+[numthreads(SCAN_THREADS, 1, 1)]
+void main(uint3 groupID : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+	uint row = groupID.x;
+	uint eye = groupID.y;
+	
+	uint chunkSize = (g_frameSize.x + SCAN_THREADS - 1) / SCAN_THREADS;
+	uint chunkStart = min(groupIndex * chunkSize, g_frameSize.x);
+	uint chunkEnd = min(chunkStart + chunkSize, g_frameSize.x);
+	uint rowOffset = (eye * g_frameSize.y + row) * g_frameSize.x;
+	
+	uint3 sum = uint3(0, 0, 0);
+	
+	for (uint x = chunkStart; x < chunkEnd; x++)
+	{
+		float3 texel;
+		
+		// Uniform within the group, each group covers a single eye.
+		[branch]
+		if (eye == 0)
+		{
+			texel = g_frameLeft.Load(int3(x, row, 0)).rgb;
+		}
+		else
+		{
+			texel = g_frameRight.Load(int3(x, row, 0)).rgb;
+		}
+		
+		// Same quantization as the gather pass.
+		sum += uint3(texel * 255);
+		summedAreaTable[rowOffset + x] = sum;
+	}
+	
+	g_chunkSums[groupIndex] = sum;
+	
+	GroupMemoryBarrierWithGroupSync();
+	
+	uint3 chunkOffset = uint3(0, 0, 0);
+	
+	for (uint i = 0; i < groupIndex; i++)
+	{
+		chunkOffset += g_chunkSums[i];
+	}
+	
+	for (uint offsetX = chunkStart; offsetX < chunkEnd; offsetX++)
+	{
+		summedAreaTable[rowOffset + offsetX] += chunkOffset;
+	}
+}
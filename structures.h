@@ -1,7 +1,17 @@
 
 #pragma once
 
-#include "framework.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+enum ESamplingMode
+{
+	SamplingMode_Exact = 0, // Average of every pixel in the area
+	SamplingMode_MipPyramid = 1, // Few taps from a mip-mapped copy of the frame
+	SamplingMode_SummedArea = 2 // Exact average from a summed area table of the frame
+};
 
 
 struct alignas(16) LEDSampleArea
@@ -11,12 +21,17 @@ struct alignas(16) LEDSampleArea
 	float xMax = 0;
 	float yMax = 0;
 
-	LEDSampleArea(float inXMin, float inYMin, float inXMax, float inYMax)
+	// Mirror texture to sample, 0 for the left eye and 1 for the right.
+	uint32_t eye = 0;
+	uint32_t _pad[3] = {};
+
+	LEDSampleArea(float inXMin, float inYMin, float inXMax, float inYMax, uint32_t inEye = 0)
 	{
 		xMin = inXMin;
 		yMin = inYMin;
 		xMax = inXMax;
 		yMax = inYMax;
+		eye = inEye;
 	}
 
 	LEDSampleArea() {}
@@ -41,13 +56,37 @@ struct alignas(16) LEDShaderOutput
 };
 
 
+struct LEDOutputData
+{
+	uint8_t r;
+	uint8_t g;
+	uint8_t b;
+};
+
+
+// Output color in 8.8 fixed point, before the final truncation or dithering to bytes.
+struct LEDOutputData16
+{
+	uint16_t r;
+	uint16_t g;
+	uint16_t b;
+};
+
+static_assert(sizeof(LEDOutputData) == 3 && sizeof(LEDOutputData16) == 6, "Output colors are processed as flat channel arrays");
+
+
 struct LEDSampleData
 {
 	int NumLEDs = 0;
 	bool IsInputUpdated = false;
+	uint64_t GeometryVersion = 0;
 	std::vector<LEDSampleArea> sampleAreas;
 	std::vector<LEDShaderOutput> sampleOutput;
 
+	// Final LED colors, filled in instead of sampleOutput when the renderer does the color grading.
+	bool IsOutputGraded = false;
+	std::vector<LEDOutputData> gradedOutput;
+
 	LEDSampleData() {}
 
 	LEDSampleData(int num)
@@ -56,13 +95,34 @@ struct LEDSampleData
 		IsInputUpdated = true;
 		sampleAreas.resize(num);
 		sampleOutput.resize(num);
+		gradedOutput.resize(num);
 	}
 };
 
 
-struct LEDOutputData
+// Structure-of-arrays copy of the sample output, for batch color processing.
+struct LEDColorBuffer
 {
-	uint8_t r;
-	uint8_t g;
-	uint8_t b;
-};
\ No newline at end of file
+	std::vector<float> r;
+	std::vector<float> g;
+	std::vector<float> b;
+
+	void Resize(int num)
+	{
+		r.resize(num);
+		g.resize(num);
+		b.resize(num);
+	}
+
+	void SetFromShaderOutput(const std::vector<LEDShaderOutput>& input)
+	{
+		Resize((int)input.size());
+
+		for (size_t i = 0; i < input.size(); i++)
+		{
+			r[i] = (float)input[i].r;
+			g[i] = (float)input[i].g;
+			b[i] = (float)input[i].b;
+		}
+	}
+};
@@ -0,0 +1,77 @@
+#include "summed_area_table.h"
+
+#include <algorithm>
+
+
+void SummedAreaTable::Build(const CPUFrame& frame)
+{
+	m_width = frame.Width;
+	m_height = frame.Height;
+
+	const size_t stride = ((size_t)m_width + 1) * 3;
+
+	// Only the first row and column need clearing, everything else is overwritten.
+	m_table.resize(stride * ((size_t)m_height + 1));
+	std::fill(m_table.begin(), m_table.begin() + stride, 0);
+
+	for (uint32_t y = 0; y < m_height; y++)
+	{
+		const float* source = frame.GetPixel(0, y);
+		const uint32_t* above = &m_table[stride * y];
+		uint32_t* row = &m_table[stride * (y + 1)];
+
+		row[0] = row[1] = row[2] = 0;
+
+		uint32_t sumRed = 0;
+		uint32_t sumGreen = 0;
+		uint32_t sumBlue = 0;
+
+		for (uint32_t x = 0; x < m_width; x++)
+		{
+			sumRed += QuantizeChannel(source[x * 3 + 0]);
+			sumGreen += QuantizeChannel(source[x * 3 + 1]);
+			sumBlue += QuantizeChannel(source[x * 3 + 2]);
+
+			row[(x + 1) * 3 + 0] = above[(x + 1) * 3 + 0] + sumRed;
+			row[(x + 1) * 3 + 1] = above[(x + 1) * 3 + 1] + sumGreen;
+			row[(x + 1) * 3 + 2] = above[(x + 1) * 3 + 2] + sumBlue;
+		}
+	}
+}
+
+void SummedAreaTable::GetAreaSum(uint32_t xMin, uint32_t yMin, uint32_t xMax, uint32_t yMax, uint32_t outSum[3]) const
+{
+	const size_t stride = ((size_t)m_width + 1) * 3;
+
+	const uint32_t* topLeft = &m_table[stride * yMin + xMin * 3];
+	const uint32_t* topRight = &m_table[stride * yMin + xMax * 3];
+	const uint32_t* bottomLeft = &m_table[stride * yMax + xMin * 3];
+	const uint32_t* bottomRight = &m_table[stride * yMax + xMax * 3];
+
+	for (int c = 0; c < 3; c++)
+	{
+		outSum[c] = bottomRight[c] - bottomLeft[c] - topRight[c] + topLeft[c];
+	}
+}
+
+
+void SampleLEDs_SummedArea(const SummedAreaTable& leftEye, const SummedAreaTable& rightEye, const std::vector<LEDSampleArea>& areas, std::vector<LEDShaderOutput>& output)
+{
+	output.resize(areas.size());
+
+	for (size_t i = 0; i < areas.size(); i++)
+	{
+		const SummedAreaTable& table = areas[i].eye == 0 ? leftEye : rightEye;
+
+		// The frame size is taken from the left eye, like in the renderer.
+		LEDTileInfo area = GetLEDTileInfo(areas[i], leftEye.GetWidth(), leftEye.GetHeight());
+
+		uint32_t ledSum[3];
+		table.GetAreaSum(area.xMin, area.yMin, area.xMax, area.yMax, ledSum);
+
+		double numPixels = (double)((area.xMax - area.xMin) * (area.yMax - area.yMin));
+		double divisor = 255.0 * (numPixels > 1.0 ? numPixels : 1.0);
+
+		output[i] = LEDShaderOutput(ledSum[0] / divisor, ledSum[1] / divisor, ledSum[2] / divisor);
+	}
+}
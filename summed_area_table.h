@@ -0,0 +1,29 @@
+#pragma once
+
+#include "gather_reference.h"
+
+
+// Summed area table of the 8-bit quantized frame color, giving the sum over any rectangle from four lookups.
+// The sums are unsigned 32-bit and may wrap around on large frames, rectangle sums are still exact as long as they fit in 32 bits.
+class SummedAreaTable
+{
+public:
+	void Build(const CPUFrame& frame);
+
+	// Sum over the pixels [xMin, xMax) x [yMin, yMax).
+	void GetAreaSum(uint32_t xMin, uint32_t yMin, uint32_t xMax, uint32_t yMax, uint32_t outSum[3]) const;
+
+	uint32_t GetWidth() const { return m_width; }
+	uint32_t GetHeight() const { return m_height; }
+
+private:
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+
+	// (Width + 1) x (Height + 1) interleaved RGB sums, the first row and column are zero.
+	std::vector<uint32_t> m_table;
+};
+
+
+// Exact per-LED area averages from one table per eye, the CPU counterpart of sample_summed_area_cs.
+void SampleLEDs_SummedArea(const SummedAreaTable& leftEye, const SummedAreaTable& rightEye, const std::vector<LEDSampleArea>& areas, std::vector<LEDShaderOutput>& output);
@@ -0,0 +1,199 @@
+#include "synthetic_frame_source.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Rows of noise past the frame height, the noise pattern picks a random offset within them.
+#define SYNTHETIC_NOISE_SCROLL_ROWS 256
+
+
+SyntheticFrameSource::SyntheticFrameSource(const SyntheticFrameParams& params, bool bRealTime)
+	: m_params(params)
+	, m_bRealTime(bRealTime)
+{
+
+}
+
+bool SyntheticFrameSource::InitSource()
+{
+	if (m_params.Width == 0 || m_params.Height == 0 || m_params.Pattern < SyntheticPattern_SolidFlash || m_params.Pattern > SyntheticPattern_Noise)
+	{
+		return false;
+	}
+
+	m_params.NumBars = std::max(m_params.NumBars, 1u);
+	m_params.PeriodMS = std::max(m_params.PeriodMS, 0.001f);
+
+	DrawStrip();
+
+	m_randomState = m_params.Seed != 0 ? m_params.Seed : 1;
+	m_nextFrame = 0;
+	m_bHasFrame = false;
+	m_pacer.Reset();
+
+	return true;
+}
+
+uint32_t SyntheticFrameSource::NextRandom()
+{
+	// xorshift32
+	m_randomState ^= m_randomState << 13;
+	m_randomState ^= m_randomState >> 17;
+	m_randomState ^= m_randomState << 5;
+
+	return m_randomState;
+}
+
+static inline void SetPixel(uint8_t* pixel, float r, float g, float b)
+{
+	pixel[0] = (uint8_t)(r * 255.0f + 0.5f);
+	pixel[1] = (uint8_t)(g * 255.0f + 0.5f);
+	pixel[2] = (uint8_t)(b * 255.0f + 0.5f);
+	pixel[3] = 255;
+}
+
+// Fully saturated color for a hue in [0, 1).
+static inline void GetHueColor(float hue, float& r, float& g, float& b)
+{
+	const float h = hue * 6.0f;
+
+	r = std::clamp(std::fabs(h - 3.0f) - 1.0f, 0.0f, 1.0f);
+	g = std::clamp(2.0f - std::fabs(h - 2.0f), 0.0f, 1.0f);
+	b = std::clamp(2.0f - std::fabs(h - 4.0f), 0.0f, 1.0f);
+}
+
+void SyntheticFrameSource::DrawStrip()
+{
+	const uint32_t width = m_params.Width;
+	const uint32_t height = m_params.Height;
+	const uint32_t barRows = std::max(height / (m_params.NumBars * 2), 1u);
+
+	switch (m_params.Pattern)
+	{
+	case SyntheticPattern_SolidFlash:
+	case SyntheticPattern_Strobe:
+		m_scrollRows = height;
+		break;
+
+	case SyntheticPattern_Gradient:
+		m_scrollRows = height;
+		break;
+
+	case SyntheticPattern_MovingBars:
+		m_scrollRows = barRows * 2;
+		break;
+
+	default:
+		m_scrollRows = SYNTHETIC_NOISE_SCROLL_ROWS;
+		break;
+	}
+
+	m_strip.Resize(width, height + m_scrollRows);
+
+	uint32_t randomState = m_params.Seed != 0 ? m_params.Seed : 1;
+
+	for (uint32_t y = 0; y < m_strip.Height; y++)
+	{
+		uint8_t* row = m_strip.GetPixel(0, y);
+
+		if (m_params.Pattern == SyntheticPattern_Noise)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				randomState ^= randomState << 13;
+				randomState ^= randomState >> 17;
+				randomState ^= randomState << 5;
+
+				memcpy(row + x * 4, &randomState, 3);
+				row[x * 4 + 3] = 255;
+			}
+			continue;
+		}
+
+		for (uint32_t x = 0; x < width; x++)
+		{
+			float r, g, b;
+
+			if (m_params.Pattern == SyntheticPattern_Gradient)
+			{
+				// Repeats every frame height, so any offset gives a seamless image.
+				GetHueColor((float)(y % height) / height, r, g, b);
+
+				const float brightness = std::fabs((x + 0.5f) / width * 2.0f - 1.0f);
+				r *= brightness;
+				g *= brightness;
+				b *= brightness;
+			}
+			else
+			{
+				// White above black for the flashes, alternating bars otherwise.
+				const bool bWhite = m_params.Pattern == SyntheticPattern_MovingBars ? (y / barRows) % 2 == 0 : y < height;
+				r = g = b = bWhite ? 1.0f : 0.0f;
+			}
+
+			SetPixel(row + x * 4, r, g, b);
+		}
+	}
+}
+
+// First strip row of the frame.
+uint32_t SyntheticFrameSource::GetStripOffset(uint64_t frameIndex)
+{
+	const double timeMS = frameIndex * (double)m_params.FrameIntervalMS;
+	const double phase = timeMS / m_params.PeriodMS - std::floor(timeMS / m_params.PeriodMS);
+
+	switch (m_params.Pattern)
+	{
+	case SyntheticPattern_SolidFlash:
+		return phase < 0.5 ? 0 : m_scrollRows;
+
+	case SyntheticPattern_Strobe:
+		return frameIndex % 2 == 0 ? 0 : m_scrollRows;
+
+	case SyntheticPattern_Gradient:
+	case SyntheticPattern_MovingBars:
+		// Scrolls down, the content moves towards larger y.
+		return (m_scrollRows - std::min((uint32_t)(phase * m_scrollRows), m_scrollRows - 1)) % m_scrollRows;
+
+	default:
+		return NextRandom() % m_scrollRows;
+	}
+}
+
+EFrameWaitResult SyntheticFrameSource::WaitFrame(uint32_t timeoutMS)
+{
+	if (m_params.NumFrames > 0 && m_nextFrame >= m_params.NumFrames)
+	{
+		return FrameWait_EndOfStream;
+	}
+
+	if (!m_pacer.WaitNextFrame(m_bRealTime ? m_params.FrameIntervalMS : 0.0f, timeoutMS))
+	{
+		return FrameWait_TimedOut;
+	}
+
+	m_frameIndex = m_nextFrame++;
+	m_leftOffset = GetStripOffset(m_frameIndex);
+	m_rightOffset = m_params.Pattern == SyntheticPattern_Noise ? GetStripOffset(m_frameIndex) : m_leftOffset;
+	m_bHasFrame = true;
+
+	return FrameWait_Ready;
+}
+
+bool SyntheticFrameSource::GetFrameImages(RGBAImageView& outLeft, RGBAImageView& outRight)
+{
+	if (!m_bHasFrame)
+	{
+		return false;
+	}
+
+	outLeft = m_strip.GetView();
+	outLeft.Height = m_params.Height;
+	outRight = outLeft;
+
+	outLeft.Data += (size_t)m_leftOffset * outLeft.RowPitch;
+	outRight.Data += (size_t)m_rightOffset * outRight.RowPitch;
+
+	return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "frame_source.h"
+
+
+enum ESyntheticPattern
+{
+	SyntheticPattern_SolidFlash = 0, // Whole frame switching between white and black once per period
+	SyntheticPattern_Strobe, // Whole frame switching between white and black every frame
+	SyntheticPattern_Gradient, // Vertical rainbow scrolling down once per period, darkening towards the center
+	SyntheticPattern_MovingBars, // Horizontal white and black bars moving down by one bar pair per period
+	SyntheticPattern_Noise // Random pixels, different every frame
+};
+
+struct SyntheticFrameParams
+{
+	int Pattern = SyntheticPattern_MovingBars;
+	uint32_t Width = 1920;
+	uint32_t Height = 1920;
+
+	// Pattern time advances by the interval every frame, so the content doesn't depend on how fast the frames are consumed.
+	float FrameIntervalMS = 1000.0f / 90.0f;
+	float PeriodMS = 1000.0f;
+
+	uint32_t NumBars = 4; // White bars in the frame height
+	uint32_t NumFrames = 0; // Zero for no end
+	uint32_t Seed = 1;
+};
+
+
+// Generates test patterns for stressing the sampler without a headset.
+// Every pattern is drawn once into a strip taller than the frame, and each frame is a view into it at some row offset,
+// so producing a frame costs nothing and the sampling cost is all that is measured.
+class SyntheticFrameSource : public IFrameSource
+{
+public:
+
+	// Without real time pacing the frames are generated as fast as they are consumed, still reporting the frame interval.
+	SyntheticFrameSource(const SyntheticFrameParams& params, bool bRealTime = true);
+
+	bool InitSource() override;
+	bool IsActive() override { return true; }
+	EFrameWaitResult WaitFrame(uint32_t timeoutMS) override;
+	float GetFrameIntervalMS() override { return m_params.FrameIntervalMS; }
+	bool HasFrameImages() const override { return true; }
+	bool GetFrameImages(RGBAImageView& outLeft, RGBAImageView& outRight) override;
+
+	uint64_t GetFrameIndex() const { return m_frameIndex; }
+
+protected:
+
+	void DrawStrip();
+	uint32_t GetStripOffset(uint64_t frameIndex);
+	uint32_t NextRandom();
+
+	SyntheticFrameParams m_params;
+	bool m_bRealTime = true;
+
+	RGBAFrame m_strip;
+	uint32_t m_scrollRows = 0;
+	uint32_t m_randomState = 1;
+
+	uint64_t m_frameIndex = 0;
+	uint64_t m_nextFrame = 0;
+	uint32_t m_leftOffset = 0;
+	uint32_t m_rightOffset = 0;
+	bool m_bHasFrame = false;
+	FramePacer m_pacer;
+};
@@ -0,0 +1,141 @@
+#include "temporal_filter.h"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define FILTER_PI 3.14159265358979323846
+
+// Cutoff frequency for smoothing the derivative in the one euro filter.
+#define ONE_EURO_DERIVATIVE_CUTOFF_HZ 1.0
+
+
+static inline double TimeConstantAlpha(double deltaTime, double timeConstant)
+{
+	return timeConstant > 0.0 ? 1.0 - exp(-deltaTime / timeConstant) : 1.0;
+}
+
+static inline double CutoffAlpha(double deltaTime, double cutoffHz)
+{
+	double r = 2.0 * FILTER_PI * cutoffHz * deltaTime;
+	return r / (r + 1.0);
+}
+
+
+void TemporalFilter::Process(std::vector<LEDShaderOutput>& samples, const TemporalFilterParams& params, float deltaTimeMS)
+{
+	int numLEDs = (int)samples.size();
+
+	if (params.Type == Filter_None)
+	{
+		m_bIsInitialized = false;
+		m_latencyMS = 0.0f;
+		return;
+	}
+
+	// Start from the current frame when the filter is (re)enabled or the LED count changes.
+	if (!m_bIsInitialized || params.Type != m_filterType || (int)m_state.size() != numLEDs)
+	{
+		m_state = samples;
+		m_derivative.assign(numLEDs, LEDShaderOutput());
+		m_filterType = params.Type;
+		m_bIsInitialized = true;
+		m_latencyMS = 0.0f;
+		return;
+	}
+
+	double deltaTime = (deltaTimeMS > 0.001f ? deltaTimeMS : 0.001f) / 1000.0;
+
+	double alpha = TimeConstantAlpha(deltaTime, params.TimeConstantMS / 1000.0);
+	double attackAlpha = TimeConstantAlpha(deltaTime, params.AttackMS / 1000.0);
+	double releaseAlpha = TimeConstantAlpha(deltaTime, params.ReleaseMS / 1000.0);
+	double derivativeAlpha = CutoffAlpha(deltaTime, ONE_EURO_DERIVATIVE_CUTOFF_HZ);
+
+	// Flat views of the arrays, four doubles per LED. The fourth lane is the padding member, the vector path filters it
+	// along as scratch and it is left out of the latency estimate, so its contents are meaningless.
+	static_assert(sizeof(LEDShaderOutput) == 4 * sizeof(double), "The filter walks the LEDs as flat arrays of four doubles");
+
+	double* values = reinterpret_cast<double*>(samples.data());
+	double* state = reinterpret_cast<double*>(m_state.data());
+	double* derivative = reinterpret_cast<double*>(m_derivative.data());
+
+	double alphaSum = 0.0;
+
+#if defined(__AVX2__)
+
+	// One LED per vector, the padding lane is masked out of the latency estimate.
+	const __m256d channelMask = _mm256_set_pd(0.0, 1.0, 1.0, 1.0);
+	__m256d alphaSumVec = _mm256_setzero_pd();
+
+	for (int i = 0; i < numLEDs * 4; i += 4)
+	{
+		__m256d x = _mm256_loadu_pd(&values[i]);
+		__m256d y = _mm256_loadu_pd(&state[i]);
+		__m256d a;
+
+		if (params.Type == Filter_OneEuro)
+		{
+			__m256d dx = _mm256_mul_pd(_mm256_sub_pd(x, y), _mm256_set1_pd(1.0 / deltaTime));
+			__m256d dxHat = _mm256_loadu_pd(&derivative[i]);
+			dxHat = _mm256_fmadd_pd(_mm256_sub_pd(dx, dxHat), _mm256_set1_pd(derivativeAlpha), dxHat);
+			_mm256_storeu_pd(&derivative[i], dxHat);
+
+			__m256d absDx = _mm256_andnot_pd(_mm256_set1_pd(-0.0), dxHat);
+			__m256d cutoff = _mm256_fmadd_pd(absDx, _mm256_set1_pd(params.Beta), _mm256_set1_pd(params.MinCutoffHz));
+			__m256d r = _mm256_mul_pd(cutoff, _mm256_set1_pd(2.0 * FILTER_PI * deltaTime));
+			a = _mm256_div_pd(r, _mm256_add_pd(r, _mm256_set1_pd(1.0)));
+		}
+		else if (params.Type == Filter_AttackRelease)
+		{
+			__m256d isRising = _mm256_cmp_pd(x, y, _CMP_GT_OQ);
+			a = _mm256_blendv_pd(_mm256_set1_pd(releaseAlpha), _mm256_set1_pd(attackAlpha), isRising);
+		}
+		else
+		{
+			a = _mm256_set1_pd(alpha);
+		}
+
+		y = _mm256_fmadd_pd(_mm256_sub_pd(x, y), a, y);
+		alphaSumVec = _mm256_fmadd_pd(a, channelMask, alphaSumVec);
+
+		_mm256_storeu_pd(&state[i], y);
+		_mm256_storeu_pd(&values[i], y);
+	}
+
+	alignas(32) double alphaLanes[4];
+	_mm256_store_pd(alphaLanes, alphaSumVec);
+	alphaSum = alphaLanes[0] + alphaLanes[1] + alphaLanes[2];
+
+#else
+
+	for (int i = 0; i < numLEDs * 4; i += 4)
+	{
+		for (int c = i; c < i + 3; c++)
+		{
+			double a = alpha;
+
+			if (params.Type == Filter_OneEuro)
+			{
+				double dx = (values[c] - state[c]) / deltaTime;
+				derivative[c] += (dx - derivative[c]) * derivativeAlpha;
+				a = CutoffAlpha(deltaTime, params.MinCutoffHz + params.Beta * fabs(derivative[c]));
+			}
+			else if (params.Type == Filter_AttackRelease)
+			{
+				a = values[c] > state[c] ? attackAlpha : releaseAlpha;
+			}
+
+			state[c] += (values[c] - state[c]) * a;
+			values[c] = state[c];
+			alphaSum += a;
+		}
+	}
+
+#endif
+
+	// An exponential moving average with weight alpha delays the signal by (1 - alpha) / alpha frames on average.
+	double meanAlpha = numLEDs > 0 ? alphaSum / (numLEDs * 3) : 1.0;
+	m_latencyMS = meanAlpha > 0.0 ? (float)(deltaTimeMS * (1.0 - meanAlpha) / meanAlpha) : 0.0f;
+}
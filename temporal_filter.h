@@ -0,0 +1,51 @@
+#pragma once
+
+#include "structures.h"
+
+
+enum ETemporalFilterType
+{
+	Filter_None = 0,
+	Filter_EMA = 1,
+	Filter_OneEuro = 2,
+	Filter_AttackRelease = 3
+};
+
+
+struct TemporalFilterParams
+{
+	int Type = Filter_None;
+
+	// Exponential moving average time constant.
+	float TimeConstantMS = 50.0f;
+
+	// Separate time constants for brightening and darkening.
+	float AttackMS = 20.0f;
+	float ReleaseMS = 150.0f;
+
+	// One euro filter, the cutoff frequency rises with the rate of change to cut lag on fast transitions.
+	float MinCutoffHz = 1.0f;
+	float Beta = 5.0f;
+};
+
+
+// Per-LED smoothing of the linear sample output between frames, applied in place before the color grading.
+// The filter state is kept in arrays with the same layout as the sample output, so each LED is a single vector operation.
+// The padding member of the samples is used as a scratch lane.
+class TemporalFilter
+{
+public:
+	void Process(std::vector<LEDShaderOutput>& samples, const TemporalFilterParams& params, float deltaTimeMS);
+	void Reset() { m_bIsInitialized = false; }
+
+	// Average delay the filter added on the last frame, for an equivalent exponential moving average.
+	float GetLatencyMS() const { return m_latencyMS; }
+
+protected:
+	bool m_bIsInitialized = false;
+	int m_filterType = Filter_None;
+	float m_latencyMS = 0.0f;
+
+	std::vector<LEDShaderOutput> m_state;
+	std::vector<LEDShaderOutput> m_derivative;
+};